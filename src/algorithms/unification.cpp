@@ -18,17 +18,27 @@ bool Core::occurs(int v, int i){
 		return false;
 
 	int ti = node_header[i].data_idx;
-	for (int c : term_data[ti].argument_idx)
+	for (int c : arguments(ti))
 		if (occurs(v, c))
 			return true;
 
 	return false;
 }
 
+// Path halving: every node on the way is made to point to its grandparent,
+// which compresses paths about as well as full compression does, without
+// recursing or going over the path twice. Only vars have parents; terms are
+// always representatives
 int Core::find(int i) {
-	if (node_header[i].tag == Tag::Term) return i;
-	if (node_header[i].data_idx == i) return i;
-	return node_header[i].data_idx = find(node_header[i].data_idx);
+	while (node_header[i].tag == Tag::Var && node_header[i].data_idx != i) {
+		int parent = node_header[i].data_idx;
+		NodeHeader const& up = node_header[parent];
+		if (up.tag == Tag::Term || up.data_idx == parent)
+			return parent;
+		node_header[i].data_idx = up.data_idx;
+		i = up.data_idx;
+	}
+	return i;
 }
 
 int Core::find_term(int i) {
@@ -42,19 +52,34 @@ int Core::find_function(int i) {
 	return term_data[i].function_id;
 }
 
+void Core::link(int i, int j) {
+	node_header[i].tag = Tag::Var;
+	node_header[i].data_idx = j;
+	if (node_header[j].rank <= node_header[i].rank)
+		node_header[j].rank = node_header[i].rank + 1;
+}
+
 void Core::unify(int i, int j) {
 	i = find(i);
 	j = find(j);
 
+	if (i == j)
+		return;
+
 	if (node_header[j].tag == Tag::Var)
 		std::swap(i, j);
 
 	if (node_header[i].tag == Tag::Var) {
 
-		if (node_header[j].tag == Tag::Term)
+		if (node_header[j].tag == Tag::Term) {
+			// terms are always representatives
 			assert(!occurs(i, j));
-
-		node_header[i].data_idx = j;
+			link(i, j);
+		} else if (node_header[j].rank < node_header[i].rank) {
+			link(j, i);
+		} else {
+			link(i, j);
+		}
 
 	} else {
 		int vi = node_header[i].data_idx;
@@ -62,25 +87,35 @@ void Core::unify(int i, int j) {
 
 		unify_function(*this, i, j);
 
-		assert(term_data[vi].argument_idx.size() == term_data[vj].argument_idx.size());
-		for (size_t k = 0; k < term_data[vi].argument_idx.size(); ++k)
-			unify(term_data[vi].argument_idx[k], term_data[vj].argument_idx[k]);
+		// by index, since unify_function may grow the argument buffer
+		int const count = term_data[vi].argument_count;
+		assert(count == term_data[vj].argument_count);
+		for (int k = 0; k < count; ++k)
+			unify(
+			    argument_idx[term_data[vi].argument_start + k],
+			    argument_idx[term_data[vj].argument_start + k]);
 	}
 }
 
 int Core::new_var(char const* debug) {
 	int id = node_header.size();
-	node_header.push_back({Tag::Var, id, debug});
+	node_header.push_back({Tag::Var, 0, id, debug});
 	return id;
 }
 
-int Core::new_term(int f, std::vector<int> args, char const* debug) {
+int Core::new_term(int f, std::vector<int> const& args, char const* debug) {
 	int id = node_header.size();
-	node_header.push_back({Tag::Term, static_cast<int>(term_data.size()), debug});
-	term_data.push_back({f, std::move(args)});
+	node_header.push_back({Tag::Term, 0, static_cast<int>(term_data.size()), debug});
+	term_data.push_back({f, static_cast<int>(argument_idx.size()), static_cast<int>(args.size())});
+	argument_idx.insert(argument_idx.end(), args.begin(), args.end());
 	return id;
 }
 
+Span<int const> Core::arguments(int term) const {
+	TermData const& data = term_data[term];
+	return {argument_idx.data() + data.argument_start, data.argument_count};
+}
+
 bool Core::is_term(int i) {
 	return node_header[i].tag == Tag::Term;
 }
@@ -107,7 +142,7 @@ void Core::print_node(int header, int d) {
 	} else {
 		Core::TermData& data = term_data[node.data_idx];
 		std::cerr << "Term " << node.data_idx << " (tf " << data.function_id << ")\n";
-		for (const auto arg : data.argument_idx)
+		for (const auto arg : arguments(node.data_idx))
 			print_node(arg, d + 1);
 	}
 }
@@ -3,26 +3,37 @@
 #include <vector>
 #include <functional>
 
+#include "../utils/span.hpp"
+
 namespace Unification {
 
 struct Core {
 
-	enum class Tag { Var, Term, };
+	enum class Tag : unsigned char { Var, Term, };
 
 	struct NodeHeader {
 		Tag tag;
+		// upper bound on the height of the tree under a representative.
+		// Unions put the lower tree under the higher one, so trees stay
+		// logarithmic in height
+		unsigned char rank {0};
 		int data_idx;
 		const char* debug {nullptr};
 	};
 
 	struct TermData {
 		int function_id; // external id
-		std::vector<int> argument_idx;
+		// the arguments are `argument_count` node ids in `argument_idx`,
+		// starting at `argument_start`
+		int argument_start;
+		int argument_count;
 	};
 
 	std::function<void(Core&, int,int)> unify_function;
 	std::vector<NodeHeader> node_header;
 	std::vector<TermData> term_data;
+	// arguments of every term, back to back
+	std::vector<int> argument_idx;
 
 	bool occurs(int v, int i);
 
@@ -31,9 +42,16 @@ struct Core {
 	int find_function(int i);
 
 	void unify(int i, int j);
+	// makes the representative i point to j, for when the direction of a
+	// union is forced
+	void link(int i, int j);
 
 	int new_var(const char* debug = nullptr);
-	int new_term(int f, std::vector<int> args = {}, const char* debug = nullptr);
+	int new_term(int f, std::vector<int> const& args = {}, const char* debug = nullptr);
+
+	// arguments of the term with the given term id. Invalidated when a new
+	// term is made
+	Span<int const> arguments(int term) const;
 
 	bool is_var(int i);
 	bool is_term(int i);
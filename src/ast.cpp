@@ -1,5 +1,6 @@
 #include <cassert>
 #include <iostream>
+#include <vector>
 
 #include "./log/log.hpp"
 #include "cst.hpp"
@@ -10,27 +11,13 @@ namespace AST {
 
 static Expr* convert_expr(CST::CST* cst, Allocator& alloc);
 
-InternedString const& Declaration::identifier_text() const {
-	if (m_identifier.is_null()) {
-		if (!m_cst)
-			Log::fatal() << "No identifier string or fallback on declaration";
-
-		auto cst = static_cast<CST::Declaration*>(m_cst);
-
-		auto const& found_identifier = cst->identifier_virtual();
-
-		Log::warning() << "No identifier on declaration, using token data as fallback: '" << found_identifier << "'";
-
-		return found_identifier;
-	}
+InternedString Declaration::identifier_text() const {
+	if (m_identifier.is_null())
+		Log::fatal() << "No identifier string on declaration";
 
 	return m_identifier;
 }
 
-Token const* Identifier::token() const {
-	return static_cast<CST::Identifier*>(m_cst)->m_token;
-}
-
 
 static SequenceExpression* convert_and_wrap_in_seq(CST::Block* cst, Allocator& alloc) {
 	auto block = static_cast<Block*>(convert_ast(cst, alloc));
@@ -42,7 +29,8 @@ static SequenceExpression* convert_and_wrap_in_seq(CST::Block* cst, Allocator& a
 
 static IntegerLiteral* convert(CST::IntegerLiteral* cst, Allocator& alloc) {
 	auto ast = alloc.make<IntegerLiteral>();
-	ast->m_value = std::stoi(cst->text());
+	auto text = cst->text();
+	ast->m_value = std::stoi(std::string(text.begin(), text.end()));
 	if (cst->m_negative)
 		ast->m_value = -ast->m_value;
 	return ast;
@@ -50,7 +38,8 @@ static IntegerLiteral* convert(CST::IntegerLiteral* cst, Allocator& alloc) {
 
 static NumberLiteral* convert(CST::NumberLiteral* cst, Allocator& alloc) {
 	auto ast = alloc.make<NumberLiteral>();
-	ast->m_value = std::stof(cst->text());
+	auto text = cst->text();
+	ast->m_value = std::stof(std::string(text.begin(), text.end()));
 	if (cst->m_negative)
 		ast->m_value = -ast->m_value;
 	return ast;
@@ -58,13 +47,13 @@ static NumberLiteral* convert(CST::NumberLiteral* cst, Allocator& alloc) {
 
 static StringLiteral* convert(CST::StringLiteral* cst, Allocator& alloc) {
 	auto ast = alloc.make<StringLiteral>();
-	ast->m_text = cst->m_token->m_text;
+	ast->m_text = cst->m_token.interned();
 	return ast;
 }
 
 static BooleanLiteral* convert(CST::BooleanLiteral* cst, Allocator& alloc) {
 	auto ast = alloc.make<BooleanLiteral>();
-	ast->m_value = cst->m_token->m_type == TokenTag::KEYWORD_TRUE;
+	ast->m_value = cst->m_token.type() == TokenTag::KEYWORD_TRUE;
 	return ast;
 }
 
@@ -75,16 +64,18 @@ static NullLiteral* convert(CST::NullLiteral* cst, Allocator& alloc) {
 static ArrayLiteral* convert(CST::ArrayLiteral* cst, Allocator& alloc) {
 	auto ast = alloc.make<ArrayLiteral>();
 
+	std::vector<Expr*> elements;
 	for (auto element : cst->m_elements) {
-		ast->m_elements.push_back(convert_expr(element, alloc));
+		elements.push_back(convert_expr(element, alloc));
 	}
+	ast->m_elements = alloc.make_list(elements);
 
 	return ast;
 }
 
 static Declaration convert_declaration(CST::Declaration* cst, CST::DeclarationData& data, Allocator& alloc) {
 	Declaration decl;
-	decl.m_cst = cst;
+	decl.m_range = data.m_identifier_token.range();
 	decl.m_identifier = data.identifier();
 	if (data.m_type_hint)
 		decl.m_type_hint = convert_expr(data.m_type_hint, alloc);
@@ -93,7 +84,7 @@ static Declaration convert_declaration(CST::Declaration* cst, CST::DeclarationDa
 	return decl;
 }
 
-static std::vector<Declaration> convert_args(
+static Span<Declaration> convert_args(
     CST::FuncParameters& cst_args,
     FunctionLiteral* surrounding_function,
     Allocator& alloc) {
@@ -105,7 +96,7 @@ static std::vector<Declaration> convert_args(
 
 		result.push_back(std::move(decl));
 	}
-	return result;
+	return alloc.make_list(result);
 }
 
 static FunctionLiteral* convert(CST::FunctionLiteral* cst, Allocator& alloc) {
@@ -134,33 +125,35 @@ static CallExpression* convert_pizza(CST::BinaryExpression* cst, Allocator& allo
 
 	auto ast = alloc.make<CallExpression>();
 
-	ast->m_args.push_back(convert_expr(cst->m_lhs, alloc));
+	std::vector<Expr*> args;
+	args.push_back(convert_expr(cst->m_lhs, alloc));
 
 	auto call_cst = static_cast<CST::CallExpression*>(cst->m_rhs);
 	ast->m_callee = convert_expr(call_cst->m_callee, alloc);
 	for (auto arg : call_cst->m_args)
-		ast->m_args.push_back(convert_expr(arg, alloc));
+		args.push_back(convert_expr(arg, alloc));
+	ast->m_args = alloc.make_list(args);
 
 	return ast;
 }
 
 // convert binary operators into calls
 static CallExpression* convert(CST::BinaryExpression* cst, Allocator& alloc) {
-	if (cst->m_op_token->m_type == TokenTag::PIZZA)
+	if (cst->m_op_token.type() == TokenTag::PIZZA)
 		return convert_pizza(cst, alloc);
 
-	if (cst->m_op_token->m_type == TokenTag::DOT)
+	if (cst->m_op_token.type() == TokenTag::DOT)
 		Log::fatal("found '.' used as a binary operator");
 	
 	auto ast = alloc.make<CallExpression>();
 
 	auto identifier = alloc.make<Identifier>();
-	identifier->m_text = cst->m_op_token->m_text;
+	identifier->m_text = cst->m_op_token.interned();
 
 	ast->m_callee = identifier;
 
-	ast->m_args.push_back(convert_expr(cst->m_lhs, alloc));
-	ast->m_args.push_back(convert_expr(cst->m_rhs, alloc));
+	ast->m_args = alloc.make_list(std::vector<Expr*> {
+	    convert_expr(cst->m_lhs, alloc), convert_expr(cst->m_rhs, alloc)});
 
 	return ast;
 }
@@ -177,7 +170,7 @@ static Declaration* convert(CST::FuncDeclaration* cst, Allocator& alloc) {
 	func_ast->m_body = convert_expr(cst->m_body, alloc);
 
 	auto ast = alloc.make<Declaration>();
-	ast->m_cst = cst;
+	ast->m_range = cst->m_identifier.range();
 	ast->m_identifier = cst->identifier();
 	ast->m_value = func_ast;
 
@@ -190,7 +183,7 @@ static Declaration* convert(CST::BlockFuncDeclaration* cst, Allocator& alloc) {
 	func_ast->m_body = convert_and_wrap_in_seq(cst->m_body, alloc);
 
 	auto ast = alloc.make<Declaration>();
-	ast->m_cst = cst;
+	ast->m_range = cst->m_identifier.range();
 	ast->m_identifier = cst->identifier();
 	ast->m_value = func_ast;
 
@@ -200,27 +193,32 @@ static Declaration* convert(CST::BlockFuncDeclaration* cst, Allocator& alloc) {
 static AST* convert(CST::Program* cst, Allocator& alloc) {
 	auto ast = alloc.make<Program>();
 
+	std::vector<Declaration> declarations;
+	declarations.reserve(cst->m_declarations.size());
 	for (auto& declaration : cst->m_declarations) {
 		auto decl = static_cast<Declaration*>(convert_ast(declaration, alloc));
-		ast->m_declarations.push_back(std::move(*decl));
+		declarations.push_back(*decl);
 	}
+	ast->m_declarations = alloc.make_list(declarations);
 
 	return ast;
 }
 
 static Identifier* convert(CST::Identifier* cst, Allocator& alloc) {
 	auto ast = alloc.make<Identifier>();
-	ast->m_cst = cst;
-	ast->m_text = cst->m_token->m_text;
+	ast->m_range = cst->m_token.range();
+	ast->m_text = cst->m_token.interned();
 	return ast;
 }
 
 static CallExpression* convert(CST::CallExpression* cst, Allocator& alloc) {
 	auto ast = alloc.make<CallExpression>();
 
+	std::vector<Expr*> args;
 	for (auto arg : cst->m_args) {
-		ast->m_args.push_back(convert_expr(arg, alloc));
+		args.push_back(convert_expr(arg, alloc));
 	}
+	ast->m_args = alloc.make_list(args);
 
 	ast->m_callee = convert_expr(cst->m_callee, alloc);
 
@@ -249,7 +247,7 @@ static TernaryExpression* convert(CST::TernaryExpression* cst, Allocator& alloc)
 static AccessExpression* convert(CST::AccessExpression* cst, Allocator& alloc) {
 	auto ast = alloc.make<AccessExpression>();
 
-	ast->m_member = cst->m_member->m_text;
+	ast->m_member = cst->m_member.interned();
 	ast->m_target = convert_expr(cst->m_record, alloc);
 
 	return ast;
@@ -264,31 +262,28 @@ static MatchExpression* convert(CST::MatchExpression* cst, Allocator& alloc) {
 	if (cst->m_type_hint)
 		ast->m_type_hint = convert_expr(cst->m_type_hint, alloc);
 
-	std::unordered_map<InternedString, MatchExpression::CaseData> cases;
 	for (auto& case_data : cst->m_cases) {
-		auto case_name = case_data.m_name->m_text;
+		auto case_name = case_data.m_name.interned();
 
 		Declaration declaration;
 		// TODO: store match expression cst in declarations?
-		declaration.m_identifier = case_data.m_identifier->m_text;
+		declaration.m_identifier = case_data.m_identifier.interned();
 
 		if (case_data.m_type_hint)
 			declaration.m_type_hint = convert_expr(case_data.m_type_hint, alloc);
 
 		auto expression = convert_expr(case_data.m_expression, alloc);
 
-		auto insertion_result = cases.insert(
-		    {case_name,
-		     MatchExpression::CaseData {std::move(declaration), expression}});
+		bool inserted = ast->m_cases.insert(
+		    {case_name, MatchExpression::CaseData {declaration, expression}},
+		    alloc.m_lists);
 
-		if (!insertion_result.second) {
+		if (!inserted) {
 			// TODO: add location information
 			Log::fatal() << "Duplicate case in match expression";
 		}
 	}
 
-	ast->m_cases = std::move(cases);
-
 	return ast;
 }
 
@@ -297,8 +292,10 @@ static ConstructorExpression* convert(CST::ConstructorExpression* cst, Allocator
 
 	ast->m_constructor = convert_expr(cst->m_constructor, alloc);
 
+	std::vector<Expr*> args;
 	for (auto& arg : cst->m_args)
-		ast->m_args.push_back(convert_expr(arg, alloc));
+		args.push_back(convert_expr(arg, alloc));
+	ast->m_args = alloc.make_list(args);
 
 	return ast;
 }
@@ -312,9 +309,11 @@ static SequenceExpression* convert(CST::SequenceExpression* cst, Allocator& allo
 static Block* convert(CST::Block* cst, Allocator& alloc) {
 	auto ast = alloc.make<Block>();
 
+	std::vector<AST*> body;
 	for (auto element : cst->m_body) {
-		ast->m_body.push_back(convert_ast(element, alloc));
+		body.push_back(convert_ast(element, alloc));
 	}
+	ast->m_body = alloc.make_list(body);
 
 	return ast;
 }
@@ -348,16 +347,18 @@ to
 static Block* convert(CST::ForStatement* cst, Allocator& alloc) {
 
 	auto body = convert_ast(cst->m_body, alloc);
-	auto block_body = [&] {
-		if (body->type() == ASTTag::Block)
-			return static_cast<Block*>(body);
-		auto inner_block = alloc.make<Block>();
-		inner_block->m_body.push_back(body);
-		return inner_block;
-	}();
+	std::vector<AST*> statements;
+	if (body->type() == ASTTag::Block) {
+		auto& block_statements = static_cast<Block*>(body)->m_body;
+		statements.assign(block_statements.begin(), block_statements.end());
+	} else {
+		statements.push_back(body);
+	}
+
+	statements.push_back(convert_expr(cst->m_action, alloc));
 
-	auto action = convert_expr(cst->m_action, alloc);
-	block_body->m_body.push_back(action);
+	auto block_body = alloc.make<Block>();
+	block_body->m_body = alloc.make_list(statements);
 
 	auto while_ast = alloc.make<WhileStatement>();
 	while_ast->m_body = block_body;
@@ -367,8 +368,8 @@ static Block* convert(CST::ForStatement* cst, Allocator& alloc) {
 	auto decl = convert_declaration(nullptr, cst->m_declaration, alloc);
 	auto heap_decl = alloc.make<Declaration>();
 	*heap_decl = std::move(decl);
-	outter_block_ast->m_body.push_back(heap_decl);
-	outter_block_ast->m_body.push_back(while_ast);
+	outter_block_ast->m_body =
+	    alloc.make_list(std::vector<AST*> {heap_decl, while_ast});
 
 	return outter_block_ast;
 }
@@ -385,14 +386,18 @@ static WhileStatement* convert(CST::WhileStatement* cst, Allocator& alloc) {
 static UnionExpression* convert(CST::UnionExpression* cst, Allocator& alloc) {
 	auto ast = alloc.make<UnionExpression>();
 
+	std::vector<InternedString> constructors;
 	for (auto& constructor : cst->m_constructors) {
 		auto field_name = static_cast<CST::Identifier&>(constructor).text();
-		ast->m_constructors.push_back(field_name);
+		constructors.push_back(field_name);
 	}
+	ast->m_constructors = alloc.make_list(constructors);
 
+	std::vector<Expr*> types;
 	for (auto type : cst->m_types) {
-		ast->m_types.push_back(convert_expr(type, alloc));
+		types.push_back(convert_expr(type, alloc));
 	}
+	ast->m_types = alloc.make_list(types);
 
 	return ast;
 };
@@ -400,14 +405,18 @@ static UnionExpression* convert(CST::UnionExpression* cst, Allocator& alloc) {
 static StructExpression* convert(CST::StructExpression* cst, Allocator& alloc) {
 	auto ast = alloc.make<StructExpression>();
 
+	std::vector<InternedString> fields;
 	for (auto& cst_field : cst->m_fields) {
 		auto field_name = static_cast<CST::Identifier&>(cst_field).text();
-		ast->m_fields.push_back(field_name);
+		fields.push_back(field_name);
 	}
+	ast->m_fields = alloc.make_list(fields);
 
+	std::vector<Expr*> types;
 	for (auto type : cst->m_types) {
-		ast->m_types.push_back(convert_expr(type, alloc));
+		types.push_back(convert_expr(type, alloc));
 	}
+	ast->m_types = alloc.make_list(types);
 
 	return ast;
 };
@@ -416,9 +425,11 @@ static TypeTerm* convert(CST::TypeTerm* cst, Allocator& alloc) {
 	auto ast = alloc.make<TypeTerm>();
 
 	ast->m_callee = convert_expr(cst->m_callee, alloc);
+	std::vector<Expr*> args;
 	for (auto arg : cst->m_args){
-		ast->m_args.push_back(convert_expr(arg, alloc));
+		args.push_back(convert_expr(arg, alloc));
 	}
+	ast->m_args = alloc.make_list(args);
 
 	return ast;
 }
@@ -1,14 +1,15 @@
 #pragma once
 
 #include <string>
-#include <unordered_set>
-#include <unordered_map>
-#include <vector>
 
 #include <climits>
 #include <llvm/IR/Value.h>
 
+#include "./utils/arena_vector.hpp"
+#include "./utils/flat_map.hpp"
 #include "./utils/interned_string.hpp"
+#include "./utils/span.hpp"
+#include "source_location.hpp"
 #include "typechecker_types.hpp"
 #include "ast_tag.hpp"
 
@@ -28,10 +29,16 @@ struct AST {
 	explicit AST(ASTTag type)
 	    : m_type {type} {}
 
-	CST::CST* m_cst {nullptr};
+	// where the node comes from. Only set on identifiers and declarations,
+	// which is what error reports and the profiler need
+	SourceRange m_range {-1, -1};
 
 	[[nodiscard]] ASTTag type() const { return m_type; }
-	virtual ~AST() = default;
+
+  protected:
+	// nodes are freed with their allocator's pages, without running
+	// destructors, so they can't own anything
+	~AST() = default;
 };
 
 inline bool is_expression (AST* ast) {
@@ -61,7 +68,8 @@ struct Declaration : public AST {
 	Expr* m_type_hint {nullptr};  // can be nullptr
 	Expr* m_value {nullptr}; // can be nullptr
 
-	std::unordered_set<Declaration*> m_references;
+	// top level declarations referenced from this one
+	ArenaVector<Declaration*> m_references;
 
 	MetaTypeId m_meta_type {-1};
 	bool m_is_polymorphic {false};
@@ -77,14 +85,14 @@ struct Declaration : public AST {
 		return !m_surrounding_function && !m_surrounding_seq_expr;
 	}
 
-	InternedString const& identifier_text() const;
+	InternedString identifier_text() const;
 
 	Declaration()
 	    : AST {ASTTag::Declaration} {}
 };
 
 struct Program : public AST {
-	std::vector<Declaration> m_declarations;
+	Span<Declaration> m_declarations;
 
 	Program()
 	    : AST {ASTTag::Program} {}
@@ -115,7 +123,7 @@ struct IntegerLiteral : public Expr {
 struct StringLiteral : public Expr {
 	InternedString m_text;
 
-	[[nodiscard]] std::string const& text() const {
+	[[nodiscard]] std::string_view text() const {
 		return m_text.str();
 	}
 
@@ -137,7 +145,7 @@ struct NullLiteral : public Expr {
 };
 
 struct ArrayLiteral : public Expr {
-	std::vector<Expr*> m_elements;
+	Span<Expr*> m_elements;
 
 	ArrayLiteral()
 	    : Expr {ASTTag::ArrayLiteral} {}
@@ -152,8 +160,8 @@ struct FunctionLiteral : public Expr {
 
 	MonoId m_return_type{};
 	Expr* m_body{};
-	std::vector<Declaration> m_args;
-	std::unordered_map<InternedString, CaptureData> m_captures;
+	Span<Declaration> m_args;
+	FlatMap<InternedString, CaptureData> m_captures;
 	FunctionLiteral* m_surrounding_function {nullptr};
 
 	FunctionLiteral()
@@ -170,7 +178,6 @@ struct Identifier : public Expr {
 	Origin m_origin { Origin::Global };
 	int m_frame_offset {INT_MIN};
 
-	[[nodiscard]] Token const* token() const;
 	[[nodiscard]] InternedString const& text() const {
 		return m_text;
 	}
@@ -181,7 +188,7 @@ struct Identifier : public Expr {
 
 struct CallExpression : public Expr {
 	Expr* m_callee{};
-	std::vector<Expr*> m_args;
+	Span<Expr*> m_args;
 
 	CallExpression()
 	    : Expr {ASTTag::CallExpression} {}
@@ -220,7 +227,7 @@ struct MatchExpression : public Expr {
 
 	Identifier m_target;
 	Expr* m_type_hint {nullptr};
-	std::unordered_map<InternedString, CaseData> m_cases;
+	FlatMap<InternedString, CaseData> m_cases;
 
 	MatchExpression()
 	    : Expr {ASTTag::MatchExpression} {}
@@ -228,7 +235,7 @@ struct MatchExpression : public Expr {
 
 struct ConstructorExpression : public Expr {
 	Expr* m_constructor{};
-	std::vector<Expr*> m_args;
+	Span<Expr*> m_args;
 
 	ConstructorExpression()
 	    : Expr {ASTTag::ConstructorExpression} {}
@@ -244,7 +251,7 @@ struct SequenceExpression : public Expr {
 };
 
 struct Block : public AST {
-	std::vector<AST*> m_body;
+	Span<AST*> m_body;
 
 	Block()
 	    : AST {ASTTag::Block} {}
@@ -276,16 +283,16 @@ struct WhileStatement : public AST {
 };
 
 struct UnionExpression : public Expr {
-	std::vector<InternedString> m_constructors;
-	std::vector<Expr*> m_types;
+	Span<InternedString> m_constructors;
+	Span<Expr*> m_types;
 
 	UnionExpression()
 	    : Expr {ASTTag::UnionExpression} {}
 };
 
 struct StructExpression : public Expr {
-	std::vector<InternedString> m_fields;
-	std::vector<Expr*> m_types;
+	Span<InternedString> m_fields;
+	Span<Expr*> m_types;
 
 	StructExpression()
 	    : Expr {ASTTag::StructExpression} {}
@@ -293,7 +300,7 @@ struct StructExpression : public Expr {
 
 struct TypeTerm : public Expr {
 	Expr* m_callee{};
-	std::vector<Expr*> m_args; // should these be TypeTerms?
+	Span<Expr*> m_args; // should these be TypeTerms?
 
 	TypeTerm()
 	    : Expr {ASTTag::TypeTerm} {}
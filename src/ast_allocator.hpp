@@ -1,27 +1,28 @@
 #pragma once
 
 #include "ast.hpp"
-#include "utils/polymorphic_block_allocator.hpp"
-#include "utils/polymorphic_dumb_allocator.hpp"
+#include "utils/list_arena.hpp"
+#include "utils/node_pools.hpp"
 
 namespace AST {
 
 struct Allocator {
-	static constexpr int small_size = 56;
-	PolymorphicBlockAllocator<AST> m_small;
-	PolymorphicDumbAllocator<AST> m_big;
+	NodePools<AST> m_nodes;
+	// children lists, captures and references of every node
+	ListArena m_lists;
 
 	Allocator()
-	    : m_small(small_size, 4 * 4096)
-	    , m_big {4 * 4096} {}
+	    : m_nodes {}
+	    , m_lists {} {}
 
 	template<typename T>
 	T* make() {
-		if (small_size < sizeof(T)) {
-			return m_big.make<T>();
-		} else {
-			return m_small.make<T>();
-		}
+		return m_nodes.make<T>();
+	}
+
+	template<typename T>
+	Span<T> make_list(std::vector<T> const& elements) {
+		return m_lists.make(elements);
 	}
 };
 
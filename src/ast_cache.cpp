@@ -0,0 +1,1113 @@
+#include "ast_cache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+
+#include "ast.hpp"
+#include "ast_allocator.hpp"
+#include "typechecker.hpp"
+
+// Layout of an image. Every count and index is 32 bits, and indices are -1
+// for nothing:
+//
+//     header          magic, hash of the frontend, hash of the source
+//     strings         length and bytes of each
+//     type functions  how to make each one. The builtins are reused
+//     monotypes       vars, and terms of earlier monotypes
+//     structures      the fields of each type function, in the same order
+//     polytypes       base monotype and variables
+//     nodes           tag of each node, and where it lives if it's inside
+//                     another one (the declarations of a program, the
+//                     arguments of a function, and the target and cases of a
+//                     match), with how many nodes live inside it
+//     order           components of declarations
+//     bodies          fields of each node
+//
+// Nodes are numbered in the order they are reached from the program, so
+// nodes that live inside another one come after it.
+
+namespace AST {
+
+static constexpr char cache_magic[8] = {'J', 'A', 'S', 'P', 'A', 'S', 'T', '\0'};
+// bump when the layout or the nodes change. Changes to the builtins are
+// picked up by frontend_hash() on their own
+static constexpr uint32_t cache_version = 3;
+
+static uint64_t fnv1a(string_view data) {
+	uint64_t hash = 0xcbf29ce484222325;
+	for (auto it = data.cbegin(); it != data.cend(); ++it) {
+		hash ^= static_cast<unsigned char>(*it);
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+template <typename T>
+static void put(std::string& out, T value) {
+	static_assert(std::is_trivially_copyable<T>::value);
+	out.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+// last valid value of the enums that are read from an image
+template <typename T>
+constexpr T last_value;
+template <>
+constexpr Identifier::Origin last_value<Identifier::Origin> = Identifier::Origin::Local;
+template <>
+constexpr TypeFunctionTag last_value<TypeFunctionTag> = TypeFunctionTag::Record;
+
+struct NodeEntry {
+	ASTTag tag;
+	// index of the node this one lives inside, and its position in it.
+	// Position -1 is the target of a match
+	int parent {-1};
+	int slot {0};
+	// how many nodes live inside this one
+	int count {0};
+};
+
+// Images refer to builtin declarations by name, and to builtin type
+// functions by their index in the typechecker, so they are only valid for
+// the builtins they were written with. This hashes the layout version with
+// the names and types of every builtin, as a fresh typechecker makes them.
+static uint64_t frontend_hash() {
+	static uint64_t const hash = [] {
+		Allocator allocator;
+		TypeChecker::TypeChecker tc {allocator};
+		auto& core = tc.m_core;
+
+		std::string key;
+		put(key, cache_version);
+		put(key, uint32_t(sizeof(NodeEntry)));
+
+		auto type_function = [&](TypeFunctionId tf) {
+			tf = core.m_tf_core.find(tf);
+			int data_idx = core.m_tf_core.is_var(tf) ? -1 : core.m_tf_core.find_function(tf);
+			put(key, data_idx);
+			if (data_idx == -1)
+				return;
+			auto const& data = core.m_type_functions[data_idx];
+			put(key, data.tag);
+			put(key, data.argument_count);
+			put(key, data.is_dummy);
+		};
+
+		auto mono = [&](auto& self, MonoId id) -> void {
+			auto& mono_core = core.m_mono_core;
+			id = mono_core.find(id);
+			put(key, id);
+			if (!mono_core.is_term(id))
+				return;
+			type_function(mono_core.find_function(id));
+			for (MonoId arg : mono_core.arguments(mono_core.find_term(id)))
+				self(self, arg);
+		};
+
+		tc.m_builtin_declarations.for_each([&](Declaration& decl) {
+			key += decl.m_identifier.str();
+			key += '\0';
+			put(key, decl.m_is_polymorphic);
+			if (decl.m_is_polymorphic) {
+				auto const& data = core.poly_data[decl.m_decl_type];
+				mono(mono, data.base);
+				put(key, int(data.vars.size()));
+				for (MonoId var : data.vars)
+					mono(mono, var);
+			} else if (decl.m_value && decl.m_value->type() == ASTTag::TypeFunctionHandle) {
+				type_function(static_cast<TypeFunctionHandle*>(decl.m_value)->m_value);
+			}
+		});
+
+		return fnv1a(key);
+	}();
+	return hash;
+}
+
+static void transfer_node(auto& a, AST* ast) {
+	a.value(ast->m_range);
+}
+
+static void transfer_expr(auto& a, Expr* ast) {
+	transfer_node(a, ast);
+	a.mono(ast->m_value_type);
+}
+
+static void transfer(auto& a, Declaration* ast) {
+	transfer_node(a, ast);
+	a.string(ast->m_identifier);
+	a.node(ast->m_type_hint);
+	a.node(ast->m_value);
+	a.references(ast->m_references);
+	a.value(ast->m_is_polymorphic);
+	a.mono(ast->m_value_type);
+	if (ast->m_is_polymorphic)
+		a.poly(ast->m_decl_type);
+	a.value(ast->m_frame_offset);
+	a.link(ast->m_surrounding_function);
+	a.link(ast->m_surrounding_seq_expr);
+}
+
+static void transfer(auto& a, Program* ast) {
+	transfer_node(a, ast);
+	a.embedded(ast->m_declarations);
+}
+
+static void transfer(auto& a, NumberLiteral* ast) {
+	transfer_expr(a, ast);
+	a.value(ast->m_value);
+}
+
+static void transfer(auto& a, IntegerLiteral* ast) {
+	transfer_expr(a, ast);
+	a.value(ast->m_value);
+}
+
+static void transfer(auto& a, StringLiteral* ast) {
+	transfer_expr(a, ast);
+	a.string(ast->m_text);
+}
+
+static void transfer(auto& a, BooleanLiteral* ast) {
+	transfer_expr(a, ast);
+	a.value(ast->m_value);
+}
+
+static void transfer(auto& a, NullLiteral* ast) {
+	transfer_expr(a, ast);
+}
+
+static void transfer(auto& a, ArrayLiteral* ast) {
+	transfer_expr(a, ast);
+	a.nodes(ast->m_elements);
+}
+
+static void transfer(auto& a, FunctionLiteral* ast) {
+	transfer_expr(a, ast);
+	a.mono(ast->m_return_type);
+	a.embedded(ast->m_args);
+	a.node(ast->m_body);
+	a.captures(ast->m_captures);
+	a.link(ast->m_surrounding_function);
+}
+
+static void transfer(auto& a, Identifier* ast) {
+	transfer_expr(a, ast);
+	a.string(ast->m_text);
+	a.link(ast->m_declaration);
+	a.link(ast->m_surrounding_function);
+	a.value(ast->m_origin);
+	a.value(ast->m_frame_offset);
+}
+
+static void transfer(auto& a, CallExpression* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_callee);
+	a.nodes(ast->m_args);
+}
+
+static void transfer(auto& a, IndexExpression* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_callee);
+	a.node(ast->m_index);
+}
+
+static void transfer(auto& a, AccessExpression* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_target);
+	a.string(ast->m_member);
+}
+
+static void transfer(auto& a, TernaryExpression* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_condition);
+	a.node(ast->m_then_expr);
+	a.node(ast->m_else_expr);
+}
+
+static void transfer(auto& a, MatchExpression* ast) {
+	transfer_expr(a, ast);
+	a.embedded(ast->m_target);
+	a.node(ast->m_type_hint);
+	a.cases(ast->m_cases);
+}
+
+static void transfer(auto& a, ConstructorExpression* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_constructor);
+	a.nodes(ast->m_args);
+}
+
+static void transfer(auto& a, SequenceExpression* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_body);
+}
+
+static void transfer(auto& a, Block* ast) {
+	transfer_node(a, ast);
+	a.nodes(ast->m_body);
+}
+
+static void transfer(auto& a, ReturnStatement* ast) {
+	transfer_node(a, ast);
+	a.node(ast->m_value);
+	a.link(ast->m_surrounding_seq_expr);
+}
+
+static void transfer(auto& a, IfElseStatement* ast) {
+	transfer_node(a, ast);
+	a.node(ast->m_condition);
+	a.node(ast->m_body);
+	a.node(ast->m_else_body);
+}
+
+static void transfer(auto& a, WhileStatement* ast) {
+	transfer_node(a, ast);
+	a.node(ast->m_condition);
+	a.node(ast->m_body);
+}
+
+static void transfer(auto& a, UnionExpression* ast) {
+	transfer_expr(a, ast);
+	a.strings(ast->m_constructors);
+	a.nodes(ast->m_types);
+}
+
+static void transfer(auto& a, StructExpression* ast) {
+	transfer_expr(a, ast);
+	a.strings(ast->m_fields);
+	a.nodes(ast->m_types);
+}
+
+static void transfer(auto& a, TypeTerm* ast) {
+	transfer_expr(a, ast);
+	a.node(ast->m_callee);
+	a.nodes(ast->m_args);
+}
+
+static void transfer(auto& a, TypeFunctionHandle* ast) {
+	transfer_expr(a, ast);
+	a.type_function(ast->m_value);
+	a.node(ast->m_syntax);
+}
+
+static void transfer(auto& a, MonoTypeHandle* ast) {
+	transfer_expr(a, ast);
+	a.mono(ast->m_value);
+	a.node(ast->m_syntax);
+}
+
+static void transfer(auto& a, Constructor* ast) {
+	transfer_expr(a, ast);
+	a.mono(ast->m_mono);
+	a.string(ast->m_id);
+	a.node(ast->m_syntax);
+}
+
+#define AST_CACHE_NODES                                                        \
+	X(NumberLiteral)                                                           \
+	X(IntegerLiteral)                                                          \
+	X(StringLiteral)                                                           \
+	X(BooleanLiteral)                                                          \
+	X(NullLiteral)                                                             \
+	X(ArrayLiteral)                                                            \
+	X(FunctionLiteral)                                                         \
+	X(Identifier)                                                              \
+	X(CallExpression)                                                          \
+	X(IndexExpression)                                                         \
+	X(AccessExpression)                                                        \
+	X(MatchExpression)                                                         \
+	X(TernaryExpression)                                                       \
+	X(ConstructorExpression)                                                   \
+	X(SequenceExpression)                                                      \
+	X(UnionExpression)                                                         \
+	X(StructExpression)                                                        \
+	X(TypeTerm)                                                                \
+	X(TypeFunctionHandle)                                                      \
+	X(MonoTypeHandle)                                                          \
+	X(Constructor)                                                             \
+	X(Block)                                                                   \
+	X(ReturnStatement)                                                         \
+	X(IfElseStatement)                                                         \
+	X(WhileStatement)                                                          \
+	X(Program)                                                                 \
+	X(Declaration)
+
+static void transfer_any(auto& a, AST* ast) {
+#define X(type)                                                                \
+	case ASTTag::type:                                                         \
+		return transfer(a, static_cast<type*>(ast));
+
+	switch (ast->type()) { AST_CACHE_NODES }
+
+#undef X
+}
+
+static AST* make_node(ASTTag tag, Allocator& allocator) {
+#define X(type)                                                                \
+	case ASTTag::type:                                                         \
+		return allocator.make<type>();
+
+	switch (tag) { AST_CACHE_NODES }
+
+#undef X
+	return nullptr;
+}
+
+// whether the node is a T
+template <typename T>
+static bool is_a(AST* ast) {
+	if constexpr (std::is_same_v<T, AST>)
+		return true;
+	else if constexpr (std::is_same_v<T, Expr>)
+		return is_expression(ast);
+#define X(node)                                                                \
+	else if constexpr (std::is_same_v<T, node>)                                \
+		return ast->type() == ASTTag::node;
+
+	AST_CACHE_NODES
+
+#undef X
+	else
+		static_assert(!sizeof(T), "not a node type");
+}
+
+#undef AST_CACHE_NODES
+
+struct CacheWriter {
+	TypeChecker::TypeChecker& m_tc;
+	std::unordered_map<Declaration*, InternedString> m_builtins {};
+
+	std::unordered_map<char const*, int> m_string_ids {};
+	std::string m_strings {};
+
+	// indices into TypeSystemCore::m_type_functions, in table order
+	std::vector<int> m_type_function_data {};
+	std::unordered_map<int, int> m_type_function_ids {};
+	std::string m_type_functions {};
+
+	std::unordered_map<MonoId, int> m_mono_ids {};
+	int m_mono_count {0};
+	std::string m_monos {};
+
+	std::unordered_map<PolyId, int> m_poly_ids {};
+	std::string m_polys {};
+
+	std::unordered_map<AST*, int> m_node_ids {};
+	std::vector<AST*> m_queue {};
+	std::vector<NodeEntry> m_entries {};
+	// where the bodies link to nodes that weren't numbered yet
+	std::vector<std::pair<size_t, AST*>> m_links {};
+	int m_current {0};
+	std::string m_bodies {};
+
+	explicit CacheWriter(TypeChecker::TypeChecker& tc)
+	    : m_tc {tc} {
+		m_tc.m_builtin_declarations.for_each([&](Declaration& decl) {
+			m_builtins[&decl] = decl.m_identifier;
+		});
+	}
+
+	int string_id(InternedString const& str) {
+		if (str.is_null())
+			return -1;
+		auto it = m_string_ids.find(str.c_str());
+		if (it != m_string_ids.end())
+			return it->second;
+
+		int id = m_string_ids.size();
+		m_string_ids[str.c_str()] = id;
+		auto text = str.str();
+		put(m_strings, uint32_t(text.size()));
+		m_strings.append(text.data(), text.size());
+		return id;
+	}
+
+	int type_function_id(TypeFunctionId tf) {
+		auto& core = m_tc.m_core;
+		tf = core.m_tf_core.find(tf);
+		if (core.m_tf_core.is_var(tf))
+			return -1;
+
+		int data_idx = core.m_tf_core.find_function(tf);
+		auto it = m_type_function_ids.find(data_idx);
+		if (it != m_type_function_ids.end())
+			return it->second;
+
+		int id = m_type_function_data.size();
+		m_type_function_ids[data_idx] = id;
+		m_type_function_data.push_back(data_idx);
+
+		auto const& data = core.m_type_functions[data_idx];
+		bool builtin = data.tag == TypeFunctionTag::Builtin && !data.is_dummy;
+		put(m_type_functions, builtin ? data_idx : -1);
+		put(m_type_functions, data.tag);
+		put(m_type_functions, data.argument_count);
+		put(m_type_functions, data.is_dummy);
+		put(m_type_functions, int(data.fields.size()));
+		for (auto const& field : data.fields)
+			put(m_type_functions, string_id(field));
+		return id;
+	}
+
+	int mono_id(MonoId mono) {
+		if (mono < 0)
+			return -1;
+
+		auto& core = m_tc.m_core.m_mono_core;
+		mono = core.find(mono);
+		auto it = m_mono_ids.find(mono);
+		if (it != m_mono_ids.end())
+			return it->second;
+
+		// arguments go first, so they are made first when reading
+		int tf = -1;
+		std::vector<int> args;
+		if (core.is_term(mono)) {
+			tf = type_function_id(core.find_function(mono));
+			for (MonoId arg : core.arguments(core.find_term(mono)))
+				args.push_back(mono_id(arg));
+		}
+
+		int id = m_mono_count++;
+		m_mono_ids[mono] = id;
+		put(m_monos, core.is_term(mono));
+		if (core.is_term(mono)) {
+			put(m_monos, tf);
+			put(m_monos, int(args.size()));
+			for (int arg : args)
+				put(m_monos, arg);
+		}
+		return id;
+	}
+
+	int poly_id(PolyId poly) {
+		auto it = m_poly_ids.find(poly);
+		if (it != m_poly_ids.end())
+			return it->second;
+
+		auto const& data = m_tc.m_core.poly_data[poly];
+		std::string entry;
+		put(entry, mono_id(data.base));
+		for (auto const* vars : {&data.vars, &data.origin_vars}) {
+			put(entry, int(vars->size()));
+			for (MonoId var : *vars)
+				put(entry, mono_id(var));
+		}
+
+		int id = m_poly_ids.size();
+		m_poly_ids[poly] = id;
+		m_polys += entry;
+		return id;
+	}
+
+	int add_node(AST* ast, int parent, int slot) {
+		assert(!m_node_ids.count(ast));
+		int id = m_entries.size();
+		m_node_ids[ast] = id;
+		m_entries.push_back({ast->type(), parent, slot, 0});
+		m_queue.push_back(ast);
+		return id;
+	}
+
+	// -1 for null, and INT_MIN for nodes that weren't reached yet
+	int node_id(AST* ast) {
+		if (!ast)
+			return -1;
+
+		if (ast->type() == ASTTag::Declaration) {
+			auto builtin = m_builtins.find(static_cast<Declaration*>(ast));
+			if (builtin != m_builtins.end())
+				return -2 - string_id(builtin->second);
+		}
+
+		auto it = m_node_ids.find(ast);
+		return it == m_node_ids.end() ? INT_MIN : it->second;
+	}
+
+	// Nodes are numbered when they are reached through the tree, as the
+	// ones that live inside another are only found when that is written.
+	// Links elsewhere can get to a node before that (e.g. the references of
+	// a declaration include the arguments of its function), so they are
+	// filled in once everything is numbered
+	void write_nodes(Program* program) {
+		add_node(program, -1, 0);
+		size_t next_link = 0;
+		for (size_t i = 0; i < m_queue.size(); ++i) {
+			m_current = i;
+			transfer_any(*this, m_queue[i]);
+
+			// linked nodes that aren't in the tree
+			for (; i + 1 == m_queue.size() && next_link < m_links.size(); ++next_link)
+				if (!m_node_ids.count(m_links[next_link].second))
+					add_node(m_links[next_link].second, -1, 0);
+		}
+
+		for (auto const& [offset, ast] : m_links) {
+			int id = m_node_ids[ast];
+			memcpy(&m_bodies[offset], &id, sizeof(id));
+		}
+	}
+
+	// the structure of a type function can refer to more type functions,
+	// which are added to the table as we go
+	std::string write_structures() {
+		std::string out;
+		for (size_t i = 0; i < m_type_function_data.size(); ++i) {
+			auto const& structure = m_tc.m_core.m_type_functions[m_type_function_data[i]].structure;
+			put(out, int(structure.size()));
+			for (auto const& kv : structure) {
+				put(out, string_id(kv.first));
+				put(out, mono_id(kv.second));
+			}
+		}
+		return out;
+	}
+
+	template <typename T>
+	void value(T& value) {
+		put(m_bodies, value);
+	}
+
+	void string(InternedString& str) {
+		put(m_bodies, string_id(str));
+	}
+
+	void strings(Span<InternedString>& list) {
+		put(m_bodies, list.size());
+		for (auto& str : list)
+			string(str);
+	}
+
+	// a child in the tree
+	template <typename T>
+	void node(T*& ast) {
+		int id = node_id(ast);
+		if (id == INT_MIN)
+			id = add_node(ast, -1, 0);
+		put(m_bodies, id);
+	}
+
+	// a pointer to a node elsewhere in the tree
+	template <typename T>
+	void link(T*& ast) {
+		int id = node_id(ast);
+		if (id == INT_MIN)
+			m_links.push_back({m_bodies.size(), ast});
+		put(m_bodies, id);
+	}
+
+	template <typename T>
+	void nodes(Span<T*>& list) {
+		put(m_bodies, list.size());
+		for (auto& ast : list)
+			node(ast);
+	}
+
+	void references(ArenaVector<Declaration*>& list) {
+		put(m_bodies, list.size());
+		for (auto& decl : list)
+			link(decl);
+	}
+
+	void embedded(Span<Declaration>& list) {
+		m_entries[m_current].count = list.size();
+		for (int i = 0; i < list.size(); ++i)
+			add_node(&list[i], m_current, i);
+	}
+
+	void embedded(Identifier& target) {
+		add_node(&target, m_current, -1);
+	}
+
+	void captures(FlatMap<InternedString, FunctionLiteral::CaptureData>& captures) {
+		put(m_bodies, captures.size());
+		for (auto& capture : captures) {
+			string(capture.first);
+			link(capture.second.outer_declaration);
+			value(capture.second.outer_frame_offset);
+			value(capture.second.inner_frame_offset);
+		}
+	}
+
+	void cases(FlatMap<InternedString, MatchExpression::CaseData>& cases) {
+		int const parent = m_current;
+		m_entries[parent].count = cases.size();
+		int slot = 0;
+		for (auto& kv : cases) {
+			add_node(&kv.second.m_declaration, parent, slot++);
+			string(kv.first);
+			node(kv.second.m_expression);
+		}
+	}
+
+	void mono(MonoId& mono) {
+		put(m_bodies, mono_id(mono));
+	}
+
+	void poly(PolyId& poly) {
+		put(m_bodies, poly_id(poly));
+	}
+
+	void type_function(TypeFunctionId& tf) {
+		put(m_bodies, type_function_id(tf));
+	}
+};
+
+bool write_cache(
+    std::string const& path,
+    string_view source,
+    Program* program,
+    std::vector<std::vector<Declaration*>> const& declaration_order,
+    TypeChecker::TypeChecker& tc) {
+
+	CacheWriter writer {tc};
+	writer.write_nodes(program);
+
+	std::string order;
+	put(order, int(declaration_order.size()));
+	for (auto const& component : declaration_order) {
+		put(order, int(component.size()));
+		for (auto decl : component)
+			put(order, writer.node_id(decl));
+	}
+
+	std::string structures = writer.write_structures();
+
+	std::string nodes;
+	for (auto const& entry : writer.m_entries)
+		put(nodes, entry);
+
+	// written next to the destination, and moved over it once it's complete,
+	// so that a program starting meanwhile never reads half of an image
+	std::string const temporary = path + ".tmp";
+	{
+		std::ofstream out {temporary, std::ios::binary | std::ios::trunc};
+		auto section = [&](int count, std::string const& data) {
+			out.write(reinterpret_cast<char const*>(&count), sizeof(count));
+			out.write(data.data(), data.size());
+		};
+
+		out.write(cache_magic, sizeof(cache_magic));
+		uint64_t const frontend = frontend_hash();
+		uint64_t const hash = fnv1a(source);
+		out.write(reinterpret_cast<char const*>(&frontend), sizeof(frontend));
+		out.write(reinterpret_cast<char const*>(&hash), sizeof(hash));
+
+		section(writer.m_string_ids.size(), writer.m_strings);
+		section(writer.m_type_function_data.size(), writer.m_type_functions);
+		section(writer.m_mono_count, writer.m_monos);
+		out.write(structures.data(), structures.size());
+		section(writer.m_poly_ids.size(), writer.m_polys);
+		section(writer.m_entries.size(), nodes);
+		out.write(order.data(), order.size());
+		out.write(writer.m_bodies.data(), writer.m_bodies.size());
+
+		if (!out)
+			return false;
+	}
+
+	return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// Reads an image in two passes over its nodes: the first one makes all of
+// them, so that the second one can fill in pointers to any of them.
+//
+// Anything out of range marks the image as malformed, and reads as zeros or
+// nulls from then on. That includes links to nodes of the wrong kind, and
+// enums and booleans with values they can't have
+struct CacheReader {
+	char const* m_cursor;
+	char const* m_end;
+	bool m_failed {false};
+
+	Allocator& m_allocator;
+	TypeChecker::TypeChecker& m_tc;
+	std::unordered_map<InternedString, Declaration*> m_builtins {};
+
+	std::vector<InternedString> m_strings {};
+	std::vector<TypeFunctionId> m_type_functions {};
+	std::vector<MonoId> m_monos {};
+	std::vector<PolyId> m_polys {};
+	std::vector<AST*> m_nodes {};
+
+	CacheReader(string_view image, Allocator& allocator, TypeChecker::TypeChecker& tc)
+	    : m_cursor {image.cbegin()}
+	    , m_end {image.cend()}
+	    , m_allocator {allocator}
+	    , m_tc {tc} {
+		m_tc.m_builtin_declarations.for_each([&](Declaration& decl) {
+			m_builtins[decl.m_identifier] = &decl;
+		});
+	}
+
+	template <typename T>
+	T get() {
+		if constexpr (std::is_same_v<T, bool>) {
+			auto byte = get<unsigned char>();
+			if (byte > 1)
+				m_failed = true;
+			return byte == 1;
+		} else if constexpr (std::is_enum_v<T>) {
+			using Underlying = std::underlying_type_t<T>;
+			auto raw = get<Underlying>();
+			if (raw < 0 || raw > Underlying(last_value<T>)) {
+				m_failed = true;
+				return T {};
+			}
+			return T(raw);
+		} else {
+			T result {};
+			if (m_end - m_cursor < ptrdiff_t(sizeof(T))) {
+				m_failed = true;
+				return result;
+			}
+			memcpy(&result, m_cursor, sizeof(T));
+			m_cursor += sizeof(T);
+			return result;
+		}
+	}
+
+	// a count of things that take at least `size` bytes each
+	int get_count(size_t size) {
+		int count = get<int>();
+		if (count < 0 || size_t(m_end - m_cursor) / size < size_t(count)) {
+			m_failed = true;
+			return 0;
+		}
+		return count;
+	}
+
+	// an index into `table`, or -1
+	template <typename T>
+	T lookup(std::vector<T> const& table, T none) {
+		int id = get<int>();
+		if (id == -1)
+			return none;
+		if (id < 0 || id >= int(table.size())) {
+			m_failed = true;
+			return none;
+		}
+		return table[id];
+	}
+
+	bool read_header() {
+		char magic[sizeof(cache_magic)];
+		for (char& c : magic)
+			c = get<char>();
+		uint64_t frontend = get<uint64_t>();
+		get<uint64_t>();
+		return !m_failed && memcmp(magic, cache_magic, sizeof(magic)) == 0 &&
+		       frontend == frontend_hash();
+	}
+
+	void read_strings() {
+		int count = get_count(sizeof(uint32_t));
+		for (int i = 0; i < count && !m_failed; ++i) {
+			uint32_t length = get<uint32_t>();
+			if (size_t(m_end - m_cursor) < length) {
+				m_failed = true;
+				return;
+			}
+			m_strings.push_back(InternedString(m_cursor, length));
+			m_cursor += length;
+		}
+	}
+
+	void read_types() {
+		auto& core = m_tc.m_core;
+
+		int tf_count = get_count(sizeof(int));
+		for (int i = 0; i < tf_count && !m_failed; ++i) {
+			int builtin = get<int>();
+			auto tag = get<TypeFunctionTag>();
+			int argument_count = get<int>();
+			bool is_dummy = get<bool>();
+			std::vector<InternedString> fields(get_count(sizeof(int)));
+			for (auto& field : fields)
+				field = lookup(m_strings, InternedString {});
+
+			if (builtin >= 0) {
+				if (builtin >= int(core.m_type_functions.size()) ||
+				    core.m_type_functions[builtin].tag != TypeFunctionTag::Builtin ||
+				    core.m_type_functions[builtin].is_dummy) {
+					m_failed = true;
+					return;
+				}
+				m_type_functions.push_back(core.m_tf_core.new_term(builtin));
+			} else {
+				TypeFunctionId tf = core.new_type_function(tag, std::move(fields), {}, is_dummy);
+				core.m_type_functions[core.m_tf_core.find_function(tf)].argument_count = argument_count;
+				m_type_functions.push_back(tf);
+			}
+		}
+
+		int mono_count = get_count(sizeof(bool));
+		for (int i = 0; i < mono_count && !m_failed; ++i) {
+			if (!get<bool>()) {
+				m_monos.push_back(core.m_mono_core.new_var());
+				continue;
+			}
+
+			TypeFunctionId tf = lookup(m_type_functions, -1);
+			if (tf == -1)
+				tf = core.m_tf_core.new_var();
+			std::vector<MonoId> args(get_count(sizeof(int)));
+			for (auto& arg : args)
+				arg = lookup(m_monos, -1);
+			if (std::find(args.begin(), args.end(), -1) != args.end())
+				m_failed = true;
+			m_monos.push_back(core.m_mono_core.new_term(tf, std::move(args)));
+		}
+
+		for (TypeFunctionId tf : m_type_functions) {
+			auto& structure = core.m_type_functions[core.m_tf_core.find_function(tf)].structure;
+			int count = get_count(2 * sizeof(int));
+			for (int i = 0; i < count; ++i) {
+				auto field = lookup(m_strings, InternedString {});
+				structure[field] = lookup(m_monos, -1);
+			}
+		}
+
+		int poly_count = get_count(3 * sizeof(int));
+		for (int i = 0; i < poly_count && !m_failed; ++i) {
+			MonoId base = lookup(m_monos, -1);
+			std::vector<MonoId> vars(get_count(sizeof(int)));
+			for (auto& var : vars)
+				var = lookup(m_monos, -1);
+			std::vector<MonoId> origin_vars(get_count(sizeof(int)));
+			for (auto& var : origin_vars)
+				var = lookup(m_monos, -1);
+
+			PolyId poly = core.new_poly(base, std::move(vars));
+			core.poly_data[poly].origin_vars = std::move(origin_vars);
+			m_polys.push_back(poly);
+		}
+	}
+
+	// where a node that lives inside another one is
+	AST* embedded_node(AST* parent, int slot, ASTTag tag) {
+		if (parent->type() == ASTTag::Program && tag == ASTTag::Declaration) {
+			auto& list = static_cast<Program*>(parent)->m_declarations;
+			if (slot >= 0 && slot < list.size())
+				return &list[slot];
+		} else if (parent->type() == ASTTag::FunctionLiteral && tag == ASTTag::Declaration) {
+			auto& list = static_cast<FunctionLiteral*>(parent)->m_args;
+			if (slot >= 0 && slot < list.size())
+				return &list[slot];
+		} else if (parent->type() == ASTTag::MatchExpression) {
+			auto match = static_cast<MatchExpression*>(parent);
+			if (slot == -1 && tag == ASTTag::Identifier)
+				return &match->m_target;
+			if (slot >= 0 && slot < match->m_cases.size() && tag == ASTTag::Declaration)
+				return &match->m_cases.m_entries[slot].second.m_declaration;
+		}
+		return nullptr;
+	}
+
+	// makes room for the nodes that live inside this one
+	bool make_embedded(AST* ast, int count) {
+		if (count == 0)
+			return true;
+
+		switch (ast->type()) {
+		case ASTTag::Program:
+			static_cast<Program*>(ast)->m_declarations =
+			    m_allocator.make_list(std::vector<Declaration>(count));
+			return true;
+		case ASTTag::FunctionLiteral:
+			static_cast<FunctionLiteral*>(ast)->m_args =
+			    m_allocator.make_list(std::vector<Declaration>(count));
+			return true;
+		case ASTTag::MatchExpression:
+			for (int i = 0; i < count; ++i)
+				static_cast<MatchExpression*>(ast)->m_cases.m_entries.push_back(
+				    {InternedString {}, {Declaration {}, nullptr}}, m_allocator.m_lists);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void read_nodes() {
+		int count = get_count(sizeof(NodeEntry));
+		for (int i = 0; i < count && !m_failed; ++i) {
+			auto entry = get<NodeEntry>();
+			if (int(entry.tag) < 0 || size_t(entry.tag) >= std::size(ast_string) ||
+			    entry.parent < -1 || entry.parent >= i) {
+				m_failed = true;
+				return;
+			}
+
+			AST* ast = entry.parent == -1
+			    ? make_node(entry.tag, m_allocator)
+			    : embedded_node(m_nodes[entry.parent], entry.slot, entry.tag);
+			if (!ast || entry.count < 0 || !make_embedded(ast, entry.count)) {
+				m_failed = true;
+				return;
+			}
+			m_nodes.push_back(ast);
+		}
+	}
+
+	void read_order(std::vector<std::vector<Declaration*>>& declaration_order) {
+		declaration_order.resize(get_count(sizeof(int)));
+		for (auto& component : declaration_order) {
+			component.resize(get_count(sizeof(int)));
+			for (auto& decl : component)
+				link(decl);
+		}
+	}
+
+	Program* read(std::vector<std::vector<Declaration*>>& declaration_order) {
+		if (!read_header())
+			return nullptr;
+
+		read_strings();
+		read_types();
+		read_nodes();
+		if (m_failed || m_nodes.empty() || m_nodes[0]->type() != ASTTag::Program)
+			return nullptr;
+
+		read_order(declaration_order);
+		for (AST* ast : m_nodes)
+			transfer_any(*this, ast);
+
+		if (m_failed || m_cursor != m_end)
+			return nullptr;
+		return static_cast<Program*>(m_nodes[0]);
+	}
+
+	template <typename T>
+	void value(T& value) {
+		value = get<T>();
+	}
+
+	void string(InternedString& str) {
+		str = lookup(m_strings, InternedString {});
+	}
+
+	void strings(Span<InternedString>& list) {
+		std::vector<InternedString> elements(get_count(sizeof(int)));
+		for (auto& str : elements)
+			string(str);
+		list = m_allocator.make_list(elements);
+	}
+
+	template <typename T>
+	void node(T*& ast) {
+		ast = nullptr;
+		int id = get<int>();
+		AST* found = nullptr;
+		if (id == -1) {
+			return;
+		} else if (id < -1) {
+			// a builtin declaration, by name
+			int name = -2 - id;
+			auto it = name < int(m_strings.size()) ? m_builtins.find(m_strings[name])
+			                                       : m_builtins.end();
+			if (it != m_builtins.end())
+				found = it->second;
+		} else if (id < int(m_nodes.size())) {
+			found = m_nodes[id];
+		}
+
+		if (!found || !is_a<T>(found)) {
+			m_failed = true;
+			return;
+		}
+		ast = static_cast<T*>(found);
+	}
+
+	template <typename T>
+	void link(T*& ast) {
+		node(ast);
+	}
+
+	template <typename T>
+	void nodes(Span<T*>& list) {
+		std::vector<T*> elements(get_count(sizeof(int)));
+		for (auto& ast : elements)
+			node(ast);
+		list = m_allocator.make_list(elements);
+	}
+
+	void references(ArenaVector<Declaration*>& list) {
+		int count = get_count(sizeof(int));
+		for (int i = 0; i < count; ++i) {
+			Declaration* decl;
+			link(decl);
+			list.push_back(decl, m_allocator.m_lists);
+		}
+	}
+
+	void embedded(Span<Declaration>&) {}
+
+	void embedded(Identifier&) {}
+
+	void captures(FlatMap<InternedString, FunctionLiteral::CaptureData>& captures) {
+		int count = get_count(4 * sizeof(int));
+		for (int i = 0; i < count; ++i) {
+			FlatMap<InternedString, FunctionLiteral::CaptureData>::Entry entry;
+			string(entry.first);
+			link(entry.second.outer_declaration);
+			value(entry.second.outer_frame_offset);
+			value(entry.second.inner_frame_offset);
+			captures.insert(entry, m_allocator.m_lists);
+		}
+	}
+
+	void cases(FlatMap<InternedString, MatchExpression::CaseData>& cases) {
+		for (auto& kv : cases) {
+			string(kv.first);
+			node(kv.second.m_expression);
+		}
+	}
+
+	void mono(MonoId& mono) {
+		mono = lookup(m_monos, -1);
+	}
+
+	void poly(PolyId& poly) {
+		poly = lookup(m_polys, -1);
+		if (poly == -1)
+			m_failed = true;
+	}
+
+	void type_function(TypeFunctionId& tf) {
+		tf = lookup(m_type_functions, -1);
+		if (tf == -1)
+			tf = m_tc.m_core.m_tf_core.new_var();
+	}
+};
+
+bool is_cache_for(string_view image, string_view source) {
+	size_t const header_size = sizeof(cache_magic) + 2 * sizeof(uint64_t);
+	if (size_t(image.size()) < header_size)
+		return false;
+
+	char const* data = image.cbegin();
+	uint64_t frontend;
+	uint64_t hash;
+	memcpy(&frontend, data + sizeof(cache_magic), sizeof(frontend));
+	memcpy(&hash, data + sizeof(cache_magic) + sizeof(frontend), sizeof(hash));
+	return memcmp(data, cache_magic, sizeof(cache_magic)) == 0 &&
+	       frontend == frontend_hash() && hash == fnv1a(source);
+}
+
+Program* read_cache(
+    string_view image,
+    Allocator& allocator,
+    TypeChecker::TypeChecker& tc,
+    std::vector<std::vector<Declaration*>>& declaration_order) {
+	CacheReader reader {image, allocator, tc};
+	return reader.read(declaration_order);
+}
+
+} // namespace AST
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "utils/string_view.hpp"
+
+namespace TypeChecker {
+struct TypeChecker;
+}
+
+namespace AST {
+
+struct Allocator;
+struct Declaration;
+struct Program;
+
+// Binary image of a program that went through the frontend, so that it can be
+// run again without lexing, parsing, matching identifiers or typechecking.
+//
+// It has every node, with the declarations identifiers were matched to, the
+// frame offsets, and the types the typechecker gave them. Pointers between
+// nodes are stored as node indices, and type ids as indices into tables of
+// the types that the program uses, which are rebuilt in the typechecker that
+// loads it. Builtin declarations are referred to by name.
+//
+// Meta types are only used while checking, and are not kept.
+//
+// Images are keyed on a hash of the layout version and of the builtins, so
+// an image written before a builtin declaration or type function changed is
+// treated as being from a different version.
+
+// writes the image of a checked program, and the order in which its
+// declarations have to be evaluated. Returns false if the file can't be
+// written
+bool write_cache(
+    std::string const& path,
+    string_view source,
+    Program* program,
+    std::vector<std::vector<Declaration*>> const& declaration_order,
+    TypeChecker::TypeChecker& tc);
+
+// whether the image was written by this version, with the same builtins,
+// from the given source
+bool is_cache_for(string_view image, string_view source);
+
+// rebuilds a program from its image, with its nodes in `allocator`, and its
+// types in `tc`, which must not have been used yet. Returns null if the image
+// is malformed or was written by a different version
+Program* read_cache(
+    string_view image,
+    Allocator& allocator,
+    TypeChecker::TypeChecker& tc,
+    std::vector<std::vector<Declaration*>>& declaration_order);
+
+} // namespace AST
@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../ast.hpp"
+#include "../ast_allocator.hpp"
+#include "../cst_allocator.hpp"
+#include "../ct_eval.hpp"
+#include "../lexer.hpp"
+#include "../match_identifiers.hpp"
+#include "../metacheck.hpp"
+#include "../parser.hpp"
+#include "../source_file.hpp"
+#include "../source_location.hpp"
+#include "../symbol_table.hpp"
+#include "../token_array.hpp"
+#include "../typecheck.hpp"
+#include "../typechecker.hpp"
+
+// Times type checking over generated programs of growing size. Each program
+// is a long chain of inferences, where the type of every link is unified
+// with the one of the link before it, so the time per link should stay
+// about the same as the programs grow.
+
+using Clock = std::chrono::steady_clock;
+
+// every local is unified with the one before it, in a single function
+static std::string local_chain(int links) {
+	std::string text = "f := fn(x) {\n\ta0 := x;\n";
+	for (int i = 1; i < links; ++i)
+		text += "\ta" + std::to_string(i) + " := a" + std::to_string(i - 1) + ";\n";
+	text += "\treturn a" + std::to_string(links - 1) + ";\n};\n";
+	return text;
+}
+
+// every function calls the one before it
+static std::string call_chain(int links) {
+	std::string text = "fn f0(x) => x;\n";
+	for (int i = 1; i < links; ++i)
+		text += "fn f" + std::to_string(i) + "(x) => f" + std::to_string(i - 1) + "(x);\n";
+	return text;
+}
+
+// every argument of a function is unified with the one before it
+static std::string argument_chain(int links) {
+	std::string text = "fn pick(a, b) => if (true) then a else b;\n";
+	text += "f := fn(x0";
+	for (int i = 1; i < links; ++i)
+		text += ", x" + std::to_string(i);
+	text += ") {\n";
+	for (int i = 1; i < links; ++i)
+		text += "\tpick(x" + std::to_string(i - 1) + ", x" + std::to_string(i) + ");\n";
+	text += "\treturn x0;\n};\n";
+	return text;
+}
+
+// runs the frontend, and returns how long the passes that check types took,
+// in milliseconds
+static double check(std::string const& text) {
+	SourceFile source {text};
+	TokenArray const ta = tokenize(source.data());
+	AST::Allocator ast_allocator;
+	AST::AST* ast;
+	{
+		CST::Allocator cst_allocator;
+		auto parse_result = parse_program(ta, cst_allocator);
+		if (not parse_result.ok()) {
+			parse_result.error().print(LineIndex {source.data()});
+			return -1;
+		}
+		ast = AST::convert_ast(parse_result.m_result, ast_allocator);
+	}
+
+	TypeChecker::TypeChecker tc {ast_allocator};
+	Frontend::SymbolTable context;
+	tc.m_builtin_declarations.for_each([&](AST::Declaration& decl) {
+		context.declare(&decl);
+	});
+	auto err = Frontend::match_identifiers(ast, context, ast_allocator);
+	if (!err.ok()) {
+		err.print(LineIndex {source.data()});
+		return -1;
+	}
+
+	tc.m_env.compute_declaration_order(static_cast<AST::Program*>(ast));
+
+	auto const start = Clock::now();
+	tc.m_core.m_meta_core.comp = &tc.m_env.declaration_components;
+	TypeChecker::metacheck(tc.m_core.m_meta_core, ast);
+	TypeChecker::reify_types(ast, tc, ast_allocator);
+	TypeChecker::typecheck(ast, tc);
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+	return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+	int max_links = 1 << 15;
+	for (int i = 1; i < argc; ++i)
+		if (strncmp(argv[i], "--max-links=", 12) == 0)
+			max_links = std::stoi(argv[i] + 12);
+
+	struct Shape {
+		char const* name;
+		std::string (*generate)(int);
+	};
+
+	Shape const shapes[] = {
+	    {"local chain", local_chain},
+	    {"call chain", call_chain},
+	    {"argument chain", argument_chain},
+	};
+
+	printf("%-16s %8s %10s %12s\n", "program", "links", "ms", "ns per link");
+	for (auto const& shape : shapes) {
+		for (int links = 1024; links <= max_links; links *= 2) {
+			double ms = check(shape.generate(links));
+			if (ms < 0)
+				return 1;
+			printf("%-16s %8d %10.2f %12.0f\n", shape.name, links, ms, ms * 1e6 / links);
+		}
+	}
+
+	return 0;
+}
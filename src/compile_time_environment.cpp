@@ -47,17 +47,21 @@ bool CompileTimeEnvironment::has_type_var(MonoId var) {
 }
 
 void CompileTimeEnvironment::compute_declaration_order(AST::Program* ast) {
+	std::vector<AST::Declaration*> declarations;
+	for (auto& decl : ast->m_declarations)
+		declarations.push_back(&decl);
+
+	declaration_components = declaration_order(declarations);
+}
+
+std::vector<std::vector<AST::Declaration*>> CompileTimeEnvironment::declaration_order(
+    std::vector<AST::Declaration*> const& index_to_decl) {
 
 	std::unordered_map<AST::Declaration*, int> decl_to_index;
-	std::vector<AST::Declaration*> index_to_decl;
 
 	// assign a unique int to every top level declaration
-	int i = 0;
-	for (auto& decl : ast->m_declarations) {
-		index_to_decl.push_back(&decl);
-		decl_to_index.insert({&decl, i});
-		i += 1;
-	}
+	for (int i = 0; i < int(index_to_decl.size()); ++i)
+		decl_to_index.insert({index_to_decl[i], i});
 
 	// build up the explicit declaration graph
 	TarjanSolver solver(index_to_decl.size());
@@ -76,6 +80,7 @@ void CompileTimeEnvironment::compute_declaration_order(AST::Program* ast) {
 	// compute strongly connected components
 	solver.solve();
 
+	std::vector<std::vector<AST::Declaration*>> result;
 	auto const& comps = solver.vertices_of_components();
 	std::vector<AST::Declaration*> decl_comp;
 	for (auto const& comp : comps) {
@@ -84,8 +89,10 @@ void CompileTimeEnvironment::compute_declaration_order(AST::Program* ast) {
 		for (int u : comp)
 			decl_comp.push_back(index_to_decl[u]);
 
-		declaration_components.push_back(std::move(decl_comp));
+		result.push_back(std::move(decl_comp));
 	}
+
+	return result;
 }
 
 } // namespace Frontend
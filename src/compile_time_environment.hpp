@@ -43,6 +43,12 @@ struct CompileTimeEnvironment {
 	bool has_type_var(MonoId);
 
 	void compute_declaration_order(AST::Program* ast);
+
+	// strongly connected components of the graph of references between the
+	// given declarations, in topological order. References to anything else
+	// are ignored
+	static std::vector<std::vector<AST::Declaration*>> declaration_order(
+	    std::vector<AST::Declaration*> const& declarations);
 };
 
 } // namespace Frontend
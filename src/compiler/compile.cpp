@@ -11,6 +11,8 @@
 #include "../ast.hpp"
 #include "../utils/span.hpp"
 #include "garbage_collector.hpp"
+#include "monomorphise.hpp"
+#include "type_lowering.hpp"
 #include "compiler.hpp"
 #include "utils.hpp"
 #include "value.hpp"
@@ -23,7 +25,19 @@ static void compile_stmt(AST::AST* ast, Compiler& e) {
 		e.m_stack.pop_unsafe();
 }
 
+// Functions bound to polymorphic declarations can't be given a single unboxed
+// signature, so they use the boxed ABI instead.
+static void mark_boxed_if_polymorphic(AST::Declaration* ast, Compiler& e) {
+	if (!ast->m_is_polymorphic || !ast->m_value || ast->m_value->type() != ASTTag::FunctionLiteral)
+		return;
+
+	// generalizing a ground type gives a polytype without variables
+	if (!e.m_tc->m_core.poly_data[ast->m_decl_type].vars.empty())
+		e.m_boxed_functions.insert(static_cast<AST::FunctionLiteral*>(ast->m_value));
+}
+
 void compile(AST::Declaration* ast, Compiler& e) {
+	mark_boxed_if_polymorphic(ast, e);
 	auto ref = e.new_reference(Value {nullptr});
 	e.m_stack.push(ref.as_value());
 	if (ast->m_value) {
@@ -39,6 +53,8 @@ void compile(AST::Program* ast, Compiler& e) {
 		for (auto decl : comp) {
 			auto ref = e.new_reference(e.null());
 			e.global_declare_direct(decl->identifier_text(), ref.get());
+			mark_boxed_if_polymorphic(decl, e);
+			specialise(decl, e);
                         compileAny(decl->m_value, e);
 			auto value = e.m_stack.pop_unsafe();
 			ref->m_value = value_of(value);
@@ -48,7 +64,7 @@ void compile(AST::Program* ast, Compiler& e) {
 
 
 void compile(AST::NumberLiteral* ast, Compiler& e) {
-        auto v = llvm::ConstantFP::get(e.m_context, llvm::APFloat(ast->value()));
+        auto v = llvm::ConstantFP::get(llvm::Type::getFloatTy(e.m_context), ast->value());
 	e.push_llvm_value(v);
 }
 
@@ -73,15 +89,14 @@ void compile(AST::StringLiteral* ast, Compiler& e) {
 }
 
 void compile(AST::BooleanLiteral* ast, Compiler& e) {
-	// TODO this is hack, I think, it uses a 1 bit number to store the bool
-	auto v = llvm::ConstantInt::get(e.m_context, llvm::APInt(1, ast->m_value ? 1 : 0));
-        e.push_boolean(v);
+	auto v = llvm::ConstantInt::get(llvm::Type::getInt1Ty(e.m_context), ast->m_value ? 1 : 0);
+	e.push_llvm_value(v);
 }
 
 void compile(AST::NullLiteral* ast, Compiler& e) {
-        //TODO check nulls work
-        auto v = llvm::Constant::getNullValue(llvm::IntegerType::getInt32Ty(e.m_context));
-        e.push_llvm_value(v);
+	// null is the only value of type unit, which is lowered to an empty struct
+	auto v = llvm::Constant::getNullValue(llvm::StructType::get(e.m_context));
+	e.push_llvm_value(v);
 }
 
 void compile(AST::ArrayLiteral* ast, Compiler& e) {
@@ -162,8 +177,33 @@ void compile_call_function(Function* callee, size_t arg_count, Compiler& e) {
 
 }
 
+// Calls the specialised copy of a polymorphic function, whose arguments are
+// all lowered to unboxed LLVM values
+static void compile_specialised_call(
+    AST::CallExpression* ast, llvm::Function* callee, Compiler& e) {
+	std::vector<llvm::Value*> args;
+	for (auto expr : ast->m_args) {
+		compileAny(expr, e);
+		auto arg = value_of(e.m_stack.pop_unsafe());
+		if (arg.type() != ValueTag::LlvmValue)
+			Log::fatal() << "(internal) argument to '" << callee->getName().str()
+			             << "' was not lowered";
+		args.push_back(arg.get_llvm_value());
+	}
+
+	e.push_llvm_value(e.m_builder->CreateCall(callee, args));
+}
+
 void compile(AST::CallExpression* ast, Compiler& e) {
 
+	// code can only be emitted inside of a function
+	if (ast->m_callee->type() == ASTTag::Identifier && e.m_builder &&
+	    e.m_builder->GetInsertBlock()) {
+		auto site = e.m_specialised_sites.find(static_cast<AST::Identifier*>(ast->m_callee));
+		if (site != e.m_specialised_sites.end())
+			return compile_specialised_call(ast, site->second, e);
+	}
+
 	compileAny(ast->m_callee, e);
 
 	// NOTE: keep callee on the stack
@@ -232,32 +272,11 @@ void compile(AST::TernaryExpression* ast, Compiler& e) {
 		compileAny(ast->m_else_expr, e);
 }
 
-llvm::Type* llvm_from_type(MonoId type, Compiler& e) {
-  if(type == TypeChecker::BuiltinType::Int) {
-    return llvm::Type::getInt32Ty(e.m_context);
-  } else if(type == TypeChecker::BuiltinType::Float) {
-    return llvm::Type::getFloatTy(e.m_context);
-  } else {
-    llvm::errs() << "Missing " << type;
-    return nullptr;
-  }
-}
-
-llvm::Function *getFunction(AST::FunctionLiteral* ast, Compiler& e) {
-  static std::string currentName = "a";
-  currentName += "a";
-
-  std::vector<llvm::Type *> function_args;
-
-  for(const auto &arg : ast->m_args) {
-    function_args.push_back(llvm_from_type(arg.m_value_type, e));
-  }
-
-  auto function_type =
-      llvm::FunctionType::get(llvm_from_type(ast->m_return_type, e), function_args, false);
+llvm::Function *getFunction(AST::FunctionLiteral* ast, Compiler& e, std::string const& name) {
+  auto function_type = llvm_function_type(ast, e);
 
   auto Function =
-      llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, currentName, e.m_module.get());
+      llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, name, e.m_module.get());
 
   // Set names for all arguments.
   unsigned Idx = 0;
@@ -267,6 +286,12 @@ llvm::Function *getFunction(AST::FunctionLiteral* ast, Compiler& e) {
   return Function;
 }
 
+llvm::Function *getFunction(AST::FunctionLiteral* ast, Compiler& e) {
+  static std::string currentName = "a";
+  currentName += "a";
+  return getFunction(ast, e, currentName);
+}
+
 void compile(AST::FunctionLiteral* ast, Compiler& e) {
 	CapturesType captures;
 	captures.assign(ast->m_captures.size(), nullptr);
@@ -409,7 +434,7 @@ void compile(AST::WhileStatement* ast, Compiler& e) {
 }
 
 void compile(AST::StructExpression* ast, Compiler& e) {
-	e.push_record_constructor(ast->m_fields);
+	e.push_record_constructor({ast->m_fields.begin(), ast->m_fields.end()});
 }
 
 void compile(AST::UnionExpression* ast, Compiler& e) {
@@ -535,7 +560,7 @@ static bool createExecutableObject(llvm::Module& module) {
 	std::filesystem::create_directories("./bin");
 
 	if(![&]{
-		    auto filename = "bin/output.o";
+		    auto filename = object_file_path;
 		    std::error_code EC;
 		    llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
 
@@ -579,6 +604,10 @@ static bool createExecutableObject(llvm::Module& module) {
 }
 
 void preCompileSteps(Compiler& e) {
+	// later calls to compile, like the driver's, add to the same module
+	if (e.m_module)
+		return;
+
 	const auto name = "BrainF";
 	e.m_module = std::make_unique<llvm::Module>(name, e.m_context);
 
@@ -601,7 +630,24 @@ void preCompileSteps(Compiler& e) {
         //e.m_function_pass_manager->doInitialization();
 }
 
-void postCompileSteps(Compiler& e) {
+bool postCompileSteps(Compiler& e) {
+	// functions whose body never got generated only have an unterminated
+	// entry block. The object would be left with undefined symbols
+	bool complete = true;
+	for (auto& function : *e.m_module) {
+		for (auto& block : function) {
+			if (!block.getTerminator()) {
+				Log::error() << "no code was generated for the body of '"
+				             << function.getName().str() << "'";
+				complete = false;
+				break;
+			}
+		}
+	}
+
+	if (!complete)
+		return false;
+
 	//if (verifyModule(*e.m_module)) {
 	//	llvm::errs() << "Error: module failed verification.  This shouldn't happen.\n";
 	//	abort();
@@ -609,9 +655,7 @@ void postCompileSteps(Compiler& e) {
 
 	e.m_module->print(llvm::errs(), nullptr);
 
-	createExecutableObject(*e.m_module);
-
-	llvm::llvm_shutdown();
+	return createExecutableObject(*e.m_module);
 }
 
 
@@ -621,6 +665,9 @@ void compile(AST::AST* ast, Compiler& e) {
 
 	compileAny(ast, e);
 
+	if (e.m_module->getFunction("main"))
+		return;
+
 	//define i32 @main(i32 %argc, i8 **%argv)
 	llvm::FunctionType *main_func_fty = llvm::FunctionType::get(
 	    llvm::Type::getInt32Ty(e.m_module->getContext()),
@@ -644,8 +691,6 @@ void compile(AST::AST* ast, Compiler& e) {
 	//ret i32 0
 	llvm::ReturnInst::Create(e.m_module->getContext(),
 	                         llvm::ConstantInt::get(e.m_module->getContext(), llvm::APInt(32, 0)), bb);
-
-	postCompileSteps(e);
 }
 
 } // namespace Interpreter
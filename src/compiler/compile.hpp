@@ -1,15 +1,32 @@
 #pragma once
 
+#include <string>
+
+namespace llvm {
+class Function;
+}
+
 namespace AST {
 struct AST;
+struct FunctionLiteral;
 }
 
 namespace Compiler {
 
 struct Compiler;
 
+// where the object file for the program is written
+constexpr char const* object_file_path = "bin/output.o";
+
 
 void compileAny(AST::AST* ast, Compiler& e);
+// Lowers the program into the module, which is created on the first call
 void compile(AST::AST*, Compiler&);
+// Writes the module to object_file_path. Returns false if some function is
+// missing its body, or if the backend failed
+bool postCompileSteps(Compiler&);
+
+// Declares an LLVM function with the signature of the given function literal
+llvm::Function* getFunction(AST::FunctionLiteral*, Compiler&, std::string const& name);
 
 }
@@ -26,13 +26,18 @@
 #include <llvm/Target/TargetMachine.h>
 
 #include "gc_ptr.hpp"
+#include "monomorphise.hpp"
 #include "stack.hpp"
 #include "value.hpp"
 
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace AST {
 struct Declaration;
+struct FunctionLiteral;
+struct Identifier;
 }
 
 namespace TypeChecker {
@@ -67,6 +72,19 @@ struct Compiler {
 	Value m_return_value {nullptr};
 	Scope m_global_scope;
 
+	// lazily created by boxed_value_type
+	llvm::StructType* m_boxed_value_type {nullptr};
+	// lowered records and variants, by type function
+	std::unordered_map<int, llvm::StructType*> m_aggregate_types;
+	// function literals that use the boxed ABI
+	std::unordered_set<AST::FunctionLiteral*> m_boxed_functions;
+	// type variables to lower as the given monotypes, set while emitting a
+	// specialised function
+	std::unordered_map<MonoId, MonoId> const* m_type_substitution {nullptr};
+	std::unordered_map<AST::Declaration*, std::vector<Specialisation>> m_specialisations;
+	// uses of polymorphic declarations that can call a specialised version
+	std::unordered_map<AST::Identifier*, llvm::Function*> m_specialised_sites;
+
 	Compiler(
 	    TypeChecker::TypeChecker* tc,
 	    GC* gc,
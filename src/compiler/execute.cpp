@@ -9,12 +9,15 @@
 #include "../match_identifiers.hpp"
 #include "../metacheck.hpp"
 #include "../parser.hpp"
+#include "../source_file.hpp"
+#include "../source_location.hpp"
 #include "../symbol_table.hpp"
 #include "../token_array.hpp"
 #include "../typecheck.hpp"
 #include "../typechecker.hpp"
 #include "compile.hpp"
 #include "garbage_collector.hpp"
+#include "module_cache.hpp"
 #include "compiler.hpp"
 #include "native.hpp"
 #include "utils.hpp"
@@ -22,44 +25,69 @@
 namespace Compiler {
 
 ExitStatus execute(
-	std::string const& source,
+	SourceFile const& source,
 	ExecuteSettings settings,
 	Runner* runner
 ) {
-	TokenArray const ta = tokenize(source.c_str());
+	ModuleCache cache {settings.cache_directory, settings.cache_size};
+	std::string cache_key;
+	if (!settings.cache_directory.empty()) {
+		// everything else that changes the output goes into the key too
+		std::string flags = llvm::sys::getDefaultTargetTriple();
+		flags += settings.typecheck ? " typecheck" : " no-typecheck";
+		cache_key = ModuleCache::key_for(source.view(), flags);
+
+		// the cached object already has the code the runner added
+		if (cache.fetch(cache_key, object_file_path))
+			return ExitStatus::Ok;
+	}
 
-	CST::Allocator cst_allocator;
-	auto parse_result = parse_program(ta, cst_allocator);
+	Lexer lexer {source.data()};
 
-	if (not parse_result.ok()) {
-		parse_result.m_error.print();
-		return ExitStatus::ParseError;
-	}
+	AST::Allocator ast_allocator;
+	AST::AST* ast;
+
+	// the CST is only used to build the AST, so it's freed right after that
+	{
+		CST::Allocator cst_allocator;
+		Writer<CST::CST*> parse_result;
+		if (settings.parse_threads > 1) {
+			// the declarations have to be found before they are split up
+			lexer.lex_all();
+			parse_result = parse_program(lexer.m_tokens, cst_allocator, settings.parse_threads);
+		} else {
+			parse_result = parse_program(lexer, cst_allocator);
+		}
 
-	auto cst = parse_result.m_result;
+		if (not parse_result.ok()) {
+			parse_result.error().print(LineIndex {source.data()});
+			return ExitStatus::ParseError;
+		}
 
-	if (settings.dump_cst)
-		print(cst, 1);
+		auto cst = parse_result.m_result;
 
-	// Can this even happen? parse_program should always either return a
-	// Program or an error
-	if (cst->type() != CSTTag::Program)
-		return ExitStatus::TopLevelTypeError;
+		if (settings.dump_cst)
+			print(cst, 1);
 
-	AST::Allocator ast_allocator;
-	auto ast = AST::convert_ast(cst, ast_allocator);
+		// Can this even happen? parse_program should always either return a
+		// Program or an error
+		if (cst->type() != CSTTag::Program)
+			return ExitStatus::TopLevelTypeError;
+
+		ast = AST::convert_ast(cst, ast_allocator);
+	}
 
 	// creates and stores a bunch of builtin declarations
 	TypeChecker::TypeChecker tc{ast_allocator};
 	Frontend::SymbolTable context;
 
 	{
-		for (auto& bucket : tc.m_builtin_declarations.m_buckets)
-			for (auto& decl : bucket)
-				context.declare(&decl);
-		auto err = Frontend::match_identifiers(ast, context);
+		tc.m_builtin_declarations.for_each([&](AST::Declaration& decl) {
+			context.declare(&decl);
+		});
+		auto err = Frontend::match_identifiers(ast, context, ast_allocator);
 		if (!err.ok()) {
-			err.print();
+			err.print(LineIndex {source.data()});
 			return ExitStatus::StaticError;
 		}
 	}
@@ -80,7 +108,19 @@ ExitStatus execute(
 	declare_native_functions(env);
         compile(ast, env);
 
-	return runner(env, context);
+	auto status = runner(env, context);
+	if (status != ExitStatus::Ok)
+		return status;
+
+	// the runner adds to the module, so the object is only written once it's
+	// done
+	if (!postCompileSteps(env))
+		return ExitStatus::CodegenError;
+
+	if (!cache_key.empty())
+		cache.store(cache_key, object_file_path);
+
+	return status;
 }
 
 
@@ -96,18 +136,19 @@ Value eval_expression(
 ) {
 	TokenArray const ta = tokenize(expr.c_str());
 
-	CST::Allocator cst_allocator;
-	auto parse_result = parse_expression(ta, cst_allocator);
-	// TODO: handle parse error
-	auto cst = parse_result.m_result;
-
 	AST::Allocator ast_allocator;
-	auto ast = AST::convert_ast(cst, ast_allocator);
+	AST::AST* ast;
+	{
+		CST::Allocator cst_allocator;
+		auto parse_result = parse_expression(ta, cst_allocator);
+		// TODO: handle parse error
+		ast = AST::convert_ast(parse_result.m_result, ast_allocator);
+	}
 
 	{
-		auto err = Frontend::match_identifiers(ast, context);
+		auto err = Frontend::match_identifiers(ast, context, ast_allocator);
 		if (!err.ok()) {
-			err.print();
+			err.print(LineIndex {expr.c_str()});
 			return env.null();
 		}
 	}
@@ -2,8 +2,11 @@
 
 #include "exit_status_tag.hpp"
 #include "value.hpp"
+#include <cstdint>
 #include <string>
 
+struct SourceFile;
+
 namespace Frontend {
 struct SymbolTable;
 }
@@ -17,11 +20,18 @@ using Runner = auto(Compiler&, Frontend::SymbolTable&) -> ExitStatus;
 struct ExecuteSettings {
 	bool dump_cst {false};
 	bool typecheck {true};
+	// parse top-level declarations on this many threads
+	int parse_threads {1};
+	// where to keep compiled objects between runs. Empty disables the cache.
+	// On a hit, the cached object is used as is, and neither the frontend
+	// nor the runner run
+	std::string cache_directory {};
+	std::uintmax_t cache_size {256u << 20};
 };
 
 // returns an exit status
 ExitStatus execute(
-	std::string const& source,
+	SourceFile const& source,
 	ExecuteSettings settings,
 	Runner* runner
 );
@@ -6,6 +6,7 @@
 	X(ParseError)                                                              \
 	X(StaticError)                                                             \
 	X(TopLevelTypeError)                                                       \
+	X(CodegenError)                                                            \
                                                                                \
 	X(NullError)                                                               \
 	X(TypeError)                                                               \
@@ -1,6 +1,4 @@
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
 
 #include "../ast.hpp"
@@ -8,6 +6,7 @@
 #include "../cst_allocator.hpp"
 #include "../lexer.hpp"
 #include "../parser.hpp"
+#include "../source_file.hpp"
 #include "../symbol_table.hpp"
 #include "../token_array.hpp"
 #include "compile.hpp"
@@ -18,28 +17,36 @@
 
 int main(int argc, char** argv) {
 
-	if (argc < 2) {
-		std::cout << "Argument missing: source file" << std::endl;
-		return 1;
+	Compiler::ExecuteSettings settings;
+	char const* source_file = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg.rfind("--cache-dir=", 0) == 0) {
+			settings.cache_directory = arg.substr(12);
+		} else if (arg.rfind("--cache-size=", 0) == 0) {
+			settings.cache_size = std::stoull(arg.substr(13));
+		} else if (arg.rfind("--parse-threads=", 0) == 0) {
+			settings.parse_threads = std::stoi(arg.substr(16));
+		} else if (arg.rfind("--", 0) == 0) {
+			std::cout << "Unknown option '" << arg << "'" << std::endl;
+			return 1;
+		} else {
+			source_file = argv[i];
+		}
 	}
 
-	std::ifstream in_fs(argv[1]);
-	if (!in_fs.good()) {
-		std::cout << "Failed to open '" << argv[1] << "'" << std::endl;
+	if (!source_file) {
+		std::cout << "Argument missing: source file" << std::endl;
 		return 1;
 	}
 
-	std::stringstream file_content;
-	std::string line;
-
-	while (std::getline(in_fs, line)) {
-		file_content << line << '\n';
+	SourceFile source;
+	if (!source.load(source_file)) {
+		std::cout << "Failed to open '" << source_file << "'" << std::endl;
+		return 1;
 	}
 
-	std::string source = file_content.str();
-
-	Compiler::ExecuteSettings settings;
-
 	ExitStatus exit_code = execute(
 	    source,
 	    settings,
@@ -67,5 +74,7 @@ int main(int argc, char** argv) {
 		    return ExitStatus::Ok;
 	    });
 
+	llvm::llvm_shutdown();
+
 	return static_cast<int>(exit_code);
 }
@@ -0,0 +1,111 @@
+#include "module_cache.hpp"
+
+#include <algorithm>
+#include <system_error>
+#include <vector>
+
+namespace Compiler {
+
+namespace fs = std::filesystem;
+
+static char const* entry_extension = ".o";
+
+// 64-bit FNV-1a. We need a hash that is stable across runs and builds, which
+// std::hash doesn't guarantee.
+static uint64_t fnv1a(string_view data, uint64_t hash = 0xcbf29ce484222325) {
+	for (unsigned char c : data) {
+		hash ^= c;
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+ModuleCache::ModuleCache(fs::path directory, std::uintmax_t max_size)
+    : m_directory {std::move(directory)}
+    , m_max_size {max_size} {}
+
+std::string ModuleCache::key_for(string_view source, std::string const& flags) {
+	uint64_t hash = fnv1a(compiler_version);
+	// separators keep e.g. ("ab", "c") and ("a", "bc") apart
+	hash = fnv1a(std::string(1, '\0'), hash);
+	hash = fnv1a(flags, hash);
+	hash = fnv1a(std::string(1, '\0'), hash);
+	hash = fnv1a(source, hash);
+
+	char buffer[17];
+	for (int i = 15; i >= 0; --i) {
+		buffer[i] = "0123456789abcdef"[hash & 0xf];
+		hash >>= 4;
+	}
+	buffer[16] = '\0';
+	return buffer;
+}
+
+bool ModuleCache::fetch(std::string const& key, fs::path const& destination) {
+	std::error_code ec;
+	auto entry = m_directory / (key + entry_extension);
+	if (!fs::is_regular_file(entry, ec))
+		return false;
+
+	if (destination.has_parent_path())
+		fs::create_directories(destination.parent_path(), ec);
+	fs::copy_file(entry, destination, fs::copy_options::overwrite_existing, ec);
+	if (ec)
+		return false;
+
+	// the modification time doubles as the last time the entry was used
+	fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+	return true;
+}
+
+void ModuleCache::store(std::string const& key, fs::path const& object_file) {
+	std::error_code ec;
+	fs::create_directories(m_directory, ec);
+
+	// copy to a temporary name first, so that an interrupted copy never
+	// leaves a truncated entry behind
+	auto entry = m_directory / (key + entry_extension);
+	auto temporary = m_directory / (key + ".tmp");
+	fs::copy_file(object_file, temporary, fs::copy_options::overwrite_existing, ec);
+	if (ec)
+		return;
+	fs::rename(temporary, entry, ec);
+	if (ec) {
+		fs::remove(temporary, ec);
+		return;
+	}
+
+	evict();
+}
+
+void ModuleCache::evict() {
+	struct Entry {
+		fs::path path;
+		fs::file_time_type last_use;
+		std::uintmax_t size;
+	};
+
+	std::error_code ec;
+	std::vector<Entry> entries;
+	std::uintmax_t total_size = 0;
+	for (auto const& file : fs::directory_iterator(m_directory, ec)) {
+		if (!file.is_regular_file(ec) || file.path().extension() != entry_extension)
+			continue;
+		Entry entry {file.path(), file.last_write_time(ec), file.file_size(ec)};
+		total_size += entry.size;
+		entries.push_back(std::move(entry));
+	}
+
+	std::sort(entries.begin(), entries.end(), [](Entry const& a, Entry const& b) {
+		return a.last_use < b.last_use;
+	});
+
+	for (auto const& entry : entries) {
+		if (total_size <= m_max_size)
+			break;
+		if (fs::remove(entry.path, ec))
+			total_size -= entry.size;
+	}
+}
+
+} // namespace Compiler
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "../utils/string_view.hpp"
+
+namespace Compiler {
+
+// Bump whenever a change to the compiler changes its output, so that stale
+// cache entries stop matching
+constexpr char const* compiler_version = "jasper-compiler-2";
+
+// Persistent cache of object files, keyed by a hash of everything that went
+// into producing them. Entries are evicted least recently used first, once
+// the cache grows past its size limit.
+struct ModuleCache {
+	std::filesystem::path m_directory;
+	std::uintmax_t m_max_size;
+
+	ModuleCache(std::filesystem::path directory, std::uintmax_t max_size);
+
+	// Hashes the source together with the compiler version and any flags
+	// that affect the output
+	static std::string key_for(string_view source, std::string const& flags);
+
+	// Copies the cached object for the given key to `destination`. Returns
+	// false on a cache miss.
+	bool fetch(std::string const& key, std::filesystem::path const& destination);
+
+	// Stores a copy of the given object file, evicting old entries if needed
+	void store(std::string const& key, std::filesystem::path const& object_file);
+
+	void evict();
+};
+
+} // namespace Compiler
@@ -0,0 +1,145 @@
+#include "monomorphise.hpp"
+
+#include "../ast.hpp"
+#include "../typechecker.hpp"
+#include "compile.hpp"
+#include "compiler.hpp"
+#include "garbage_collector.hpp"
+#include "utils.hpp"
+
+namespace Compiler {
+
+// Writes a textual representation of the given monotype to `out`, such that
+// two monotypes get the same key iff they are structurally equal. Returns
+// false if the monotype is not ground.
+static bool mono_key(MonoId mono, Compiler& e, std::string& out) {
+	auto& core = e.m_tc->m_core;
+
+	mono = core.m_mono_core.find(mono);
+	if (core.m_mono_core.is_var(mono))
+		return false;
+
+	int tf = core.m_tf_core.find_function(core.m_mono_core.find_function(mono));
+	out += 't';
+	out += std::to_string(tf);
+
+	auto const args = core.m_mono_core.arguments(core.m_mono_core.find_term(mono));
+	if (args.empty())
+		return true;
+
+	out += '(';
+	for (int i = 0; i != args.size(); ++i) {
+		if (i != 0)
+			out += ',';
+		if (!mono_key(args[i], e, out))
+			return false;
+	}
+	out += ')';
+	return true;
+}
+
+// Compiles the body of a specialised function into it. Returns false if the
+// body never returned, in which case the function is left incomplete.
+static bool emit_body(AST::FunctionLiteral* ast, llvm::Function* function, Compiler& e) {
+	auto saved_block = e.m_builder->GetInsertBlock();
+	auto entry = llvm::BasicBlock::Create(e.m_context, "entry", function);
+	e.m_builder->SetInsertPoint(entry);
+
+	auto const function_depth = e.m_stack.m_function_stack.size();
+	e.m_stack.push(function);
+
+	int frame_start = e.m_stack.m_stack_ptr;
+	for (auto& arg : function->args()) {
+		auto ref = e.new_reference(Value {nullptr});
+		ref->m_value = Value {&arg};
+		e.m_stack.push(ref.as_value());
+	}
+
+	e.m_stack.start_stack_frame(frame_start);
+	int const body_start = e.m_stack.m_stack_ptr;
+	compileAny(ast->m_body, e);
+
+	bool returned = e.m_returning;
+	e.m_returning = false;
+
+	// functions written as `fn(...) => expr` leave their result on the stack
+	if (!returned && e.m_stack.m_stack_ptr == body_start + 1) {
+		auto result = value_of(e.m_stack.access(0));
+		if (result.type() == ValueTag::LlvmValue) {
+			e.m_builder->CreateRet(result.get_llvm_value());
+			returned = true;
+		}
+	}
+
+	e.m_stack.end_stack_frame();
+	// the return statement pops the function, if we got to it
+	e.m_stack.m_function_stack.resize(function_depth);
+
+	if (saved_block)
+		e.m_builder->SetInsertPoint(saved_block);
+
+	return returned;
+}
+
+void specialise(AST::Declaration* decl, Compiler& e) {
+	if (!decl->m_is_polymorphic || !decl->m_value ||
+	    decl->m_value->type() != ASTTag::FunctionLiteral)
+		return;
+
+	auto it = e.m_tc->m_instantiations.find(decl);
+	if (it == e.m_tc->m_instantiations.end())
+		return;
+
+	auto func = static_cast<AST::FunctionLiteral*>(decl->m_value);
+	auto const& poly = e.m_tc->m_core.poly_data[decl->m_decl_type];
+	auto& specialisations = e.m_specialisations[decl];
+
+	for (auto const& inst : it->second) {
+		std::string key;
+		bool ground = true;
+		for (MonoId arg : inst.m_args) {
+			key += '_';
+			ground = ground && mono_key(arg, e, key);
+		}
+
+		if (!ground || poly.origin_vars.size() != inst.m_args.size())
+			continue;
+
+		Specialisation* found = nullptr;
+		for (auto& spec : specialisations)
+			if (spec.m_key == key)
+				found = &spec;
+
+		if (!found) {
+			if (int(specialisations.size()) == max_specialisations)
+				continue;
+
+			Specialisation spec;
+			spec.m_key = std::move(key);
+			for (size_t i = 0; i != inst.m_args.size(); ++i) {
+				MonoId var = e.m_tc->m_core.m_mono_core.find(poly.origin_vars[i]);
+				spec.m_substitution[var] = inst.m_args[i];
+			}
+
+			std::string name = std::string(decl->identifier_text().str()) + "." + spec.m_key;
+			e.m_type_substitution = &spec.m_substitution;
+			spec.m_function = getFunction(func, e, name);
+			bool const complete = emit_body(func, spec.m_function, e);
+			e.m_type_substitution = nullptr;
+
+			// couldn't lower it, the boxed version will have to do
+			if (!complete) {
+				spec.m_function->eraseFromParent();
+				spec.m_function = nullptr;
+			}
+
+			specialisations.push_back(std::move(spec));
+			found = &specialisations.back();
+		}
+
+		if (found->m_function)
+			e.m_specialised_sites[inst.m_site] = found->m_function;
+	}
+}
+
+} // namespace Compiler
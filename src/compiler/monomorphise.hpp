@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "../typechecker_types.hpp"
+
+namespace llvm {
+class Function;
+}
+
+namespace AST {
+struct Declaration;
+}
+
+namespace Compiler {
+
+struct Compiler;
+
+// Polymorphic functions get at most this many specialised copies. Call sites
+// past the cap, or with types that are not fully known, use the boxed version.
+constexpr int max_specialisations = 8;
+
+// A copy of a polymorphic function, for one assignment of its type variables
+struct Specialisation {
+	std::string m_key;
+	std::unordered_map<MonoId, MonoId> m_substitution;
+	llvm::Function* m_function {nullptr};
+};
+
+// Emits one specialised function per distinct ground instantiation of the
+// given declaration, and maps each of its uses to the matching one.
+void specialise(AST::Declaration*, Compiler&);
+
+} // namespace Compiler
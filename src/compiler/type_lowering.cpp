@@ -0,0 +1,156 @@
+#include "type_lowering.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "../ast.hpp"
+#include "../typechecker.hpp"
+#include "compiler.hpp"
+
+namespace Compiler {
+
+// index into TypeSystemCore::m_type_functions of the type function of a term
+static int type_function_of(MonoId mono, Compiler& e) {
+	auto& core = e.m_tc->m_core;
+	TypeFunctionId header = core.m_mono_core.find_function(mono);
+	return core.m_tf_core.find_function(header);
+}
+
+static int builtin_type_function(TypeFunctionId tf, Compiler& e) {
+	return e.m_tc->m_core.m_tf_core.find_function(tf);
+}
+
+static bool is_aggregate(TypeFunctionData const& data) {
+	return !data.is_dummy && (data.tag == TypeFunctionTag::Record ||
+	                          data.tag == TypeFunctionTag::Variant);
+}
+
+llvm::StructType* boxed_value_type(Compiler& e) {
+	if (!e.m_boxed_value_type)
+		e.m_boxed_value_type = llvm::StructType::create(e.m_context, "jasper.Value");
+	return e.m_boxed_value_type;
+}
+
+static llvm::Type* boxed_pointer_type(Compiler& e) {
+	return boxed_value_type(e)->getPointerTo();
+}
+
+static llvm::StructType* llvm_from_record(int tf, Compiler& e) {
+	auto& data = e.m_tc->m_core.m_type_functions[tf];
+
+	std::vector<llvm::Type*> fields;
+	for (auto const& field : data.fields)
+		fields.push_back(llvm_storage_type(data.structure[field], e));
+
+	auto result = e.m_aggregate_types[tf];
+	result->setBody(fields);
+	return result;
+}
+
+static llvm::StructType* llvm_from_variant(int tf, Compiler& e) {
+	auto& data = e.m_tc->m_core.m_type_functions[tf];
+	auto const& layout = e.m_module->getDataLayout();
+
+	// the payload is big enough for the largest constructor argument, and is
+	// made of i64 so that it is suitably aligned for all of them
+	uint64_t payload_bytes = 0;
+	for (auto const& kv : data.structure) {
+		auto type = llvm_storage_type(kv.second, e);
+		payload_bytes = std::max(payload_bytes, layout.getTypeAllocSize(type).getFixedSize());
+	}
+	uint64_t const payload_words = (payload_bytes + 7) / 8;
+
+	auto result = e.m_aggregate_types[tf];
+	result->setBody({
+	    llvm::Type::getInt32Ty(e.m_context),
+	    llvm::ArrayType::get(llvm::Type::getInt64Ty(e.m_context), payload_words)});
+	return result;
+}
+
+static llvm::Type* llvm_from_aggregate(int tf, Compiler& e) {
+	auto it = e.m_aggregate_types.find(tf);
+	if (it != e.m_aggregate_types.end())
+		return it->second;
+
+	// register the (still opaque) struct before lowering its members, so that
+	// recursive types refer back to it instead of looping forever
+	auto& data = e.m_tc->m_core.m_type_functions[tf];
+	char const* prefix = data.tag == TypeFunctionTag::Record ? "jasper.record." : "jasper.variant.";
+	e.m_aggregate_types[tf] = llvm::StructType::create(e.m_context, prefix + std::to_string(tf));
+
+	if (data.tag == TypeFunctionTag::Record)
+		return llvm_from_record(tf, e);
+	else
+		return llvm_from_variant(tf, e);
+}
+
+llvm::Type* llvm_from_type(MonoId type, Compiler& e) {
+	auto& core = e.m_tc->m_core;
+	auto& tc = *e.m_tc;
+
+	type = core.m_mono_core.find(type);
+	if (core.m_mono_core.is_var(type)) {
+		if (e.m_type_substitution) {
+			auto it = e.m_type_substitution->find(type);
+			if (it != e.m_type_substitution->end())
+				return llvm_from_type(it->second, e);
+		}
+		return boxed_pointer_type(e);
+	}
+
+	int tf = type_function_of(type, e);
+
+	if (tf == type_function_of(tc.mono_int(), e))
+		return llvm::Type::getInt32Ty(e.m_context);
+	if (tf == type_function_of(tc.mono_float(), e))
+		return llvm::Type::getFloatTy(e.m_context);
+	if (tf == type_function_of(tc.mono_boolean(), e))
+		return llvm::Type::getInt1Ty(e.m_context);
+	if (tf == type_function_of(tc.mono_unit(), e))
+		return llvm::StructType::get(e.m_context);
+	if (tf == type_function_of(tc.mono_string(), e))
+		return llvm::Type::getInt8PtrTy(e.m_context);
+
+	if (tf == builtin_type_function(TypeChecker::BuiltinType::Function, e)) {
+		auto const args = core.m_mono_core.arguments(core.m_mono_core.find_term(type));
+		assert(!args.empty());
+
+		std::vector<llvm::Type*> arg_types;
+		for (int i = 0; i + 1 < args.size(); ++i)
+			arg_types.push_back(llvm_from_type(args[i], e));
+
+		return llvm::FunctionType::get(llvm_from_type(args[args.size() - 1], e), arg_types, false)
+		    ->getPointerTo();
+	}
+
+	auto& data = core.m_type_functions[tf];
+	if (is_aggregate(data))
+		return llvm_from_aggregate(tf, e);
+
+	// arrays, dummies and anything else we can't see through are boxed
+	return boxed_pointer_type(e);
+}
+
+llvm::Type* llvm_storage_type(MonoId type, Compiler& e) {
+	auto result = llvm_from_type(type, e);
+	if (result->isStructTy() && !static_cast<llvm::StructType*>(result)->isLiteral())
+		return result->getPointerTo();
+	return result;
+}
+
+llvm::FunctionType* llvm_function_type(AST::FunctionLiteral* ast, Compiler& e) {
+	// specialised copies get their own unboxed signature
+	bool const boxed = !e.m_type_substitution && e.m_boxed_functions.count(ast) != 0;
+
+	auto lower = [&](MonoId type) -> llvm::Type* {
+		return boxed ? boxed_pointer_type(e) : llvm_from_type(type, e);
+	};
+
+	std::vector<llvm::Type*> arg_types;
+	for (auto const& arg : ast->m_args)
+		arg_types.push_back(lower(arg.m_value_type));
+
+	return llvm::FunctionType::get(lower(ast->m_return_type), arg_types, false);
+}
+
+} // namespace Compiler
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../typechecker_types.hpp"
+
+namespace llvm {
+class Type;
+class StructType;
+class FunctionType;
+}
+
+namespace AST {
+struct FunctionLiteral;
+}
+
+namespace Compiler {
+
+struct Compiler;
+
+// Opaque type used by the boxed ABI. Values of polymorphic declarations are
+// passed around as pointers to it, and the runtime inspects their tag.
+llvm::StructType* boxed_value_type(Compiler&);
+
+// Returns the unboxed representation of the given monotype:
+//  - int, float and boolean become i32, float and i1
+//  - records with known fields become (named) structs
+//  - variants become a tagged union: { i32 tag, [n x i64] payload }
+// Anything that is not fully known falls back to a pointer to a boxed value,
+// except type variables given a value by Compiler::m_type_substitution.
+llvm::Type* llvm_from_type(MonoId, Compiler&);
+
+// Type used to store a value of the given monotype inside an aggregate.
+// Aggregates are stored by pointer, which allows recursive types.
+llvm::Type* llvm_storage_type(MonoId, Compiler&);
+
+// Signature of a function literal. Uses the boxed ABI for functions bound to
+// polymorphic declarations.
+llvm::FunctionType* llvm_function_type(AST::FunctionLiteral*, Compiler&);
+
+} // namespace Compiler
@@ -2,6 +2,8 @@
 
 #include <iostream>
 
+#include <llvm/Support/raw_ostream.h>
+
 #include "error.hpp"
 
 namespace Compiler {
@@ -205,6 +207,13 @@ void print(Value h, int d) {
 	case ValueTag::Null:
 		print_spaces(d);
 		return void(std::cout << "(null)\n");
+	case ValueTag::LlvmValue: {
+		std::string text;
+		llvm::raw_string_ostream out {text};
+		h.get_llvm_value()->print(out);
+		print_spaces(d);
+		return void(std::cout << out.str() << '\n');
+	}
 	default:
 		assert(0);
 	}
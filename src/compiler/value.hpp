@@ -31,7 +31,7 @@ using CapturesType = std::vector<Reference*>;
 inline bool is_heap_type(ValueTag tag) {
 	return tag != ValueTag::Null && tag != ValueTag::Boolean &&
 	       tag != ValueTag::Integer && tag != ValueTag::Float &&
-		   tag != ValueTag::NativeFunction;
+		   tag != ValueTag::NativeFunction && tag != ValueTag::LlvmValue;
 }
 
 struct Value {
@@ -17,8 +17,8 @@ void compute_offsets(AST::Identifier* ast, int frame_offset) {
 	if (ast->m_origin == AST::Identifier::Origin::Local) {
 		ast->m_frame_offset = decl->m_frame_offset;
 	} else if (ast->m_origin == AST::Identifier::Origin::Capture) {
-		auto& capture_data = ast->m_surrounding_function->m_captures[ast->text()];
-		ast->m_frame_offset = capture_data.inner_frame_offset;
+		auto capture = ast->m_surrounding_function->m_captures.find(ast->text());
+		ast->m_frame_offset = capture->second.inner_frame_offset;
 	} else {
 		return;
 	}
@@ -68,7 +68,7 @@ void compute_offsets(AST::FunctionLiteral* ast, int frame_offset) {
 			// capture of a capture
 			// look at the captures of the surrounding function
 			kv.second.outer_frame_offset =
-			    ast->m_surrounding_function->m_captures[kv.first].inner_frame_offset;
+			    ast->m_surrounding_function->m_captures.find(kv.first)->second.inner_frame_offset;
 		}
 	}
 
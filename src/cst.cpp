@@ -126,7 +126,7 @@ void print_impl(BinaryExpression* cst, int d) {
 	std::cout << "(binary-expr\n";
 
 	print_indentation(d + indent_width);
-	std::cout << token_string[int(cst->m_op_token->m_type)] << '\n';
+	std::cout << token_string[int(cst->m_op_token.type())] << '\n';
 
 	print(cst->m_lhs, d + indent_width);
 	std::cout << "\n";
@@ -162,7 +162,7 @@ void print_impl(AccessExpression* cst, int d) {
 	print(cst->m_record, d + indent_width);
 	std::cout << "\n";
 	print_indentation(d + indent_width);
-	std::cout << "\"" << cst->m_member->m_text << "\"";
+	std::cout << "\"" << cst->m_member.text() << "\"";
 	std::cout << ")";
 }
 
@@ -186,8 +186,8 @@ void print_impl(MatchExpression* cst, int d) {
 	for (auto const& case_data : cst->m_cases) {
 		std::cout << "\n";
 		print_indentation(d + indent_width + 1);
-		std::cout << "(\"" << case_data.m_name->m_text.str() << "\" \""
-		          << case_data.m_identifier->m_text.str() << "\"\n";
+		std::cout << "(\"" << case_data.m_name.text() << "\" \""
+		          << case_data.m_identifier.text() << "\"\n";
 		print(case_data.m_type_hint, d + indent_width + 1);
 		std::cout << "\n";
 		print(case_data.m_expression, d + indent_width + 1);
@@ -5,6 +5,7 @@
 #include <cassert>
 
 #include "./utils/interned_string.hpp"
+#include "./utils/span.hpp"
 #include "cst_tag.hpp"
 #include "token.hpp"
 
@@ -22,39 +23,47 @@ struct CST {
 	[[nodiscard]] CSTTag type() const {
 		return m_type;
 	}
-	virtual ~CST() = default;
+
+  protected:
+	// nodes are freed with their allocator's pages, without running
+	// destructors, so they can't own anything
+	~CST() = default;
 };
 
 struct Block;
 
 struct DeclarationData {
-	Token const* m_identifier_token;
+	Token m_identifier_token;
 	CST* m_type_hint {nullptr};  // can be nullptr
 	CST* m_value {nullptr}; // can be nullptr
 
-	[[nodiscard]] InternedString const& identifier() const {
-		return m_identifier_token->m_text;
+	[[nodiscard]] InternedString identifier() const {
+		return m_identifier_token.interned();
 	}
 };
 
-using FuncParameters = std::vector<DeclarationData>;
+// Lists of children are spans into the ListArena of the CST::Allocator
+using FuncParameters = Span<DeclarationData>;
 
 struct Declaration : public CST {
 	// This function is very cold -- it's ok to use virtuals
-	[[nodiscard]] virtual InternedString const& identifier_virtual() const = 0;
+	[[nodiscard]] virtual InternedString identifier_virtual() const = 0;
 
 	Declaration(CSTTag tag)
 		: CST {tag} {}
+
+  protected:
+	~Declaration() = default;
 };
 
-struct PlainDeclaration : public Declaration {
+struct PlainDeclaration final : public Declaration {
 	DeclarationData m_data;
 
-	[[nodiscard]] InternedString const& identifier() const {
+	[[nodiscard]] InternedString identifier() const {
 		return m_data.identifier();
 	}
 
-	[[nodiscard]] InternedString const& identifier_virtual() const override {
+	[[nodiscard]] InternedString identifier_virtual() const override {
 		return identifier();
 	}
 
@@ -62,16 +71,16 @@ struct PlainDeclaration : public Declaration {
 	    : Declaration {CSTTag::PlainDeclaration} {}
 };
 
-struct FuncDeclaration : public Declaration {
-	Token const* m_identifier;
+struct FuncDeclaration final : public Declaration {
+	Token m_identifier;
 	FuncParameters m_args;
 	CST* m_body;
 
-	[[nodiscard]] InternedString const& identifier() const {
-		return m_identifier->m_text;
+	[[nodiscard]] InternedString identifier() const {
+		return m_identifier.interned();
 	}
 
-	[[nodiscard]] InternedString const& identifier_virtual() const override {
+	[[nodiscard]] InternedString identifier_virtual() const override {
 		return identifier();
 	}
 
@@ -79,16 +88,16 @@ struct FuncDeclaration : public Declaration {
 	    : Declaration {CSTTag::FuncDeclaration} {}
 };
 
-struct BlockFuncDeclaration : public Declaration {
-	Token const* m_identifier;
+struct BlockFuncDeclaration final : public Declaration {
+	Token m_identifier;
 	FuncParameters m_args;
 	Block* m_body;
 
-	[[nodiscard]] InternedString const& identifier() const {
-		return m_identifier->m_text;
+	[[nodiscard]] InternedString identifier() const {
+		return m_identifier.interned();
 	}
 
-	[[nodiscard]] InternedString const& identifier_virtual() const override {
+	[[nodiscard]] InternedString identifier_virtual() const override {
 		return identifier();
 	}
 
@@ -97,7 +106,7 @@ struct BlockFuncDeclaration : public Declaration {
 };
 
 struct Program : public CST {
-	std::vector<Declaration*> m_declarations;
+	Span<Declaration*> m_declarations;
 
 	Program()
 	    : CST {CSTTag::Program} {}
@@ -105,11 +114,11 @@ struct Program : public CST {
 
 struct IntegerLiteral : public CST {
 	bool m_negative {false};
-	Token const* m_sign {nullptr};
-	Token const* m_token;
+	Token m_sign {}; // can be null
+	Token m_token;
 
-	[[nodiscard]] std::string const& text() const {
-		return m_token->m_text.str();
+	[[nodiscard]] string_view text() const {
+		return m_token.text();
 	}
 
 	IntegerLiteral()
@@ -118,11 +127,11 @@ struct IntegerLiteral : public CST {
 
 struct NumberLiteral : public CST {
 	bool m_negative {false};
-	Token const* m_sign {nullptr};
-	Token const* m_token;
+	Token m_sign {}; // can be null
+	Token m_token;
 
-	[[nodiscard]] std::string const& text() const {
-		return m_token->m_text.str();
+	[[nodiscard]] string_view text() const {
+		return m_token.text();
 	}
 
 	NumberLiteral()
@@ -130,10 +139,10 @@ struct NumberLiteral : public CST {
 };
 
 struct StringLiteral : public CST {
-	Token const* m_token;
+	Token m_token;
 
-	[[nodiscard]] std::string const& text() const {
-		return m_token->m_text.str();
+	[[nodiscard]] string_view text() const {
+		return m_token.text();
 	}
 
 	StringLiteral()
@@ -141,10 +150,10 @@ struct StringLiteral : public CST {
 };
 
 struct BooleanLiteral : public CST {
-	Token const* m_token;
+	Token m_token;
 
-	[[nodiscard]] std::string const& text() const {
-		return m_token->m_text.str();
+	[[nodiscard]] string_view text() const {
+		return m_token.text();
 	}
 
 	BooleanLiteral()
@@ -158,7 +167,7 @@ struct NullLiteral : public CST {
 };
 
 struct ArrayLiteral : public CST {
-	std::vector<CST*> m_elements;
+	Span<CST*> m_elements;
 
 	ArrayLiteral()
 	    : CST {CSTTag::ArrayLiteral} {}
@@ -181,10 +190,10 @@ struct FunctionLiteral : public CST {
 };
 
 struct Identifier : public CST {
-	Token const* m_token;
+	Token m_token;
 
-	[[nodiscard]] InternedString const& text() const {
-		return m_token->m_text;
+	[[nodiscard]] InternedString text() const {
+		return m_token.interned();
 	}
 
 	Identifier()
@@ -192,7 +201,7 @@ struct Identifier : public CST {
 };
 
 struct BinaryExpression : public CST {
-	Token const* m_op_token;
+	Token m_op_token;
 	CST* m_lhs;
 	CST* m_rhs;
 
@@ -202,7 +211,7 @@ struct BinaryExpression : public CST {
 
 struct CallExpression : public CST {
 	CST* m_callee;
-	std::vector<CST*> m_args;
+	Span<CST*> m_args;
 
 	CallExpression()
 	    : CST {CSTTag::CallExpression} {}
@@ -218,7 +227,7 @@ struct IndexExpression : public CST {
 
 struct AccessExpression : public CST {
 	CST* m_record;
-	Token const* m_member;
+	Token m_member;
 
 	AccessExpression()
 	    : CST {CSTTag::AccessExpression} {}
@@ -235,8 +244,8 @@ struct TernaryExpression : public CST {
 
 struct MatchExpression : public CST {
 	struct CaseData {
-		Token const* m_name;
-		Token const* m_identifier;
+		Token m_name;
+		Token m_identifier;
 		CST* m_type_hint {nullptr};
 		CST* m_expression;
 	};
@@ -244,7 +253,7 @@ struct MatchExpression : public CST {
 	// TODO: allow matching on arbitrary expressions
 	Identifier m_matchee;
 	CST* m_type_hint {nullptr};
-	std::vector<CaseData> m_cases;
+	Span<CaseData> m_cases;
 
 	MatchExpression()
 	    : CST {CSTTag::MatchExpression} {}
@@ -252,7 +261,7 @@ struct MatchExpression : public CST {
 
 struct ConstructorExpression : public CST {
 	CST* m_constructor;
-	std::vector<CST*> m_args;
+	Span<CST*> m_args;
 
 	ConstructorExpression()
 	    : CST {CSTTag::ConstructorExpression} {}
@@ -267,7 +276,7 @@ struct SequenceExpression : public CST {
 };
 
 struct Block : public CST {
-	std::vector<CST*> m_body;
+	Span<CST*> m_body;
 
 	Block()
 	    : CST {CSTTag::Block} {}
@@ -309,7 +318,7 @@ struct WhileStatement : public CST {
 
 struct TypeTerm : public CST {
 	CST* m_callee;
-	std::vector<CST*> m_args;
+	Span<CST*> m_args;
 
 	TypeTerm()
 	    : CST {CSTTag::TypeTerm} {}
@@ -318,10 +327,10 @@ struct TypeTerm : public CST {
 // A TypeVar is a name, bound to a type variable of any kind.
 // e.g. a type function, a polytype or a monotype
 struct TypeVar : public CST {
-	Token const* m_token;
+	Token m_token;
 
-	[[nodiscard]] std::string const& text() const {
-		return m_token->m_text.str();
+	[[nodiscard]] string_view text() const {
+		return m_token.text();
 	}
 
 	TypeVar()
@@ -330,15 +339,15 @@ struct TypeVar : public CST {
 
 struct UnionExpression : public CST {
 	// TODO: better storage?
-	std::vector<Identifier> m_constructors;
-	std::vector<CST*> m_types;
+	Span<Identifier> m_constructors;
+	Span<CST*> m_types;
 
 	UnionExpression()
 	    : CST {CSTTag::UnionExpression} {}
 };
 
 struct TupleExpression : public CST {
-	std::vector<CST*> m_types;
+	Span<CST*> m_types;
 
 	TupleExpression()
 	    : CST {CSTTag::TupleExpression} {}
@@ -346,8 +355,8 @@ struct TupleExpression : public CST {
 
 struct StructExpression : public CST {
 	// TODO: better storage?
-	std::vector<Identifier> m_fields;
-	std::vector<CST*> m_types;
+	Span<Identifier> m_fields;
+	Span<CST*> m_types;
 
 	StructExpression()
 	    : CST {CSTTag::StructExpression} {}
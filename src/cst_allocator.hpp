@@ -1,30 +1,40 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "cst.hpp"
-#include "utils/polymorphic_block_allocator.hpp"
-#include "utils/polymorphic_dumb_allocator.hpp"
+#include "utils/list_arena.hpp"
+#include "utils/node_pools.hpp"
 
 namespace CST {
 
 struct Allocator {
-	static constexpr int small_size = 48;
-
-	PolymorphicBlockAllocator<CST> m_small;
-	PolymorphicDumbAllocator<CST> m_big;
+	NodePools<CST> m_nodes;
+	// children lists of every node
+	ListArena m_lists;
+	// allocators that hold nodes of trees owned by this one, like the
+	// per-thread ones of a parallel parse
+	std::vector<std::unique_ptr<Allocator>> m_adopted;
 
 	Allocator()
-	    : m_small(small_size, 4 * 4096)
-	    , m_big {4 * 4096} {}
+	    : m_nodes {}
+	    , m_lists {}
+	    , m_adopted {} {}
 
 	template<typename T>
 	T* make() {
-		if (small_size < sizeof(T)) {
-			return m_big.make<T>();
-		} else {
-			return m_small.make<T>();
-		}
+		return m_nodes.make<T>();
+	}
+
+	template<typename T>
+	Span<T> make_list(std::vector<T> const& elements) {
+		return m_lists.make(elements);
 	}
 
+	void adopt(std::unique_ptr<Allocator> other) {
+		m_adopted.push_back(std::move(other));
+	}
 };
 
 } // namespace CST
@@ -165,8 +165,8 @@ static AST::Expr* ct_eval(
 static
 std::unordered_map<InternedString, MonoId>
 build_map(
-    std::vector<InternedString> const& names,
-    std::vector<AST::Expr*> const& types,
+    Span<InternedString> names,
+    Span<AST::Expr*> types,
     TypeChecker& tc,
     AST::Allocator& alloc) {
 
@@ -187,7 +187,7 @@ build_map(
 static AST::TypeFunctionHandle* ct_eval(
     AST::StructExpression* ast, TypeChecker& tc, AST::Allocator& alloc) {
 
-	std::vector<InternedString> fields = ast->m_fields;
+	std::vector<InternedString> fields(ast->m_fields.begin(), ast->m_fields.end());
 
 	std::unordered_map<InternedString, MonoId> structure =
 	    build_map(ast->m_fields, ast->m_types, tc, alloc);
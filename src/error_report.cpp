@@ -1,24 +1,24 @@
 #include "error_report.hpp"
 
 #include <iostream>
-#include <sstream>
 
 bool ErrorReport::ok() const {
 	return m_sub_errors.empty() && m_text.empty();
 }
 
-void ErrorReport::print(int d) {
+void ErrorReport::print(LineIndex const& lines, int d) const {
 	for (int i = 0; i < d; ++i)
 		std::cerr << '-';
 
-	std::cerr << ' ' << m_text << '\n';
+	std::cerr << ' ';
+	if (m_offset != -1)
+		std::cerr << "At " << lines.locate(m_offset).to_string() << " : ";
+	std::cerr << m_text << '\n';
 
 	for (auto& sub : m_sub_errors)
-		sub.print(d + 1);
+		sub.print(lines, d + 1);
 }
 
-ErrorReport make_located_error(string_view text, SourceLocation location) {
-	std::stringstream ss;
-	ss << "At " << location.to_string() << " : " << text;
-	return ErrorReport {ss.str()};
+ErrorReport make_located_error(string_view text, int offset) {
+	return ErrorReport {std::string(text.begin(), text.end()), {}, offset};
 }
@@ -9,9 +9,11 @@
 struct ErrorReport {
 	std::string m_text;
 	std::vector<ErrorReport> m_sub_errors;
+	// byte offset into the source the error refers to, or -1
+	int m_offset {-1};
 
 	[[nodiscard]] bool ok() const;
-	void print(int d = 1);
+	void print(LineIndex const& lines, int d = 1) const;
 };
 
-ErrorReport make_located_error(string_view text, SourceLocation location);
+ErrorReport make_located_error(string_view text, int offset);
@@ -0,0 +1,419 @@
+#include "daemon.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../log/log.hpp"
+#include "../source_file.hpp"
+#include "interpreter.hpp"
+#include "session.hpp"
+#include "value.hpp"
+
+namespace Interpreter {
+
+using Clock = std::chrono::steady_clock;
+
+static bool write_all(int fd, std::string const& data) {
+	size_t written = 0;
+	while (written < data.size()) {
+		ssize_t n = write(fd, data.data() + written, data.size() - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		written += n;
+	}
+	return true;
+}
+
+static bool open_socket(char const* socket_path, sockaddr_un& address) {
+	address = {};
+	address.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(address.sun_path)) {
+		Log::error() << "Socket path '" << socket_path << "' is too long";
+		return false;
+	}
+	strcpy(address.sun_path, socket_path);
+	return true;
+}
+
+static int remaining_ms(Clock::time_point deadline) {
+	auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+	return left.count() > 0 ? int(left.count()) : 0;
+}
+
+// Reads up to the first line break. Returns false if the client takes
+// longer than the timeout to send it, or hangs up before
+static bool read_line(int fd, std::string& line, int timeout_ms) {
+	auto const deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (true) {
+		pollfd readable {fd, POLLIN, 0};
+		int ready = poll(&readable, 1, remaining_ms(deadline));
+		if (ready < 0 && errno == EINTR)
+			continue;
+		if (ready <= 0)
+			return false;
+
+		char c;
+		ssize_t n = read(fd, &c, 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		if (c == '\n')
+			return true;
+		line.push_back(c);
+	}
+}
+
+// exit status of a child, as a shell would report it
+static int exit_status(int wait_status) {
+	if (WIFSIGNALED(wait_status))
+		return 128 + WTERMSIG(wait_status);
+	return WEXITSTATUS(wait_status);
+}
+
+// Waits for a child to exit, and kills it if it is still running by the
+// deadline. Returns its exit status, or -1 if it had to be killed
+static int wait_or_kill(pid_t pid, Clock::time_point deadline) {
+	int wait_status = 0;
+	while (true) {
+		pid_t done = waitpid(pid, &wait_status, WNOHANG);
+		if (done == pid)
+			return exit_status(wait_status);
+		if (done < 0 && errno != EINTR)
+			return 1;
+		if (Clock::now() >= deadline)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	kill(pid, SIGKILL);
+	while (waitpid(pid, &wait_status, 0) < 0 && errno == EINTR) {}
+	return -1;
+}
+
+// expression of the eval request that is being handled. Runners can't
+// capture anything
+static std::string s_expression;
+
+static ExitStatus run_expression(Interpreter& env, Frontend::SymbolTable& context) {
+	print(eval_expression(s_expression, env, context));
+	return ExitStatus::Ok;
+}
+
+// One generation of the daemon. See serve() for how generations replace
+// each other
+struct Daemon {
+	ExecuteSettings m_settings;
+	DaemonLimits m_limits;
+	int m_listener {-1};
+	// closes when serve() exits, which is when generations stop too
+	int m_lifeline {-1};
+	std::unordered_map<std::string, std::unique_ptr<Session>> m_sessions {};
+	// the session of the last program that was run
+	Session* m_last {nullptr};
+
+	Session& session_for(std::string const& path) {
+		auto& session = m_sessions[path];
+		if (!session)
+			session = std::make_unique<Session>(m_settings);
+		return *session;
+	}
+
+	// Evaluates in a child that writes to the connection, so that crashes
+	// and fatal errors in the program don't take us down. Returns the exit
+	// status of the child
+	template <typename Evaluate>
+	int fork_evaluation(int connection, Evaluate evaluate) {
+		// or the child would print them again
+		std::cout.flush();
+		std::cerr.flush();
+
+		auto const deadline = Clock::now() + std::chrono::milliseconds(m_limits.request_timeout_ms);
+		pid_t pid = fork();
+		if (pid < 0)
+			return 1;
+
+		if (pid == 0) {
+			close(m_listener);
+			close(m_lifeline);
+			dup2(connection, STDOUT_FILENO);
+			dup2(connection, STDERR_FILENO);
+
+			auto status = evaluate();
+
+			std::cout.flush();
+			std::cerr.flush();
+			std::clog.flush();
+			_exit(static_cast<int>(status));
+		}
+
+		int status = wait_or_kill(pid, deadline);
+		if (status == -1) {
+			write_all(connection, "Timed out\n");
+			status = 128 + SIGKILL;
+		}
+		return status;
+	}
+
+	// The frontend exits on errors, so it also runs in a child. If it passes,
+	// the child has the checked state, and becomes the next generation of
+	// the daemon: it tells us through a pipe, and we exit. Otherwise we are
+	// still the current generation. Either way the frontend only runs once.
+	//
+	// Returns true in the process that is the current generation afterwards,
+	// with the exit status of the request in `status`, or -1 if the child
+	// took over and the request is still being answered
+	bool fork_check(int connection, Session& session, SourceFile const& source, int& status) {
+		int passed_pipe[2];
+		if (pipe(passed_pipe) != 0) {
+			status = 1;
+			return true;
+		}
+
+		std::cout.flush();
+		std::cerr.flush();
+
+		auto const deadline = Clock::now() + std::chrono::milliseconds(m_limits.request_timeout_ms);
+		pid_t pid = fork();
+		if (pid < 0) {
+			close(passed_pipe[0]);
+			close(passed_pipe[1]);
+			status = 1;
+			return true;
+		}
+
+		if (pid == 0) {
+			close(passed_pipe[0]);
+			int const saved_out = dup(STDOUT_FILENO);
+			int const saved_err = dup(STDERR_FILENO);
+			dup2(connection, STDOUT_FILENO);
+			dup2(connection, STDERR_FILENO);
+
+			auto check_status = session.check(source);
+
+			std::cout.flush();
+			std::cerr.flush();
+			std::clog.flush();
+			if (check_status != ExitStatus::Ok)
+				_exit(static_cast<int>(check_status));
+
+			dup2(saved_out, STDOUT_FILENO);
+			dup2(saved_err, STDERR_FILENO);
+			close(saved_out);
+			close(saved_err);
+
+			char passed = 1;
+			(void)!write(passed_pipe[1], &passed, 1);
+			close(passed_pipe[1]);
+
+			m_last = &session;
+			status = -1;
+			return true;
+		}
+
+		close(passed_pipe[1]);
+
+		// the pipe gets a byte if the check passed, and closes when the child
+		// exits without passing
+		char passed = 0;
+		bool timed_out = false;
+		while (true) {
+			pollfd readable {passed_pipe[0], POLLIN, 0};
+			int ready = poll(&readable, 1, remaining_ms(deadline));
+			if (ready < 0 && errno == EINTR)
+				continue;
+			if (ready == 0)
+				timed_out = true;
+			else if (ready > 0 && read(passed_pipe[0], &passed, 1) < 0 && errno == EINTR)
+				continue;
+			break;
+		}
+		close(passed_pipe[0]);
+
+		if (passed) {
+			// the child answers the request, and serves from now on
+			_exit(0);
+		}
+
+		status = wait_or_kill(pid, timed_out ? Clock::now() : deadline);
+		if (status == -1) {
+			write_all(connection, "Timed out\n");
+			status = 128 + SIGKILL;
+		}
+		return true;
+	}
+
+	void handle(int connection) {
+		std::string request;
+		int status = 1;
+
+		if (!read_line(connection, request, m_limits.read_timeout_ms)) {
+			write_all(connection, "No request received\n");
+		} else if (request.rfind("run ", 0) == 0) {
+			std::string const path = request.substr(4);
+			SourceFile source;
+			if (source.load(path.c_str())) {
+				Session& session = session_for(path);
+				fork_check(connection, session, source, status);
+				// we are the new generation, and still have to run it
+				if (status == -1)
+					status = fork_evaluation(connection, [&] { return session.run(run_invoke); });
+			} else {
+				write_all(connection, "Failed to open '" + path + "'\n");
+			}
+		} else if (request.rfind("eval ", 0) == 0) {
+			if (m_last) {
+				s_expression = request.substr(5);
+				status = fork_evaluation(connection, [&] { return m_last->run(run_expression); });
+			} else {
+				write_all(connection, "No program has been run yet\n");
+			}
+		} else {
+			write_all(connection, "Unknown request '" + request + "'\n");
+		}
+
+		write_all(connection, "exit " + std::to_string(status) + "\n");
+		close(connection);
+	}
+
+	// Serves connections one at a time, until serve() goes away
+	[[noreturn]] void serve_connections() {
+		while (true) {
+			pollfd events[2] = {{m_listener, POLLIN, 0}, {m_lifeline, POLLIN, 0}};
+			int ready = poll(events, 2, -1);
+			if (ready < 0 && errno == EINTR)
+				continue;
+			if (ready < 0 || events[1].revents)
+				_exit(0);
+
+			int connection = accept(m_listener, nullptr, nullptr);
+			if (connection < 0) {
+				if (errno == EINTR)
+					continue;
+				Log::error() << "Failed to accept a connection: " << strerror(errno);
+				_exit(1);
+			}
+			handle(connection);
+		}
+	}
+};
+
+// Generations of the daemon run in children of this process, which only
+// waits on them. Each generation is forked from the one before it, so this
+// process is made a subreaper to get them as children when their parents
+// exit. If they are all gone before their time, a fresh one is started.
+int serve(char const* socket_path, ExecuteSettings settings, DaemonLimits limits) {
+	sockaddr_un address;
+	if (!open_socket(socket_path, address))
+		return 1;
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socket_path);
+	if (listener < 0 ||
+	    bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+	    listen(listener, 16) != 0) {
+		Log::error() << "Failed to listen on '" << socket_path << "': " << strerror(errno);
+		return 1;
+	}
+
+	int lifeline[2];
+	if (pipe(lifeline) != 0 || prctl(PR_SET_CHILD_SUBREAPER, 1) != 0) {
+		Log::error() << "Failed to set up the daemon: " << strerror(errno);
+		return 1;
+	}
+
+	// clients that hang up early shouldn't kill us
+	signal(SIGPIPE, SIG_IGN);
+
+	while (true) {
+		std::cout.flush();
+		std::cerr.flush();
+
+		pid_t generation = fork();
+		if (generation < 0) {
+			Log::error() << "Failed to start the daemon: " << strerror(errno);
+			return 1;
+		}
+
+		if (generation == 0) {
+			close(lifeline[1]);
+			Daemon daemon {settings, limits, listener, lifeline[0]};
+			daemon.serve_connections();
+		}
+
+		int wait_status = 0;
+		int last_status = 0;
+		while (wait(&wait_status) >= 0 || errno == EINTR)
+			last_status = wait_status;
+
+		// a generation that can't accept connections would keep failing
+		if (WIFEXITED(last_status) && WEXITSTATUS(last_status) != 0)
+			return 1;
+		Log::error() << "The daemon stopped unexpectedly, starting over";
+	}
+}
+
+int send_request(char const* socket_path, std::string const& request, std::string& output) {
+	sockaddr_un address;
+	if (!open_socket(socket_path, address))
+		return 1;
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		output = "Failed to connect to '" + std::string(socket_path) + "'\n";
+		if (fd >= 0)
+			close(fd);
+		return 1;
+	}
+
+	write_all(fd, request + "\n");
+	shutdown(fd, SHUT_WR);
+
+	std::string response;
+	char buffer[4096];
+	ssize_t n;
+	while ((n = read(fd, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR))
+		if (n > 0)
+			response.append(buffer, n);
+	close(fd);
+
+	// the response ends in "exit <status>\n", which may follow the output
+	// without a line break in between
+	size_t end = response.size();
+	if (end > 0 && response[end - 1] == '\n')
+		end -= 1;
+	size_t digits = end;
+	while (digits > 0 && isdigit(response[digits - 1]))
+		digits -= 1;
+	if (digits == end || digits < 5 || response.compare(digits - 5, 5, "exit ") != 0) {
+		output = response + "Malformed response from the daemon\n";
+		return 1;
+	}
+
+	output = response.substr(0, digits - 5);
+	return std::stoi(response.substr(digits, end - digits));
+}
+
+int send_request(char const* socket_path, std::string const& request) {
+	std::string output;
+	int status = send_request(socket_path, request, output);
+	std::cout << output << std::flush;
+	return status;
+}
+
+} // namespace Interpreter
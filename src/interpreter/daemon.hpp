@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+#include "execute.hpp"
+
+namespace Interpreter {
+
+// A long-lived process that runs programs for clients connecting through a
+// unix socket, so that they don't pay for starting up the interpreter, and
+// programs that are run again only go through the frontend for what changed.
+//
+// Each connection sends one request line, and gets back everything the
+// program printed, followed by a last line with its exit status:
+//
+//     run <absolute path>   runs the program in that file
+//     eval <expression>     evaluates an expression in the last program run
+//
+// Programs are evaluated in forked children, so that crashes or fatal errors
+// in them can't take the daemon down. The frontend also exits on errors, so
+// it runs in a forked child too, and a child that gets through it carries on
+// as the daemon, with the new frontend state, while its parent exits. That
+// way each version is only checked once. Sessions compact themselves (see
+// Session), so the state kept for a program stays bounded however many
+// times it is edited.
+//
+// Connections are handled one at a time. Clients that don't send their
+// request in time are dropped, and requests that run for too long are killed,
+// so neither can hold up the ones behind them.
+struct DaemonLimits {
+	// how long a client has to send its request line
+	int read_timeout_ms {5000};
+	// how long checking and running a program may take
+	int request_timeout_ms {60000};
+};
+
+// Returns when the socket can't be set up; otherwise it serves forever
+int serve(char const* socket_path, ExecuteSettings settings, DaemonLimits limits = {});
+
+// sends a request to a daemon, copies the output to stdout, and returns the
+// exit status of the request
+int send_request(char const* socket_path, std::string const& request);
+// same, but keeps the output in `output`
+int send_request(char const* socket_path, std::string const& request, std::string& output);
+
+} // namespace Interpreter
@@ -11,18 +11,28 @@
 #include "../utils/span.hpp"
 #include "garbage_collector.hpp"
 #include "interpreter.hpp"
+#include "profiler.hpp"
+#include "tiering.hpp"
 #include "utils.hpp"
 #include "value.hpp"
 
 namespace Interpreter {
 
 static void eval_stmt(AST::AST* ast, Interpreter& e) {
+	if (e.m_profiler)
+		e.m_profiler->at(ast);
 	eval(ast, e);
 	if (is_expression(ast))
 		e.m_stack.pop_unsafe();
 }
 
+static void name_for_profiler(AST::Declaration* ast, Interpreter& e) {
+	if (e.m_profiler && ast->m_value && ast->m_value->type() == ASTTag::FunctionLiteral)
+		e.m_profiler->name_function(static_cast<AST::FunctionLiteral*>(ast->m_value), ast);
+}
+
 void eval(AST::Declaration* ast, Interpreter& e) {
+	name_for_profiler(ast, e);
 	auto ref = e.new_reference(Value {nullptr});
 	e.m_stack.push(ref.as_value());
 	if (ast->m_value) {
@@ -38,6 +48,7 @@ void eval(AST::Program* ast, Interpreter& e) {
 		for (auto decl : comp) {
 			auto ref = e.new_reference(e.null());
 			e.global_declare_direct(decl->identifier_text(), ref.get());
+			name_for_profiler(decl, e);
 			eval(decl->m_value, e);
 			auto value = e.m_stack.pop_unsafe();
 			ref->m_value = value_of(value);
@@ -54,7 +65,7 @@ void eval(AST::IntegerLiteral* ast, Interpreter& e) {
 }
 
 void eval(AST::StringLiteral* ast, Interpreter& e) {
-	e.push_string(ast->text());
+	e.push_string(std::string(ast->text()));
 }
 
 void eval(AST::BooleanLiteral* ast, Interpreter& e) {
@@ -120,16 +131,36 @@ auto is_callable_type(ValueTag t) -> bool {
 	return t == ValueTag::Function || t == ValueTag::NativeFunction;
 }
 
+static void eval_function_body(Function* callee, Interpreter& e) {
+	AST::FunctionLiteral* caller = nullptr;
+	if (e.m_tiering) {
+		if (e.m_tiering->try_call_native(callee, e))
+			return;
+		caller = e.m_tiering->m_current;
+		e.m_tiering->m_current = callee->m_def;
+	}
+
+	for (auto capture : callee->m_captures)
+		e.m_stack.push(Value{capture});
+
+	eval(callee->m_def->m_body, e);
+
+	if (e.m_tiering)
+		e.m_tiering->m_current = caller;
+}
+
 void eval_call_function(Function* callee, size_t arg_count, Interpreter& e) {
 
 	// TODO: error handling ?
 	assert(callee->m_def->m_args.size() == arg_count);
 
-	for (auto capture : callee->m_captures)
-		e.m_stack.push(Value{capture});
+	if (e.m_profiler)
+		e.m_profiler->enter(callee->m_def);
 
-	eval(callee->m_def->m_body, e);
+	eval_function_body(callee, e);
 
+	if (e.m_profiler)
+		e.m_profiler->exit();
 }
 
 void eval(AST::CallExpression* ast, Interpreter& e) {
@@ -333,11 +364,14 @@ void eval(AST::WhileStatement* ast, Interpreter& e) {
 
 		if (e.m_returning)
 			break;
+
+		if (e.m_tiering)
+			e.m_tiering->count_back_edge();
 	}
 }
 
 void eval(AST::StructExpression* ast, Interpreter& e) {
-	e.push_record_constructor(ast->m_fields);
+	e.push_record_constructor({ast->m_fields.begin(), ast->m_fields.end()});
 }
 
 void eval(AST::UnionExpression* ast, Interpreter& e) {
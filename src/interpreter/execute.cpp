@@ -2,13 +2,17 @@
 
 #include "../ast.hpp"
 #include "../ast_allocator.hpp"
+#include "../ast_cache.hpp"
 #include "../compute_offsets.hpp"
 #include "../cst_allocator.hpp"
 #include "../ct_eval.hpp"
 #include "../lexer.hpp"
+#include "../log/log.hpp"
 #include "../match_identifiers.hpp"
 #include "../metacheck.hpp"
 #include "../parser.hpp"
+#include "../source_file.hpp"
+#include "../source_location.hpp"
 #include "../symbol_table.hpp"
 #include "../token_array.hpp"
 #include "../typecheck.hpp"
@@ -17,49 +21,96 @@
 #include "garbage_collector.hpp"
 #include "interpreter.hpp"
 #include "native.hpp"
+#include "profiler.hpp"
+#include "tiering.hpp"
 #include "utils.hpp"
 
 namespace Interpreter {
 
+// evaluates a program that went through the frontend, and hands it to the
+// runner. `source` is only needed for profiling
+static ExitStatus run_program(
+	AST::AST* ast,
+	TypeChecker::TypeChecker& tc,
+	Frontend::SymbolTable& context,
+	char const* source,
+	ExecuteSettings const& settings,
+	Runner* runner
+) {
+	GC gc;
+	Interpreter env = {&tc, &gc, &tc.m_env.declaration_components};
+	Tiering tiering {settings.tier_up_threshold};
+	if (settings.tiering)
+		env.m_tiering = &tiering;
+	// line numbers are only needed when profiling
+	LineIndex line_index;
+	if (!settings.profile_output.empty())
+		line_index = LineIndex {source};
+	Profiler profiler {&gc, &line_index};
+	if (!settings.profile_output.empty())
+		env.m_profiler = &profiler;
+	declare_native_functions(env);
+	eval(ast, env);
+
+	auto status = runner(env, context);
+
+	if (env.m_profiler && !profiler.write(settings.profile_output))
+		Log::error() << "Failed to write profile to '" << settings.profile_output << "'";
+
+	return status;
+}
+
 ExitStatus execute(
-	std::string const& source,
+	SourceFile const& source,
 	ExecuteSettings settings,
 	Runner* runner
 ) {
-	TokenArray const ta = tokenize(source.c_str());
+	Lexer lexer {source.data()};
 
-	CST::Allocator cst_allocator;
-	auto parse_result = parse_program(ta, cst_allocator);
+	AST::Allocator ast_allocator;
+	AST::AST* ast;
 
-	if (not parse_result.ok()) {
-		parse_result.m_error.print();
-		return ExitStatus::ParseError;
-	}
+	// the CST is only used to build the AST, so it's freed right after that
+	{
+		CST::Allocator cst_allocator;
+		Writer<CST::CST*> parse_result;
+		if (settings.parse_threads > 1) {
+			// the declarations have to be found before they are split up
+			lexer.lex_all();
+			parse_result = parse_program(lexer.m_tokens, cst_allocator, settings.parse_threads);
+		} else {
+			parse_result = parse_program(lexer, cst_allocator);
+		}
 
-	auto cst = parse_result.m_result;
+		if (not parse_result.ok()) {
+			parse_result.error().print(LineIndex {source.data()});
+			return ExitStatus::ParseError;
+		}
 
-	if (settings.dump_cst)
-		print(cst, 1);
+		auto cst = parse_result.m_result;
 
-	// Can this even happen? parse_program should always either return a
-	// Program or an error
-	if (cst->type() != CSTTag::Program)
-		return ExitStatus::TopLevelTypeError;
+		if (settings.dump_cst)
+			print(cst, 1);
 
-	AST::Allocator ast_allocator;
-	auto ast = AST::convert_ast(cst, ast_allocator);
+		// Can this even happen? parse_program should always either return a
+		// Program or an error
+		if (cst->type() != CSTTag::Program)
+			return ExitStatus::TopLevelTypeError;
+
+		ast = AST::convert_ast(cst, ast_allocator);
+	}
 
 	// creates and stores a bunch of builtin declarations
 	TypeChecker::TypeChecker tc{ast_allocator};
 	Frontend::SymbolTable context;
 
 	{
-		for (auto& bucket : tc.m_builtin_declarations.m_buckets)
-			for (auto& decl : bucket)
-				context.declare(&decl);
-		auto err = Frontend::match_identifiers(ast, context);
+		tc.m_builtin_declarations.for_each([&](AST::Declaration& decl) {
+			context.declare(&decl);
+		});
+		auto err = Frontend::match_identifiers(ast, context, ast_allocator);
 		if (!err.ok()) {
-			err.print();
+			err.print(LineIndex {source.data()});
 			return ExitStatus::StaticError;
 		}
 	}
@@ -75,14 +126,63 @@ ExitStatus execute(
 
 	TypeChecker::compute_offsets(ast, 0);
 
-	GC gc;
-	Interpreter env = {&tc, &gc, &tc.m_env.declaration_components};
-	declare_native_functions(env);
-	eval(ast, env);
+	if (!settings.ast_cache_output.empty() &&
+	    !AST::write_cache(
+	        settings.ast_cache_output,
+	        source.view(),
+	        static_cast<AST::Program*>(ast),
+	        tc.m_env.declaration_components,
+	        tc))
+		Log::error() << "Failed to write AST cache to '" << settings.ast_cache_output << "'";
 
-	return runner(env, context);
+	return run_program(ast, tc, context, source.data(), settings, runner);
 }
 
+ExitStatus execute_cache(
+	SourceFile const& image,
+	ExecuteSettings settings,
+	Runner* runner
+) {
+	AST::Allocator ast_allocator;
+	TypeChecker::TypeChecker tc{ast_allocator};
+
+	auto program = AST::read_cache(
+	    image.view(), ast_allocator, tc, tc.m_env.declaration_components);
+	if (!program) {
+		Log::error() << "Not an AST cache written by this version of the interpreter";
+		return ExitStatus::StaticError;
+	}
+
+	Frontend::SymbolTable context;
+	tc.m_builtin_declarations.for_each([&](AST::Declaration& decl) {
+		context.declare(&decl);
+	});
+	for (auto& decl : program->m_declarations)
+		context.declare(&decl);
+
+	settings.profile_output.clear();
+	return run_program(program, tc, context, nullptr, settings, runner);
+}
+
+ExitStatus run_invoke(Interpreter& env, Frontend::SymbolTable& context) {
+	// NOTE: We currently implement funcion evaluation in eval(ASTCallExpression)
+	// this means we need to create a call expression node to run the program.
+	// TODO: We need to clean this up
+	TokenArray const ta = tokenize("__invoke()");
+
+	CST::Allocator cst_allocator;
+	auto top_level_call_ast = parse_expression(ta, cst_allocator);
+
+	AST::Allocator ast_allocator;
+	auto top_level_call = AST::convert_ast(top_level_call_ast.m_result, ast_allocator);
+
+	eval(top_level_call, env);
+	auto result = env.m_stack.pop_unsafe();
+
+	print(result);
+
+	return ExitStatus::Ok;
+}
 
 // FIXME: This does not handle seq-expressions, or inline definitions of
 // functions, because it does not call `match_identifiers` or `compute_offsets`.
@@ -96,18 +196,19 @@ Value eval_expression(
 ) {
 	TokenArray const ta = tokenize(expr.c_str());
 
-	CST::Allocator cst_allocator;
-	auto parse_result = parse_expression(ta, cst_allocator);
-	// TODO: handle parse error
-	auto cst = parse_result.m_result;
-
 	AST::Allocator ast_allocator;
-	auto ast = AST::convert_ast(cst, ast_allocator);
+	AST::AST* ast;
+	{
+		CST::Allocator cst_allocator;
+		auto parse_result = parse_expression(ta, cst_allocator);
+		// TODO: handle parse error
+		ast = AST::convert_ast(parse_result.m_result, ast_allocator);
+	}
 
 	{
-		auto err = Frontend::match_identifiers(ast, context);
+		auto err = Frontend::match_identifiers(ast, context, ast_allocator);
 		if (!err.ok()) {
-			err.print();
+			err.print(LineIndex {expr.c_str()});
 			return env.null();
 		}
 	}
@@ -4,6 +4,8 @@
 #include "value.hpp"
 #include <string>
 
+struct SourceFile;
+
 namespace Frontend {
 struct SymbolTable;
 }
@@ -17,15 +19,37 @@ using Runner = auto(Interpreter&, Frontend::SymbolTable&) -> ExitStatus;
 struct ExecuteSettings {
 	bool dump_cst {false};
 	bool typecheck {true};
+	// parse top-level declarations on this many threads
+	int parse_threads {1};
+	// compile hot functions with the JIT
+	bool tiering {false};
+	// invocations plus loop iterations before a function gets compiled
+	int tier_up_threshold {1000};
+	// where to write a folded stacks profile. Empty disables profiling
+	std::string profile_output {};
+	// where to write the program once it's through the frontend, so that
+	// later runs can skip it. Empty disables it
+	std::string ast_cache_output {};
 };
 
 // returns an exit status
 ExitStatus execute(
-	std::string const& source,
+	SourceFile const& source,
+	ExecuteSettings settings,
+	Runner* runner
+);
+
+// runs a program from an image written through `ast_cache_output`. The
+// source isn't available, so profiling isn't either
+ExitStatus execute_cache(
+	SourceFile const& image,
 	ExecuteSettings settings,
 	Runner* runner
 );
 
+// runner that calls the program's __invoke function and prints the result
+ExitStatus run_invoke(Interpreter&, Frontend::SymbolTable&);
+
 // evaluates an expression and returns the resulting value
 Value eval_expression(
 	const std::string& expr,
@@ -55,6 +55,7 @@ void GC::add_root(GcCell* new_root) {
 gc_ptr<Variant> GC::new_variant(InternedString constructor, Value v) {
 	auto result = new Variant(constructor, v);
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
@@ -62,6 +63,7 @@ gc_ptr<Record> GC::new_record(RecordType declarations) {
 	auto result = new Record;
 	result->m_value = std::move(declarations);
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
@@ -69,6 +71,7 @@ gc_ptr<Array> GC::new_list(ArrayType elements) {
 	auto result = new Array;
 	result->m_value = std::move(elements);
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
@@ -79,36 +82,42 @@ gc_ptr<String> GC::new_string(std::string s) {
 String* GC::new_string_raw(std::string s) {
 	auto result = new String(std::move(s));
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
 gc_ptr<Function> GC::new_function(FunctionType def, CapturesType captures) {
 	auto result = new Function(std::move(def), std::move(captures));
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
 gc_ptr<Error> GC::new_error(std::string s) {
 	auto result = new Error(std::move(s));
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
 gc_ptr<Reference> GC::new_reference(Value v) {
 	auto result = new Reference(std::move(v));
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
 VariantConstructor* GC::new_variant_constructor_raw(InternedString constructor) {
 	auto result = new VariantConstructor(constructor);
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
 RecordConstructor* GC::new_record_constructor_raw(std::vector<InternedString> keys) {
 	auto result = new RecordConstructor(std::move(keys));
 	m_blocks.push_back(result);
+	m_allocation_count += 1;
 	return result;
 }
 
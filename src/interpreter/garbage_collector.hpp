@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "gc_ptr.hpp"
@@ -13,6 +14,8 @@ struct GC {
   public:
 	std::vector<GcCell*> m_blocks;
 	std::vector<GcCell*> m_roots;
+	// total number of cells ever allocated
+	uint64_t m_allocation_count {0};
 
 	GC();
 	~GC();
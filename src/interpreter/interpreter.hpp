@@ -18,6 +18,8 @@ namespace Interpreter {
 
 struct GC;
 struct Error;
+struct Tiering;
+struct Profiler;
 
 struct Scope {
 	std::map<InternedString, Reference*> m_declarations;
@@ -35,6 +37,8 @@ struct Interpreter {
 	bool m_returning{false};
 	Value m_return_value {nullptr};
 	Scope m_global_scope;
+	Tiering* m_tiering {nullptr}; // null unless tiering is enabled
+	Profiler* m_profiler {nullptr}; // null unless profiling is enabled
 
 	Interpreter(
 	    TypeChecker::TypeChecker* tc,
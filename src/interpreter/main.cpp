@@ -1,71 +1,84 @@
-#include <fstream>
+#include <filesystem>
 #include <iostream>
-#include <sstream>
 #include <string>
 
-#include "../ast.hpp"
-#include "../ast_allocator.hpp"
-#include "../cst_allocator.hpp"
-#include "../lexer.hpp"
-#include "../parser.hpp"
-#include "../symbol_table.hpp"
-#include "../token_array.hpp"
-#include "eval.hpp"
+#include "../ast_cache.hpp"
+#include "../source_file.hpp"
+#include "daemon.hpp"
 #include "execute.hpp"
 #include "exit_status_tag.hpp"
-#include "interpreter.hpp"
-#include "value.hpp"
 
 int main(int argc, char** argv) {
 
-	if (argc < 2) {
+	Interpreter::ExecuteSettings settings;
+	char const* source_file = nullptr;
+	char const* daemon_socket = nullptr;
+	char const* connect_socket = nullptr;
+	char const* expression = nullptr;
+	char const* ast_cache = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--tiering") {
+			settings.tiering = true;
+		} else if (arg.rfind("--profile=", 0) == 0) {
+			settings.profile_output = arg.substr(10);
+		} else if (arg.rfind("--parse-threads=", 0) == 0) {
+			settings.parse_threads = std::stoi(arg.substr(16));
+		} else if (arg.rfind("--daemon=", 0) == 0) {
+			daemon_socket = argv[i] + 9;
+		} else if (arg.rfind("--connect=", 0) == 0) {
+			connect_socket = argv[i] + 10;
+		} else if (arg.rfind("--eval=", 0) == 0) {
+			expression = argv[i] + 7;
+		} else if (arg.rfind("--emit-ast-cache=", 0) == 0) {
+			settings.ast_cache_output = arg.substr(17);
+		} else if (arg.rfind("--ast-cache=", 0) == 0) {
+			ast_cache = argv[i] + 12;
+		} else if (arg.rfind("--", 0) == 0) {
+			std::cout << "Unknown option '" << arg << "'" << std::endl;
+			return 1;
+		} else {
+			source_file = argv[i];
+		}
+	}
+
+	if (daemon_socket)
+		return Interpreter::serve(daemon_socket, settings);
+
+	if (connect_socket && expression)
+		return Interpreter::send_request(connect_socket, std::string("eval ") + expression);
+
+	if (connect_socket && source_file)
+		return Interpreter::send_request(
+		    connect_socket, "run " + std::filesystem::absolute(source_file).string());
+
+	if (!source_file && !ast_cache) {
 		std::cout << "Argument missing: source file" << std::endl;
 		return 1;
 	}
 
-	std::ifstream in_fs(argv[1]);
-	if (!in_fs.good()) {
-		std::cout << "Failed to open '" << argv[1] << "'" << std::endl;
+	SourceFile source;
+	if (source_file && !source.load(source_file)) {
+		std::cout << "Failed to open '" << source_file << "'" << std::endl;
 		return 1;
 	}
 
-	std::stringstream file_content;
-	std::string line;
-
-	while (std::getline(in_fs, line)) {
-		file_content << line << '\n';
+	// the cache is used unless it was made from a different version of the
+	// given source, in which case the source is run instead
+	if (ast_cache) {
+		SourceFile image;
+		bool const loaded = image.load(ast_cache);
+		if (!loaded && !source_file) {
+			std::cout << "Failed to open '" << ast_cache << "'" << std::endl;
+			return 1;
+		}
+
+		if (loaded && (!source_file || AST::is_cache_for(image.view(), source.view())))
+			return static_cast<int>(execute_cache(image, settings, Interpreter::run_invoke));
 	}
 
-	std::string source = file_content.str();
-
-	Interpreter::ExecuteSettings settings;
-
-	ExitStatus exit_code = execute(
-	    source,
-	    settings,
-	    +[](Interpreter::Interpreter& env,
-	        Frontend::SymbolTable& context) -> ExitStatus {
-		    // NOTE: We currently implement funcion evaluation in eval(ASTCallExpression)
-		    // this means we need to create a call expression node to run the program.
-		    // TODO: We need to clean this up
-
-		    {
-			    TokenArray const ta = tokenize("__invoke()");
-
-			    CST::Allocator cst_allocator;
-			    auto top_level_call_ast = parse_expression(ta, cst_allocator);
-
-			    AST::Allocator ast_allocator;
-			    auto top_level_call = AST::convert_ast(top_level_call_ast.m_result, ast_allocator);
-
-				eval(top_level_call, env);
-			    auto result = env.m_stack.pop_unsafe();
-
-				Interpreter::print(result);
-		    }
-
-		    return ExitStatus::Ok;
-	    });
+	ExitStatus exit_code = execute(source, settings, Interpreter::run_invoke);
 
 	return static_cast<int>(exit_code);
 }
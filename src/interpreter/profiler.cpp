@@ -0,0 +1,172 @@
+#include "profiler.hpp"
+
+#include <fstream>
+
+#include "../ast.hpp"
+#include "../source_location.hpp"
+#include "garbage_collector.hpp"
+
+namespace Interpreter {
+
+// Finds the source offset of the first token in the given subtree. Most AST
+// nodes don't keep a source range, so we look for one that does.
+static int first_offset(AST::AST* ast) {
+	if (!ast)
+		return -1;
+
+	auto first_of = [](auto const& children) {
+		for (auto child : children) {
+			int offset = first_offset(child);
+			if (offset != -1)
+				return offset;
+		}
+		return -1;
+	};
+
+	switch (ast->type()) {
+	case ASTTag::Identifier: {
+		return ast->m_range.start;
+	}
+	case ASTTag::Declaration: {
+		auto decl = static_cast<AST::Declaration*>(ast);
+		if (decl->m_range.start != -1)
+			return decl->m_range.start;
+		return first_offset(decl->m_value);
+	}
+	case ASTTag::CallExpression: {
+		auto call = static_cast<AST::CallExpression*>(ast);
+		// binary operators put the callee between the arguments
+		int offset = first_of(call->m_args);
+		return offset != -1 ? offset : first_offset(call->m_callee);
+	}
+	case ASTTag::IndexExpression:
+		return first_offset(static_cast<AST::IndexExpression*>(ast)->m_callee);
+	case ASTTag::AccessExpression:
+		return first_offset(static_cast<AST::AccessExpression*>(ast)->m_target);
+	case ASTTag::TernaryExpression:
+		return first_offset(static_cast<AST::TernaryExpression*>(ast)->m_condition);
+	case ASTTag::ArrayLiteral:
+		return first_of(static_cast<AST::ArrayLiteral*>(ast)->m_elements);
+	case ASTTag::FunctionLiteral:
+		return first_offset(static_cast<AST::FunctionLiteral*>(ast)->m_body);
+	case ASTTag::SequenceExpression:
+		return first_offset(static_cast<AST::SequenceExpression*>(ast)->m_body);
+	case ASTTag::Block:
+		return first_of(static_cast<AST::Block*>(ast)->m_body);
+	case ASTTag::ReturnStatement:
+		return first_offset(static_cast<AST::ReturnStatement*>(ast)->m_value);
+	case ASTTag::IfElseStatement:
+		return first_offset(static_cast<AST::IfElseStatement*>(ast)->m_condition);
+	case ASTTag::WhileStatement:
+		return first_offset(static_cast<AST::WhileStatement*>(ast)->m_condition);
+	default:
+		return -1;
+	}
+}
+
+Profiler::Profiler(GC* gc, LineIndex const* line_index)
+    : m_gc {gc}
+    , m_line_index {line_index}
+    , m_nodes {{nullptr, -1, -1, {}}}
+    , m_last_time {Clock::now()}
+    , m_last_allocations {gc->m_allocation_count} {}
+
+void Profiler::name_function(AST::FunctionLiteral* function, AST::Declaration* declaration) {
+	m_names.insert({function, std::string(declaration->identifier_text().str())});
+
+	// a body that starts with a literal has no source range to go by, so
+	// the function is put on the line it's declared on instead
+	if (first_offset(function) == -1 && declaration->m_range.start != -1)
+		m_lines[function] = m_line_index->locate(declaration->m_range.start).line;
+}
+
+void Profiler::charge() {
+	auto now = Clock::now();
+	auto& node = m_nodes[m_current];
+	node.m_nanoseconds +=
+	    std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last_time).count();
+	node.m_allocations += m_gc->m_allocation_count - m_last_allocations;
+	m_last_time = now;
+	m_last_allocations = m_gc->m_allocation_count;
+}
+
+int Profiler::child(int parent, AST::FunctionLiteral* function, int line) {
+	for (int child : m_nodes[parent].m_children)
+		if (m_nodes[child].m_function == function && m_nodes[child].m_line == line)
+			return child;
+
+	int result = m_nodes.size();
+	m_nodes.push_back({function, line, parent, {}});
+	m_nodes[parent].m_children.push_back(result);
+	return result;
+}
+
+int Profiler::line_of(AST::AST* ast) {
+	auto it = m_lines.find(ast);
+	if (it != m_lines.end())
+		return it->second;
+	int offset = first_offset(ast);
+	int line = offset == -1 ? -1 : m_line_index->locate(offset).line;
+	m_lines[ast] = line;
+	return line;
+}
+
+void Profiler::enter(AST::FunctionLiteral* function) {
+	charge();
+	m_current = child(m_current, function, line_of(function));
+}
+
+void Profiler::exit() {
+	charge();
+	m_current = m_nodes[m_current].m_parent;
+}
+
+void Profiler::at(AST::AST* stmt) {
+	auto const& node = m_nodes[m_current];
+	if (!node.m_function)
+		return;
+
+	int line = line_of(stmt);
+	if (line == -1 || line == node.m_line)
+		return;
+
+	charge();
+	m_current = child(node.m_parent, node.m_function, line);
+}
+
+std::string Profiler::frame_name(Node const& node) {
+	auto it = m_names.find(node.m_function);
+	std::string name = it != m_names.end() ? it->second : "<lambda>";
+	if (node.m_line != -1)
+		name += ":" + std::to_string(node.m_line + 1);
+	return name;
+}
+
+bool Profiler::write(std::string const& path) {
+	charge();
+
+	std::ofstream time_out(path);
+	std::ofstream allocations_out(path + ".allocs");
+	if (!time_out.good() || !allocations_out.good())
+		return false;
+
+	// depth first, building up the stack as we go
+	std::vector<std::pair<int, std::string>> pending {{0, "<toplevel>"}};
+	while (!pending.empty()) {
+		auto [index, stack] = std::move(pending.back());
+		pending.pop_back();
+
+		auto const& node = m_nodes[index];
+		if (auto microseconds = node.m_nanoseconds / 1000)
+			time_out << stack << ' ' << microseconds << '\n';
+		if (node.m_allocations)
+			allocations_out << stack << ' ' << node.m_allocations << '\n';
+
+		for (int child : node.m_children)
+			pending.push_back({child, stack + ";" + frame_name(m_nodes[child])});
+	}
+
+	return true;
+}
+
+} // namespace Interpreter
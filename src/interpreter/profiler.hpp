@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct LineIndex;
+
+namespace AST {
+struct AST;
+struct Declaration;
+struct FunctionLiteral;
+}
+
+namespace Interpreter {
+
+struct GC;
+
+// Attributes time and allocations to the function literals being run, and
+// to the line each of them is at. Measurements are kept in a calling context
+// tree, which maps directly to the folded stacks format used by flamegraph
+// tools.
+struct Profiler {
+	using Clock = std::chrono::steady_clock;
+
+	struct Node {
+		AST::FunctionLiteral* m_function; // null for the root
+		int m_line;
+		int m_parent;
+		std::vector<int> m_children;
+		uint64_t m_nanoseconds {0};
+		uint64_t m_allocations {0};
+	};
+
+	GC* m_gc;
+	LineIndex const* m_line_index;
+	std::vector<Node> m_nodes;
+	int m_current {0};
+	Clock::time_point m_last_time;
+	uint64_t m_last_allocations {0};
+
+	std::unordered_map<AST::AST*, int> m_lines {};
+	std::unordered_map<AST::FunctionLiteral*, std::string> m_names {};
+
+	Profiler(GC* gc, LineIndex const* line_index);
+
+	// names the function after the declaration it's bound to
+	void name_function(AST::FunctionLiteral*, AST::Declaration*);
+
+	void enter(AST::FunctionLiteral*);
+	void exit();
+	// called before running each statement
+	void at(AST::AST* stmt);
+
+	// Writes self time in microseconds to `path`, and allocation counts to
+	// `path` + ".allocs"
+	bool write(std::string const& path);
+
+private:
+	void charge();
+	int child(int parent, AST::FunctionLiteral*, int line);
+	int line_of(AST::AST*);
+	std::string frame_name(Node const&);
+};
+
+} // namespace Interpreter
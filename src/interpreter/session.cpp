@@ -0,0 +1,223 @@
+#include "session.hpp"
+
+#include <cassert>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../ast.hpp"
+#include "../compute_offsets.hpp"
+#include "../cst.hpp"
+#include "../cst_allocator.hpp"
+#include "../ct_eval.hpp"
+#include "../lexer.hpp"
+#include "../match_identifiers.hpp"
+#include "../metacheck.hpp"
+#include "../parser.hpp"
+#include "../source_file.hpp"
+#include "../source_location.hpp"
+#include "../symbol_table.hpp"
+#include "../token_array.hpp"
+#include "../typecheck.hpp"
+#include "eval.hpp"
+#include "garbage_collector.hpp"
+#include "interpreter.hpp"
+#include "native.hpp"
+#include "tiering.hpp"
+
+namespace Interpreter {
+
+Session::Session(ExecuteSettings settings)
+    : m_settings {std::move(settings)}
+    , m_ast_allocator {std::make_unique<AST::Allocator>()}
+    , m_tc {std::make_unique<TypeChecker::TypeChecker>(*m_ast_allocator)} {}
+
+// Whether a declaration that didn't change has to be checked again, given
+// the declarations that are being replaced
+static bool needs_check(
+    AST::Declaration* decl,
+    std::unordered_set<AST::Declaration*> const& replaced,
+    TypeChecker::TypeChecker& tc,
+    bool typecheck) {
+
+	for (auto other : decl->m_references)
+		if (replaced.count(other))
+			return true;
+
+	// values that weren't generalized can keep free variables in their
+	// type, which checking the declarations that use them binds. Checking
+	// them again undoes what the old versions of those did. Values of a
+	// ground type are safe to keep
+	if (typecheck && tc.m_open_values.count(decl))
+		return true;
+
+	return false;
+}
+
+ExitStatus Session::check(SourceFile const& source) {
+	TokenArray const ta = tokenize(source.data());
+	std::vector<int> const starts = find_top_level_boundaries(ta);
+	int const unit_count = int(starts.size()) - 1;
+
+	std::vector<Unit> units(unit_count);
+	for (int i = 0; i < unit_count; ++i) {
+		int const begin = ta.m_ranges[starts[i]].start;
+		int const end = ta.m_ranges[starts[i + 1] - 1].end;
+		units[i].m_text.assign(source.data() + begin, end - begin);
+	}
+
+	// once there is more garbage than live declarations, everything is
+	// checked again in a fresh allocator and typechecker. They replace the
+	// current ones if the check passes
+	bool const compact =
+	    m_dead_count >= compaction_minimum && m_dead_count > int(m_units.size());
+	Own<AST::Allocator> fresh_allocator;
+	Own<TypeChecker::TypeChecker> fresh_tc;
+	if (compact) {
+		fresh_allocator = std::make_unique<AST::Allocator>();
+		fresh_tc = std::make_unique<TypeChecker::TypeChecker>(*fresh_allocator);
+	}
+	AST::Allocator& allocator = compact ? *fresh_allocator : *m_ast_allocator;
+	TypeChecker::TypeChecker& tc = compact ? *fresh_tc : *m_tc;
+
+	// reuse the declarations whose text is the same as before. Repeated
+	// texts are matched up in order
+	std::unordered_map<std::string_view, std::vector<AST::Declaration*>> old_declarations;
+	if (!compact)
+		for (int i = int(m_units.size()); i--;)
+			old_declarations[m_units[i].m_text].push_back(m_units[i].m_declaration);
+
+	for (auto& unit : units) {
+		auto it = old_declarations.find(unit.m_text);
+		if (it == old_declarations.end() || it->second.empty())
+			continue;
+		unit.m_declaration = it->second.back();
+		it->second.pop_back();
+	}
+
+	std::unordered_set<AST::Declaration*> replaced;
+	for (auto& kv : old_declarations)
+		replaced.insert(kv.second.begin(), kv.second.end());
+
+	// the declarations that refer to replaced ones are replaced too
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (auto& unit : units) {
+			if (unit.m_declaration &&
+			    needs_check(unit.m_declaration, replaced, tc, m_settings.typecheck)) {
+				replaced.insert(unit.m_declaration);
+				unit.m_declaration = nullptr;
+				changed = true;
+			}
+		}
+	}
+
+	std::vector<TokenRun> runs;
+	for (int i = 0; i < unit_count; ++i)
+		if (!units[i].m_declaration)
+			runs.push_back({starts[i], starts[i + 1]});
+
+	AST::Program* ast;
+	{
+		CST::Allocator cst_allocator;
+		auto parse_result = parse_declarations(ta, cst_allocator, runs);
+		if (not parse_result.ok()) {
+			// the split into declarations is only exact for programs that
+			// parse, so the errors of a full parse are the right ones
+			CST::Allocator full_allocator;
+			auto full_result = parse_program(ta, full_allocator);
+			auto const& error = full_result.ok() ? parse_result.error() : full_result.error();
+			error.print(LineIndex {source.data()});
+			return ExitStatus::ParseError;
+		}
+
+		if (m_settings.dump_cst)
+			print(parse_result.m_result, 1);
+
+		ast = static_cast<AST::Program*>(AST::convert_ast(parse_result.m_result, allocator));
+	}
+
+	Frontend::SymbolTable context;
+	tc.m_builtin_declarations.for_each([&](AST::Declaration& decl) {
+		context.declare(&decl);
+	});
+	for (auto& unit : units)
+		if (unit.m_declaration)
+			context.declare(unit.m_declaration);
+
+	{
+		auto err = Frontend::match_identifiers(ast, context, allocator);
+		if (!err.ok()) {
+			if (!compact)
+				m_dead_count += ast->m_declarations.size();
+			err.print(LineIndex {source.data()});
+			return ExitStatus::StaticError;
+		}
+	}
+
+	// only the new declarations go through the passes. The ones they refer
+	// to are already checked, like builtins are
+	tc.m_env.compute_declaration_order(ast);
+
+	if (m_settings.typecheck) {
+		tc.m_core.m_meta_core.comp = &tc.m_env.declaration_components;
+		TypeChecker::metacheck(tc.m_core.m_meta_core, ast);
+		TypeChecker::reify_types(ast, tc, allocator);
+		TypeChecker::typecheck(ast, tc);
+	}
+
+	TypeChecker::compute_offsets(ast, 0);
+
+	int next = 0;
+	for (auto& unit : units)
+		if (!unit.m_declaration)
+			unit.m_declaration = &ast->m_declarations[next++];
+
+	m_checked_count = next;
+	m_units = std::move(units);
+
+	if (compact) {
+		m_tc = std::move(fresh_tc);
+		m_ast_allocator = std::move(fresh_allocator);
+		m_dead_count = 0;
+		m_compaction_count += 1;
+	} else {
+		m_dead_count += replaced.size();
+	}
+
+	std::vector<AST::Declaration*> declarations;
+	for (auto& unit : m_units)
+		declarations.push_back(unit.m_declaration);
+	m_declaration_order =
+	    Frontend::CompileTimeEnvironment::declaration_order(declarations);
+	m_program = ast;
+	m_context = std::move(context);
+
+	return ExitStatus::Ok;
+}
+
+ExitStatus Session::run(Runner* runner) {
+	assert(m_program);
+
+	GC gc;
+	Interpreter env = {m_tc.get(), &gc, &m_declaration_order};
+	Tiering tiering {m_settings.tier_up_threshold};
+	if (m_settings.tiering)
+		env.m_tiering = &tiering;
+	declare_native_functions(env);
+	// evaluates every declaration, following the order it's given, and not
+	// just the ones in the program
+	eval(m_program, env);
+
+	return runner(env, m_context);
+}
+
+ExitStatus Session::execute(SourceFile const& source, Runner* runner) {
+	auto status = check(source);
+	if (status != ExitStatus::Ok)
+		return status;
+
+	return run(runner);
+}
+
+} // namespace Interpreter
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../ast_allocator.hpp"
+#include "../symbol_table.hpp"
+#include "../typechecker.hpp"
+#include "../utils/typedefs.hpp"
+#include "execute.hpp"
+
+struct SourceFile;
+
+namespace Interpreter {
+
+// Executes successive versions of a program, as an editor would after each
+// change, redoing as little of the frontend as it can.
+//
+// The top-level declarations of each version are matched with those of the
+// previous one by their text. Only the ones that changed, and the ones that
+// depend on those, are parsed and checked again; the rest keep their AST and
+// types from the run that checked them. Everything is still evaluated on
+// each run.
+//
+// Source ranges of reused declarations point into the version they were
+// parsed from, so profiling is not supported.
+//
+// Replaced declarations, and the types they were given, can't be freed one
+// by one. They are counted instead, and once they outnumber the live
+// declarations (and there are at least `compaction_minimum` of them), the
+// next check starts over with a fresh allocator and typechecker and checks
+// every declaration again. So a session takes at most around twice the
+// memory of checking its current version from scratch.
+struct Session {
+	static constexpr int compaction_minimum = 64;
+
+	// the settings can't change between runs, as checked declarations are
+	// kept around
+	explicit Session(ExecuteSettings settings);
+
+	// runs the frontend on a new version of the program. If it fails, the
+	// last version that passed is kept
+	ExitStatus check(SourceFile const& source);
+	// evaluates the last version that passed the frontend
+	ExitStatus run(Runner* runner);
+	ExitStatus execute(SourceFile const& source, Runner* runner);
+
+	struct Unit {
+		// from the first token of the declaration to the last one
+		std::string m_text {};
+		AST::Declaration* m_declaration {nullptr};
+	};
+
+	ExecuteSettings m_settings;
+	// replaced together when the session is compacted
+	Own<AST::Allocator> m_ast_allocator;
+	// keeps the types of every checked declaration
+	Own<TypeChecker::TypeChecker> m_tc;
+	// declarations in m_ast_allocator that are no longer used
+	int m_dead_count {0};
+
+	// top-level declarations of the last program that was run, in order
+	std::vector<Unit> m_units {};
+	std::vector<std::vector<AST::Declaration*>> m_declaration_order {};
+	// the declarations that were checked by the last run, and what every
+	// name in the program refers to
+	AST::Program* m_program {nullptr};
+	Frontend::SymbolTable m_context {};
+	// how many declarations the last run had to check, and how many times
+	// the session was compacted, for tests
+	int m_checked_count {0};
+	int m_compaction_count {0};
+};
+
+} // namespace Interpreter
@@ -0,0 +1,609 @@
+#include "tiering.hpp"
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Transforms/Utils.h>
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../ast.hpp"
+#include "../log/log.hpp"
+#include "../typechecker.hpp"
+#include "interpreter.hpp"
+#include "utils.hpp"
+#include "value.hpp"
+
+namespace Interpreter {
+
+namespace {
+
+enum class Scalar { Int, Float, Bool, None };
+
+// Translates a subset of the typed AST to LLVM IR. Every gen_* function
+// returns null (or false) when it runs into something it doesn't support,
+// in which case the whole module is thrown away.
+struct Codegen {
+	TypeChecker::TypeChecker& m_tc;
+	llvm::LLVMContext& m_context;
+	llvm::Module& m_module;
+	std::string m_prefix;
+	llvm::IRBuilder<> m_builder;
+
+	std::unordered_map<AST::FunctionLiteral*, llvm::Function*> m_functions;
+	std::vector<AST::FunctionLiteral*> m_pending;
+
+	// state of the function being generated
+	llvm::Function* m_function {nullptr};
+	std::unordered_map<AST::Declaration*, llvm::AllocaInst*> m_locals;
+
+	Codegen(TypeChecker::TypeChecker& tc, llvm::LLVMContext& context, llvm::Module& module, std::string prefix)
+	    : m_tc {tc}
+	    , m_context {context}
+	    , m_module {module}
+	    , m_prefix {std::move(prefix)}
+	    , m_builder {context}
+	    , m_functions {}
+	    , m_pending {}
+	    , m_locals {} {}
+
+	Scalar scalar_of(MonoId mono) {
+		auto& core = m_tc.m_core;
+		mono = core.m_mono_core.find(mono);
+		if (core.m_mono_core.is_var(mono))
+			return Scalar::None;
+
+		auto tf_of = [&](MonoId m) {
+			return core.m_tf_core.find_function(core.m_mono_core.find_function(m));
+		};
+
+		int tf = tf_of(mono);
+		if (tf == tf_of(m_tc.mono_int()))
+			return Scalar::Int;
+		if (tf == tf_of(m_tc.mono_float()))
+			return Scalar::Float;
+		if (tf == tf_of(m_tc.mono_boolean()))
+			return Scalar::Bool;
+		return Scalar::None;
+	}
+
+	llvm::Type* llvm_type(Scalar scalar) {
+		switch (scalar) {
+		case Scalar::Int: return llvm::Type::getInt32Ty(m_context);
+		case Scalar::Float: return llvm::Type::getFloatTy(m_context);
+		case Scalar::Bool: return llvm::Type::getInt1Ty(m_context);
+		case Scalar::None: return nullptr;
+		}
+		return nullptr;
+	}
+
+	llvm::Type* llvm_type(MonoId mono) {
+		return llvm_type(scalar_of(mono));
+	}
+
+	// Declares the function for the given literal, and queues its body
+	llvm::Function* get_function(AST::FunctionLiteral* ast) {
+		auto it = m_functions.find(ast);
+		if (it != m_functions.end())
+			return it->second;
+
+		if (!ast->m_captures.empty())
+			return nullptr;
+
+		auto return_type = llvm_type(ast->m_return_type);
+		if (!return_type)
+			return nullptr;
+
+		std::vector<llvm::Type*> arg_types;
+		for (auto& arg : ast->m_args) {
+			auto type = llvm_type(arg.m_value_type);
+			if (!type)
+				return nullptr;
+			arg_types.push_back(type);
+		}
+
+		auto type = llvm::FunctionType::get(return_type, arg_types, false);
+		auto name = m_prefix + "." + std::to_string(m_functions.size());
+		auto function = llvm::Function::Create(
+		    type, llvm::Function::InternalLinkage, name, m_module);
+
+		m_functions[ast] = function;
+		m_pending.push_back(ast);
+		return function;
+	}
+
+	llvm::AllocaInst* new_local(AST::Declaration* decl, llvm::Type* type) {
+		llvm::IRBuilder<> entry_builder(
+		    &m_function->getEntryBlock(), m_function->getEntryBlock().begin());
+		auto slot = entry_builder.CreateAlloca(type, nullptr, decl->identifier_text().str());
+		m_locals[decl] = slot;
+		return slot;
+	}
+
+	// Code after a return is unreachable, but we still have to put it
+	// somewhere
+	void continue_after_terminator() {
+		if (m_builder.GetInsertBlock()->getTerminator())
+			m_builder.SetInsertPoint(
+			    llvm::BasicBlock::Create(m_context, "dead", m_function));
+	}
+
+	llvm::Value* gen_operator(std::string_view op, AST::CallExpression* ast) {
+		if (ast->m_args.size() != 2)
+			return nullptr;
+
+		auto operand_type = scalar_of(ast->m_args[0]->m_value_type);
+		if (operand_type == Scalar::None)
+			return nullptr;
+
+		auto lhs = gen_expr(ast->m_args[0]);
+		if (!lhs)
+			return nullptr;
+		auto rhs = gen_expr(ast->m_args[1]);
+		if (!rhs)
+			return nullptr;
+
+		auto& b = m_builder;
+		if (operand_type == Scalar::Int) {
+			if (op == "+") return b.CreateAdd(lhs, rhs);
+			if (op == "-") return b.CreateSub(lhs, rhs);
+			if (op == "*") return b.CreateMul(lhs, rhs);
+			if (op == "/") return b.CreateSDiv(lhs, rhs);
+			if (op == "<") return b.CreateICmpSLT(lhs, rhs);
+			if (op == "<=") return b.CreateICmpSLE(lhs, rhs);
+			if (op == ">") return b.CreateICmpSGT(lhs, rhs);
+			if (op == ">=") return b.CreateICmpSGE(lhs, rhs);
+			if (op == "==") return b.CreateICmpEQ(lhs, rhs);
+			if (op == "!=") return b.CreateICmpNE(lhs, rhs);
+		} else if (operand_type == Scalar::Float) {
+			if (op == "+") return b.CreateFAdd(lhs, rhs);
+			if (op == "-") return b.CreateFSub(lhs, rhs);
+			if (op == "*") return b.CreateFMul(lhs, rhs);
+			if (op == "/") return b.CreateFDiv(lhs, rhs);
+			if (op == "<") return b.CreateFCmpOLT(lhs, rhs);
+			if (op == "<=") return b.CreateFCmpOLE(lhs, rhs);
+			if (op == ">") return b.CreateFCmpOGT(lhs, rhs);
+			if (op == ">=") return b.CreateFCmpOGE(lhs, rhs);
+			if (op == "==") return b.CreateFCmpOEQ(lhs, rhs);
+			if (op == "!=") return b.CreateFCmpUNE(lhs, rhs);
+		} else {
+			// NOTE: the interpreter evaluates both sides of && and ||
+			if (op == "&&") return b.CreateAnd(lhs, rhs);
+			if (op == "||") return b.CreateOr(lhs, rhs);
+			if (op == "^^" || op == "!=") return b.CreateXor(lhs, rhs);
+			if (op == "==") return b.CreateICmpEQ(lhs, rhs);
+		}
+
+		return nullptr;
+	}
+
+	llvm::Value* gen_call(AST::CallExpression* ast) {
+		if (ast->m_callee->type() != ASTTag::Identifier)
+			return nullptr;
+
+		auto callee = static_cast<AST::Identifier*>(ast->m_callee);
+		if (callee->m_origin != AST::Identifier::Origin::Global)
+			return nullptr;
+
+		auto decl = callee->m_declaration;
+		// builtins don't have a value, only a type
+		if (!decl || !decl->m_value)
+			return gen_operator(callee->text().str(), ast);
+
+		if (decl->m_value->type() != ASTTag::FunctionLiteral)
+			return nullptr;
+
+		// a polymorphic function would need a copy per instantiation
+		if (decl->m_is_polymorphic && !m_tc.m_core.poly_data[decl->m_decl_type].vars.empty())
+			return nullptr;
+
+		auto function = get_function(static_cast<AST::FunctionLiteral*>(decl->m_value));
+		if (!function)
+			return nullptr;
+
+		std::vector<llvm::Value*> args;
+		for (auto arg : ast->m_args) {
+			auto value = gen_expr(arg);
+			if (!value)
+				return nullptr;
+			args.push_back(value);
+		}
+
+		return m_builder.CreateCall(function, args);
+	}
+
+	llvm::Value* gen_ternary(AST::TernaryExpression* ast) {
+		auto type = llvm_type(ast->m_value_type);
+		auto condition = gen_expr(ast->m_condition);
+		if (!type || !condition)
+			return nullptr;
+
+		auto then_block = llvm::BasicBlock::Create(m_context, "then", m_function);
+		auto else_block = llvm::BasicBlock::Create(m_context, "else", m_function);
+		auto join_block = llvm::BasicBlock::Create(m_context, "join", m_function);
+		m_builder.CreateCondBr(condition, then_block, else_block);
+
+		m_builder.SetInsertPoint(then_block);
+		auto then_value = gen_expr(ast->m_then_expr);
+		if (!then_value)
+			return nullptr;
+		then_block = m_builder.GetInsertBlock();
+		m_builder.CreateBr(join_block);
+
+		m_builder.SetInsertPoint(else_block);
+		auto else_value = gen_expr(ast->m_else_expr);
+		if (!else_value)
+			return nullptr;
+		else_block = m_builder.GetInsertBlock();
+		m_builder.CreateBr(join_block);
+
+		m_builder.SetInsertPoint(join_block);
+		auto phi = m_builder.CreatePHI(type, 2);
+		phi->addIncoming(then_value, then_block);
+		phi->addIncoming(else_value, else_block);
+		return phi;
+	}
+
+	llvm::Value* gen_expr(AST::Expr* ast) {
+		switch (ast->type()) {
+		case ASTTag::IntegerLiteral:
+			return m_builder.getInt32(static_cast<AST::IntegerLiteral*>(ast)->value());
+		case ASTTag::NumberLiteral:
+			return llvm::ConstantFP::get(
+			    llvm::Type::getFloatTy(m_context),
+			    static_cast<AST::NumberLiteral*>(ast)->value());
+		case ASTTag::BooleanLiteral:
+			return m_builder.getInt1(static_cast<AST::BooleanLiteral*>(ast)->m_value);
+		case ASTTag::Identifier: {
+			auto identifier = static_cast<AST::Identifier*>(ast);
+			if (identifier->m_origin != AST::Identifier::Origin::Local)
+				return nullptr;
+			auto it = m_locals.find(identifier->m_declaration);
+			if (it == m_locals.end())
+				return nullptr;
+			return m_builder.CreateLoad(it->second->getAllocatedType(), it->second);
+		}
+		case ASTTag::CallExpression:
+			return gen_call(static_cast<AST::CallExpression*>(ast));
+		case ASTTag::TernaryExpression:
+			return gen_ternary(static_cast<AST::TernaryExpression*>(ast));
+		default:
+			return nullptr;
+		}
+	}
+
+	bool gen_assignment(AST::CallExpression* ast) {
+		auto target = ast->m_args[0];
+		if (target->type() != ASTTag::Identifier)
+			return false;
+
+		auto identifier = static_cast<AST::Identifier*>(target);
+		if (identifier->m_origin != AST::Identifier::Origin::Local)
+			return false;
+
+		auto it = m_locals.find(identifier->m_declaration);
+		if (it == m_locals.end())
+			return false;
+
+		auto value = gen_expr(ast->m_args[1]);
+		if (!value)
+			return false;
+
+		m_builder.CreateStore(value, it->second);
+		return true;
+	}
+
+	bool gen_stmt(AST::AST* ast) {
+		switch (ast->type()) {
+		case ASTTag::Block: {
+			for (auto child : static_cast<AST::Block*>(ast)->m_body)
+				if (!gen_stmt(child))
+					return false;
+			return true;
+		}
+		case ASTTag::Declaration: {
+			auto decl = static_cast<AST::Declaration*>(ast);
+			auto type = llvm_type(decl->m_value_type);
+			if (!type || !decl->m_value)
+				return false;
+			auto value = gen_expr(decl->m_value);
+			if (!value)
+				return false;
+			m_builder.CreateStore(value, new_local(decl, type));
+			return true;
+		}
+		case ASTTag::ReturnStatement: {
+			auto value = gen_expr(static_cast<AST::ReturnStatement*>(ast)->m_value);
+			if (!value)
+				return false;
+			m_builder.CreateRet(value);
+			continue_after_terminator();
+			return true;
+		}
+		case ASTTag::IfElseStatement: {
+			auto stmt = static_cast<AST::IfElseStatement*>(ast);
+			auto condition = gen_expr(stmt->m_condition);
+			if (!condition)
+				return false;
+
+			auto then_block = llvm::BasicBlock::Create(m_context, "then", m_function);
+			auto else_block = llvm::BasicBlock::Create(m_context, "else", m_function);
+			auto join_block = llvm::BasicBlock::Create(m_context, "join", m_function);
+			m_builder.CreateCondBr(condition, then_block, else_block);
+
+			m_builder.SetInsertPoint(then_block);
+			if (!gen_stmt(stmt->m_body))
+				return false;
+			m_builder.CreateBr(join_block);
+
+			m_builder.SetInsertPoint(else_block);
+			if (stmt->m_else_body && !gen_stmt(stmt->m_else_body))
+				return false;
+			m_builder.CreateBr(join_block);
+
+			m_builder.SetInsertPoint(join_block);
+			return true;
+		}
+		case ASTTag::WhileStatement: {
+			auto stmt = static_cast<AST::WhileStatement*>(ast);
+			auto cond_block = llvm::BasicBlock::Create(m_context, "loop.cond", m_function);
+			auto body_block = llvm::BasicBlock::Create(m_context, "loop.body", m_function);
+			auto exit_block = llvm::BasicBlock::Create(m_context, "loop.exit", m_function);
+			m_builder.CreateBr(cond_block);
+
+			m_builder.SetInsertPoint(cond_block);
+			auto condition = gen_expr(stmt->m_condition);
+			if (!condition)
+				return false;
+			m_builder.CreateCondBr(condition, body_block, exit_block);
+
+			m_builder.SetInsertPoint(body_block);
+			if (!gen_stmt(stmt->m_body))
+				return false;
+			m_builder.CreateBr(cond_block);
+
+			m_builder.SetInsertPoint(exit_block);
+			return true;
+		}
+		case ASTTag::CallExpression: {
+			auto call = static_cast<AST::CallExpression*>(ast);
+			if (call->m_callee->type() == ASTTag::Identifier &&
+			    static_cast<AST::Identifier*>(call->m_callee)->text().str() == "=" &&
+			    call->m_args.size() == 2)
+				return gen_assignment(call);
+			return gen_expr(call) != nullptr;
+		}
+		default:
+			return is_expression(ast) && gen_expr(static_cast<AST::Expr*>(ast));
+		}
+	}
+
+	bool gen_body(AST::FunctionLiteral* ast) {
+		m_function = m_functions[ast];
+		m_locals.clear();
+
+		auto entry = llvm::BasicBlock::Create(m_context, "entry", m_function);
+		m_builder.SetInsertPoint(entry);
+
+		int i = 0;
+		for (auto& arg : m_function->args()) {
+			auto decl = &ast->m_args[i++];
+			arg.setName(decl->identifier_text().str());
+			m_builder.CreateStore(&arg, new_local(decl, arg.getType()));
+		}
+
+		if (ast->m_body->type() == ASTTag::SequenceExpression) {
+			if (!gen_stmt(static_cast<AST::SequenceExpression*>(ast->m_body)->m_body))
+				return false;
+			// falling off the end returns null in the interpreter, which
+			// can't happen in a well typed function that returns a scalar
+			if (!m_builder.GetInsertBlock()->getTerminator())
+				m_builder.CreateUnreachable();
+		} else {
+			auto value = gen_expr(ast->m_body);
+			if (!value)
+				return false;
+			m_builder.CreateRet(value);
+		}
+
+		return !llvm::verifyFunction(*m_function, &llvm::errs());
+	}
+
+	bool gen_all() {
+		while (!m_pending.empty()) {
+			auto ast = m_pending.back();
+			m_pending.pop_back();
+			if (!gen_body(ast))
+				return false;
+		}
+		return true;
+	}
+
+	// Generates a function with the JitEntry signature that unpacks the
+	// arguments, calls the given function and packs its result
+	llvm::Function* gen_entry(AST::FunctionLiteral* ast, llvm::Function* target) {
+		auto i64 = llvm::Type::getInt64Ty(m_context);
+		auto type = llvm::FunctionType::get(i64, {i64->getPointerTo()}, false);
+		auto entry = llvm::Function::Create(
+		    type, llvm::Function::ExternalLinkage, m_prefix + ".entry", m_module);
+
+		m_builder.SetInsertPoint(llvm::BasicBlock::Create(m_context, "entry", entry));
+
+		std::vector<llvm::Value*> args;
+		for (int i = 0; i != ast->m_args.size(); ++i) {
+			auto slot = m_builder.CreateConstGEP1_64(i64, entry->getArg(0), i);
+			auto packed = m_builder.CreateLoad(i64, slot);
+			auto type_of_arg = target->getFunctionType()->getParamType(i);
+			if (type_of_arg->isFloatTy())
+				args.push_back(m_builder.CreateBitCast(
+				    m_builder.CreateTrunc(packed, m_builder.getInt32Ty()), type_of_arg));
+			else
+				args.push_back(m_builder.CreateTrunc(packed, type_of_arg));
+		}
+
+		llvm::Value* result = m_builder.CreateCall(target, args);
+		if (result->getType()->isFloatTy())
+			result = m_builder.CreateZExt(
+			    m_builder.CreateBitCast(result, m_builder.getInt32Ty()), i64);
+		else if (result->getType()->isIntegerTy(1))
+			result = m_builder.CreateZExt(result, i64);
+		else
+			result = m_builder.CreateSExt(result, i64);
+		m_builder.CreateRet(result);
+
+		return entry;
+	}
+};
+
+ValueTag value_tag_of(llvm::Type* type) {
+	if (type->isFloatTy())
+		return ValueTag::Float;
+	if (type->isIntegerTy(1))
+		return ValueTag::Boolean;
+	return ValueTag::Integer;
+}
+
+int64_t pack(Value value) {
+	switch (value.type()) {
+	case ValueTag::Integer:
+		return value.get_integer();
+	case ValueTag::Float: {
+		float f = value.get_float();
+		uint32_t bits;
+		std::memcpy(&bits, &f, sizeof(bits));
+		return bits;
+	}
+	case ValueTag::Boolean:
+		return value.get_boolean();
+	default:
+		Log::fatal() << "(internal) can't pass a " << value_string[int(value.type())]
+		             << " to a compiled function";
+	}
+}
+
+Value unpack(int64_t packed, ValueTag tag) {
+	switch (tag) {
+	case ValueTag::Integer:
+		return Value {int(packed)};
+	case ValueTag::Float: {
+		uint32_t bits = uint32_t(packed);
+		float f;
+		std::memcpy(&f, &bits, sizeof(f));
+		return Value {f};
+	}
+	case ValueTag::Boolean:
+		return Value {packed != 0};
+	default:
+		Log::fatal() << "(internal) bad return type for a compiled function";
+	}
+}
+
+} // namespace
+
+Tiering::Tiering(int threshold)
+    : m_threshold {threshold}
+    , m_states {}
+    , m_jit {} {}
+
+Tiering::~Tiering() = default;
+
+void Tiering::count_back_edge() {
+	if (m_current)
+		m_states[m_current].m_hotness += 1;
+}
+
+bool Tiering::try_call_native(Function* callee, Interpreter& e) {
+	TierState& state = callee->m_native ? *callee->m_native : m_states[callee->m_def];
+
+	if (state.m_tier == Tier::Interpreted) {
+		state.m_hotness += 1;
+		if (state.m_hotness < m_threshold)
+			return false;
+		state.m_tier = compile(callee->m_def, state, e) ? Tier::Compiled : Tier::Unsupported;
+	}
+
+	if (state.m_tier != Tier::Compiled)
+		return false;
+
+	callee->m_native = &state;
+
+	std::vector<int64_t> args;
+	for (int i = 0; i != callee->m_def->m_args.size(); ++i)
+		args.push_back(pack(value_of(e.m_stack.frame_at(i))));
+
+	e.m_stack.push(unpack(state.m_entry(args.data()), state.m_return_tag));
+	return true;
+}
+
+int Tiering::compiled_count() const {
+	int result = 0;
+	for (auto& [def, state] : m_states)
+		if (state.m_tier == Tier::Compiled)
+			result += 1;
+	return result;
+}
+
+bool Tiering::compile(AST::FunctionLiteral* ast, TierState& state, Interpreter& e) {
+	if (!m_jit) {
+		llvm::InitializeNativeTarget();
+		llvm::InitializeNativeTargetAsmPrinter();
+
+		auto jit = llvm::orc::LLJITBuilder().create();
+		if (!jit) {
+			llvm::consumeError(jit.takeError());
+			return false;
+		}
+		m_jit = std::move(*jit);
+	}
+
+	auto context = std::make_unique<llvm::LLVMContext>();
+	auto module = std::make_unique<llvm::Module>("jasper.jit", *context);
+	module->setDataLayout(m_jit->getDataLayout());
+
+	Codegen codegen {*e.m_tc, *context, *module, "jit" + std::to_string(m_module_count++)};
+	auto function = codegen.get_function(ast);
+	if (!function || !codegen.gen_all())
+		return false;
+	auto entry = codegen.gen_entry(ast, function);
+	auto return_tag = value_tag_of(function->getReturnType());
+
+	llvm::legacy::FunctionPassManager passes(module.get());
+	passes.add(llvm::createPromoteMemoryToRegisterPass());
+	passes.add(llvm::createInstructionCombiningPass());
+	passes.add(llvm::createGVNPass());
+	passes.add(llvm::createCFGSimplificationPass());
+	passes.doInitialization();
+	for (auto& f : *module)
+		passes.run(f);
+	passes.doFinalization();
+
+	auto entry_name = entry->getName().str();
+	auto error = m_jit->addIRModule(
+	    llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+	if (error) {
+		llvm::consumeError(std::move(error));
+		return false;
+	}
+
+	auto symbol = m_jit->lookup(entry_name);
+	if (!symbol) {
+		llvm::consumeError(symbol.takeError());
+		return false;
+	}
+
+	state.m_entry = reinterpret_cast<JitEntry*>(symbol->getAddress());
+	state.m_return_tag = return_tag;
+	return true;
+}
+
+} // namespace Interpreter
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "value_tag.hpp"
+
+namespace AST {
+struct FunctionLiteral;
+}
+
+namespace llvm::orc {
+class LLJIT;
+}
+
+namespace Interpreter {
+
+struct Interpreter;
+struct Function;
+
+// Entry point of a function compiled by the JIT. Arguments and the return
+// value are scalars, each packed into 64 bits.
+using JitEntry = auto(int64_t const*) -> int64_t;
+
+enum class Tier { Interpreted, Compiled, Unsupported };
+
+struct TierState {
+	Tier m_tier {Tier::Interpreted};
+	// invocations plus loop back-edges taken so far
+	int m_hotness {0};
+	JitEntry* m_entry {nullptr};
+	ValueTag m_return_tag {ValueTag::Null};
+};
+
+// Counts how often each function literal runs, and compiles the ones that
+// get hot to native code with LLVM. Functions the JIT can't handle (anything
+// other than ints, floats and booleans, captures, natives other than the
+// arithmetic ones...) are marked as unsupported and keep being interpreted.
+struct Tiering {
+	int m_threshold;
+	std::unordered_map<AST::FunctionLiteral*, TierState> m_states;
+	// function being interpreted, back-edges are attributed to it
+	AST::FunctionLiteral* m_current {nullptr};
+	std::unique_ptr<llvm::orc::LLJIT> m_jit;
+	int m_module_count {0};
+
+	explicit Tiering(int threshold);
+	~Tiering();
+
+	void count_back_edge();
+
+	// If the callee is hot, runs its native version with the arguments in
+	// the current stack frame and pushes the result. Returns false if the
+	// callee has to be interpreted instead.
+	bool try_call_native(Function* callee, Interpreter&);
+
+	// number of function literals that made it to native code
+	int compiled_count() const;
+
+private:
+	bool compile(AST::FunctionLiteral*, TierState&, Interpreter&);
+};
+
+} // namespace Interpreter
@@ -17,6 +17,7 @@ namespace Interpreter {
 
 struct Interpreter;
 struct Reference;
+struct TierState;
 struct Value;
 
 using Identifier = InternedString;
@@ -153,6 +154,8 @@ struct Variant : GcCell {
 struct Function : GcCell {
 	FunctionType m_def;
 	CapturesType m_captures;
+	// set once the function has been compiled by the JIT
+	TierState* m_native {nullptr};
 
 	Function(FunctionType, CapturesType);
 };
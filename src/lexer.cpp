@@ -1,7 +1,10 @@
+#include "lexer.hpp"
+
 #include "automaton.hpp"
 
 #include "token.hpp"
 #include "token_array.hpp"
+#include "utils/char_scan.hpp"
 #include "utils/string_view.hpp"
 
 #include <cstdint>
@@ -84,20 +87,19 @@ enum Values { Error, END_STATES Count };
 constexpr char const* end_states[] = { "Error", END_STATES };
 #undef X
 
-constexpr int last_fixed_string = RPoly;
-
 } // namespace EndStates
 
-#define X(name, token_tag, string) string,
-static InternedString fixed_strings[] = { END_STATES };
-#undef X
-
 #define X(name, token_tag, string) TokenTag::token_tag,
 constexpr TokenTag token_tags[] = { END_STATES };
 #undef X
 
 #undef END_STATES
 
+// intermediate states, in the order init_transitions creates them
+constexpr State start = state_count - 1;
+constexpr State saw_open_string = state_count - 2;
+constexpr State saw_comment_marker = state_count - 3;
+
 constexpr void init_transitions(AutomatonBuilder& builder) {
 	// TODO: CLRF, more error handling
 
@@ -106,9 +108,9 @@ constexpr void init_transitions(AutomatonBuilder& builder) {
 	for (int i = state_count; i--;)
 		builder.default_transition(i, Error);
 
-	State start = builder.new_state();
-	State saw_open_string = builder.new_state();
-	State saw_comment_marker = builder.new_state();
+	builder.new_state(); // start
+	builder.new_state(); // saw_open_string
+	builder.new_state(); // saw_comment_marker
 	State saw_number_dot = builder.new_state();
 
 	builder
@@ -155,6 +157,7 @@ constexpr void init_transitions(AutomatonBuilder& builder) {
 	.from_state(saw_open_string)
 		.default_transition(saw_open_string)
 		.transition('"', String)
+		.transition('\0', Error)
 
 	// numeric literals
 	.from_state(Integer)
@@ -172,7 +175,7 @@ constexpr void init_transitions(AutomatonBuilder& builder) {
 	.from_state(saw_comment_marker)
 		.default_transition(saw_comment_marker)
 		.transition('\n', Comment)
-		.transition('\0', Comment)
+		.transition('\0', Error)
 
 	// equal sign (=) tokens
 	.from_state(Assign)
@@ -235,6 +238,25 @@ constexpr Automaton make() {
 	return builder.automaton;
 }
 
+// Skips the run of characters that would keep the automaton in the given
+// state, using vector instructions where available. The states handled here
+// are exactly the ones that loop on a character class.
+static char const* fast_forward(State state, char const* p) {
+	switch (state) {
+	case EndStates::Identifier:
+		return CharScan::skip_identifier(p);
+	case EndStates::Integer:
+	case EndStates::Number:
+		return CharScan::skip_digits(p);
+	case saw_comment_marker:
+		return CharScan::find_line_end(p);
+	case saw_open_string:
+		return CharScan::find_quote(p);
+	default:
+		return p;
+	}
+}
+
 } // namespace MainLexer
 
 namespace KeywordLexer {
@@ -273,10 +295,6 @@ constexpr char const* end_states[] = { "Error", END_STATES };
 constexpr TokenTag token_tags[] = { END_STATES };
 #undef X
 
-#define X(name, token_tag, string) string,
-static InternedString fixed_strings[] = { END_STATES };
-#undef X
-
 constexpr Automaton make() {
 	AutomatonBuilder builder{};
 
@@ -297,8 +315,7 @@ static void print_error(char const* p) {
 	printf("Error -- last two chars are: %c%c\n", *(p-2), *(p-1));
 }
 
-static void push_identifier_or_keyword(Automaton const& a, TokenArray& ta, string_view str) {
-
+static TokenTag identifier_or_keyword(Automaton const& a, string_view str) {
 	int state = state_count - 1;
 	for (int i = 0; i < str.size(); ++i) {
 		state = a.go(state, str.begin()[i]);
@@ -306,119 +323,136 @@ static void push_identifier_or_keyword(Automaton const& a, TokenArray& ta, strin
 			break;
 	}
 
-	if (KeywordLexer::EndStates::Count <= state || state == KeywordLexer::EndStates::Error) {
-		ta.push_back({
-			TokenTag::IDENTIFIER,
-			InternedString(str.begin(), str.size()),
-			0, 0, 0, 0
-		});
-	} else {
-		ta.push_back({
-			KeywordLexer::token_tags[state - 1],
-			KeywordLexer::fixed_strings[state - 1],
-			0, 0, 0, 0,
-		});
-	}
+	if (KeywordLexer::EndStates::Count <= state || state == KeywordLexer::EndStates::Error)
+		return TokenTag::IDENTIFIER;
+	return KeywordLexer::token_tags[state - 1];
 }
 
-TokenArray tokenize(char const* p) {
-	// Implementation detail: We store indices into the source buffer
-	// in the source_locations at first, then resolve them in another pass.
+static constexpr Automaton main_automaton = MainLexer::make();
+static constexpr Automaton keyword_automaton = KeywordLexer::make();
+
+static_assert(main_automaton.go(MainLexer::start, '"') == MainLexer::saw_open_string);
+static_assert(
+    main_automaton.go(main_automaton.go(MainLexer::start, '/'), '/') ==
+    MainLexer::saw_comment_marker);
+
+Lexer::Lexer(char const* source)
+    : m_window {source}
+    , m_cursor {source}
+    , m_eof {true} {
+	m_tokens.m_source = source;
+}
+
+Lexer::Lexer(SourceReader reader, size_t chunk_size)
+    : m_reader {std::move(reader)}
+    , m_chunk_size {chunk_size}
+    , m_eof {false} {
+	refill();
+}
+
+void Lexer::lex_until(int count) {
+	while (m_tokens.size() < count && !m_done)
+		lex_one();
+}
+
+void Lexer::lex_all() {
+	while (!m_done)
+		lex_one();
+}
+
+void Lexer::refill() {
+	// only the part of the input that hasn't been lexed yet is kept around.
+	// Tokens that were already pushed have their own copy of their text
+	size_t const keep_from = m_cursor - m_window;
+	m_base += keep_from;
+	m_buffer.erase(0, keep_from);
+
+	size_t const old_size = m_buffer.size();
+	m_buffer.resize(old_size + m_chunk_size);
+	size_t const read = m_reader(m_buffer.data() + old_size, m_chunk_size);
+	m_buffer.resize(old_size + read);
+	if (read == 0)
+		m_eof = true;
+
+	m_window = m_buffer.c_str();
+	m_cursor = m_window;
+	m_window_end = m_window + m_buffer.size();
+}
 
-	char const* const code_start = p;
+void Lexer::push(TokenTag tag, char const* start, char const* end) {
+	SourceRange const range {m_base + int(start - m_window), m_base + int(end - m_window)};
+	if (m_reader)
+		m_tokens.push_back(tag, range, start);
+	else
+		m_tokens.push_back(tag, range);
+}
+
+void Lexer::lex_one() {
+	using namespace MainLexer::EndStates;
 
-	constexpr Automaton a = MainLexer::make();
-	constexpr Automaton ka = KeywordLexer::make();
+	constexpr Automaton const& a = main_automaton;
+	constexpr Automaton const& ka = keyword_automaton;
 
-	TokenArray ta;
+	while (true) {
+		char const* p = CharScan::skip_whitespace(m_cursor);
 
-	auto eat_whitespace = [&] {
-		while (*p == ' ' || *p == '\t' || *p == '\n') {
-			p += 1;
+		if (*p == '\0') {
+			if (!m_eof && p == m_window_end) {
+				m_cursor = p;
+				refill();
+				continue;
+			}
+
+			push(TokenTag::END, p, p);
+			m_done = true;
+			return;
 		}
-	};
 
-	eat_whitespace();
-	while (*p != '\0') {
 		char const* const p0 = p;
 
-		int state = state_count - 1;
+		int state = MainLexer::start;
 		int new_state = a.go(state, *p++);
-		while (new_state != MainLexer::EndStates::Error) {
+		while (new_state != Error) {
 			state = new_state;
+			p = MainLexer::fast_forward(state, p);
 			new_state = a.go(state, *p++);
 		}
 
-		if (MainLexer::EndStates::Count <= state) {
-			print_error(p);
-			break;
+		// the token may go on in the next chunk
+		if (!m_eof && p - 1 == m_window_end) {
+			m_cursor = p0;
+			refill();
+			continue;
 		}
 
-		p -= 1;
+		// a comment that runs until the end of the input. It stops before
+		// the terminator instead of reading past it
+		if (state == MainLexer::saw_comment_marker)
+			state = Comment;
 
-		if(state <= MainLexer::EndStates::last_fixed_string) {
-			ta.push_back({
-				MainLexer::token_tags[state - 1],
-				MainLexer::fixed_strings[state - 1],
-				{{p0 - code_start}, {p - code_start}}
-			});
-		} else if(state == MainLexer::EndStates::Identifier) {
-			push_identifier_or_keyword(ka, ta, string_view(p0, p - p0));
-		} else if(state == MainLexer::EndStates::Comment) {
-			// do nothing.
-		} else if(state == MainLexer::EndStates::String) {
-			ta.push_back({
-				MainLexer::token_tags[state - 1],
-				InternedString(p0 + 1, p - p0 - 2),
-				{{p0 - code_start}, {p - code_start}}
-			});
-		} else {
-			ta.push_back({
-				MainLexer::token_tags[state - 1],
-				InternedString(p0, p - p0),
-				{{p0 - code_start}, {p - code_start}}
-			});
+		if (Count <= state) {
+			print_error(p);
+			push(TokenTag::END, p, p);
+			m_done = true;
+			return;
 		}
 
-		eat_whitespace();
-	}
-	ta.push_back({TokenTag::END, InternedString()});
-
-	// resolve source locations
-	{
-		int const real_token_count = ta.size() - 1;
-		int code_idx = 0;
-		int line = 0;
-		int col = 0;
-
-		auto advance_until = [&] (int end_idx) {
-			for (; code_idx < end_idx; ++code_idx) {
-				if (code_start[code_idx] == '\n') {
-					line += 1;
-					col = 0;
-				} else {
-					col += 1;
-				}
-			}
-		};
-
-		for (int i = 0; i < real_token_count; ++i) {
-			auto& token = ta.at(i);
-
-			int code_idx1 = token.m_source_location.start.line;
-			int code_idx2 = token.m_source_location.end.line;
-
-			advance_until(code_idx1);
-
-			token.m_source_location.start.line = line;
-			token.m_source_location.start.col = col;
+		p -= 1;
+		m_cursor = p;
 
-			advance_until(code_idx2);
+		if (state == Identifier)
+			push(identifier_or_keyword(ka, string_view(p0, p - p0)), p0, p);
+		else if (state == Comment)
+			continue;
+		else
+			push(MainLexer::token_tags[state - 1], p0, p);
 
-			token.m_source_location.end.line = line;
-			token.m_source_location.end.col = col;
-		}
+		return;
 	}
+}
 
-	return ta;
+TokenArray tokenize(char const* p) {
+	Lexer lexer {p};
+	lexer.lex_all();
+	return std::move(lexer.m_tokens);
 }
@@ -1,5 +1,58 @@
 #pragma once
 
+#include <functional>
+#include <string>
+
 #include "token_array.hpp"
 
+// Writes the next part of the source into the buffer, and returns how many
+// bytes it wrote. Returns 0 once the whole source has been read.
+using SourceReader = std::function<size_t(char* buffer, size_t capacity)>;
+
+// Produces tokens on demand, so that parsing can start before the whole
+// input has been read or lexed. Token ranges are offsets from the start of
+// the input, no matter how it was split into chunks.
+//
+// With a reader, only the part of the input that hasn't been lexed yet is
+// kept in memory, and the text of each token is copied into the token
+// array (see TokenArray).
+struct Lexer {
+	static constexpr size_t default_chunk_size = 1 << 16;
+
+	TokenArray m_tokens;
+
+	// lexes a NUL-terminated buffer holding the whole input
+	explicit Lexer(char const* source);
+	explicit Lexer(SourceReader reader, size_t chunk_size = default_chunk_size);
+
+	Lexer(Lexer const&) = delete;
+	Lexer& operator=(Lexer const&) = delete;
+
+	// lexes until there are at least `count` tokens, or the input ends
+	void lex_until(int count);
+	void lex_all();
+
+	[[nodiscard]] bool done() const {
+		return m_done;
+	}
+
+private:
+	SourceReader m_reader {};
+	size_t m_chunk_size {0};
+	// holds the part of the input that is in memory, when using a reader
+	std::string m_buffer {};
+	// m_window is the start of the input in memory, which is at offset
+	// m_base of the whole input. m_window_end is only used with a reader
+	char const* m_window {nullptr};
+	char const* m_window_end {nullptr};
+	char const* m_cursor {nullptr};
+	int m_base {0};
+	bool m_eof;
+	bool m_done {false};
+
+	void refill();
+	void lex_one();
+	void push(TokenTag, char const* start, char const* end);
+};
+
 TokenArray tokenize(char const* p);
@@ -2,11 +2,13 @@
 
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "./log/log.hpp"
 #include "./utils/interned_string.hpp"
 #include "ast.hpp"
+#include "ast_allocator.hpp"
 #include "error_report.hpp"
 #include "symbol_table.hpp"
 #include "token.hpp"
@@ -17,8 +19,9 @@ namespace Frontend {
 
 struct SymbolResolutionHelper {
 
-	SymbolResolutionHelper(SymbolTable& symbol_table)
-	    : m_symbol_table {symbol_table} {}
+	SymbolResolutionHelper(SymbolTable& symbol_table, AST::Allocator& allocator)
+	    : m_symbol_table {symbol_table}
+	    , m_allocator {allocator} {}
 
 	void declare(AST::Declaration* decl) {
 		m_symbol_table.declare(decl);
@@ -75,12 +78,40 @@ struct SymbolResolutionHelper {
 	void exit_top_level_decl() {
 		assert(m_current_decl);
 		m_current_decl = nullptr;
+		m_references.clear();
 	}
 
+	// Records that the current top level declaration uses `decl`. Short
+	// reference lists are deduplicated with a linear scan; once a list gets
+	// long, a hash set is kept alongside it so that declarations with many
+	// references don't go quadratic.
+	void add_reference(AST::Declaration* decl) {
+		auto* top_level_decl = current_top_level_declaration();
+		if (!top_level_decl)
+			return;
+
+		auto& references = top_level_decl->m_references;
+		if (references.size() < linear_reference_limit) {
+			references.insert(decl, m_allocator.m_lists);
+			return;
+		}
+
+		if (m_references.empty())
+			m_references.insert(references.begin(), references.end());
+		if (m_references.insert(decl).second)
+			references.push_back(decl, m_allocator.m_lists);
+	}
+
+	static constexpr int linear_reference_limit = 16;
+
 	SymbolTable& m_symbol_table;
+	// references and captures are recorded in the tree's arena
+	AST::Allocator& m_allocator;
 	std::vector<AST::FunctionLiteral*> m_function_stack;
 	std::vector<AST::SequenceExpression*> m_seq_expr_stack;
 	AST::Declaration* m_current_decl {nullptr};
+	// references of m_current_decl, once there are too many to scan
+	std::unordered_set<AST::Declaration*> m_references {};
 };
 
 #define CHECK_AND_RETURN(expr)                                                 \
@@ -113,7 +144,7 @@ struct SymbolResolutionHelper {
 	if (ast->m_value) {
 		CHECK_AND_WRAP(
 		    match_identifiers(ast->m_value, env),
-		    "While scanning declaration '" + ast->identifier_text().str() + "'");
+		    "While scanning declaration '" + std::string(ast->identifier_text().str()) + "'");
 	}
 
 	return {};
@@ -125,18 +156,15 @@ struct SymbolResolutionHelper {
 
 	if (!declaration) {
 		// TODO: clean up how we build error reports
-		auto token = ast->token();
 		return make_located_error(
-		    "accessed undeclared identifier '" + ast->text().str() + "'",
-		    token->m_source_location.start);
+		    "accessed undeclared identifier '" + std::string(ast->text().str()) + "'",
+		    ast->m_range.start);
 	}
 
 	ast->m_declaration = declaration;
 	ast->m_surrounding_function = env.current_function();
 
-	auto top_level_decl = env.current_top_level_declaration();
-	if (top_level_decl)
-		top_level_decl->m_references.insert(declaration);
+	env.add_reference(declaration);
 
 	if (declaration->is_global()) {
 		ast->m_origin = AST::Identifier::Origin::Global;
@@ -152,7 +180,7 @@ struct SymbolResolutionHelper {
 			auto* func = env.m_function_stack[i];
 			if (func == declaration->m_surrounding_function)
 				break;
-			func->m_captures.insert({ast->text(), {declaration}});
+			func->m_captures.insert({ast->text(), {declaration}}, env.m_allocator.m_lists);
 		}
 	}
 
@@ -297,7 +325,7 @@ struct SymbolResolutionHelper {
 			CHECK_AND_WRAP(
 			    match_identifiers(decl.m_value, env),
 			    "While scanning top level declaration '" +
-			        decl.identifier_text().str() + "'");
+			        std::string(decl.identifier_text().str()) + "'");
 
 		env.exit_top_level_decl();
 	}
@@ -375,8 +403,9 @@ struct SymbolResolutionHelper {
 
 #undef CHECK_AND_RETURN
 
-[[nodiscard]] ErrorReport match_identifiers(AST::AST* ast, SymbolTable& env) {
-	auto helper = SymbolResolutionHelper {env};
+[[nodiscard]] ErrorReport match_identifiers(
+    AST::AST* ast, SymbolTable& env, AST::Allocator& allocator) {
+	auto helper = SymbolResolutionHelper {env, allocator};
 	return match_identifiers(ast, helper);
 }
 
@@ -4,6 +4,7 @@
 
 namespace AST {
 struct AST;
+struct Allocator;
 struct Declaration;
 }
 
@@ -13,8 +14,9 @@ struct SymbolTable;
 
 /*
  * Matches every identifier in the given ast with a declaration.
- * This also includes captures in a closure.
+ * This also includes captures in a closure, which are stored in the
+ * allocator of the ast.
  */
-[[nodiscard]] ErrorReport match_identifiers(AST::AST* ast, SymbolTable&);
+[[nodiscard]] ErrorReport match_identifiers(AST::AST* ast, SymbolTable&, AST::Allocator&);
 
 } // namespace Frontend
@@ -46,12 +46,18 @@ bool MetaUnifier::occurs(int v, int i){
 	return false;
 }
 
+// path halving, like Unification::Core::find. Only vars point to a parent;
+// the target of a dot result is the node it's accessing
 int MetaUnifier::find(int idx) {
-	if (!is(idx, Tag::Var))
-		return idx;
-	if (nodes[idx].target == idx)
-		return idx;
-	return nodes[idx].target = find(nodes[idx].target);
+	while (is(idx, Tag::Var) && nodes[idx].target != idx) {
+		int parent = nodes[idx].target;
+		Node const& up = nodes[parent];
+		if (up.tag != Tag::Var || up.target == parent)
+			return parent;
+		nodes[idx].target = up.target;
+		idx = up.target;
+	}
+	return idx;
 }
 
 void MetaUnifier::register_dot_target(int idx) {
@@ -68,6 +74,8 @@ void MetaUnifier::turn_into_var(int idx, int target) {
 	assert(find(target) == target);
 	nodes[idx].tag = Tag::Var;
 	nodes[idx].target = target;
+	if (nodes[target].rank <= nodes[idx].rank)
+		nodes[target].rank = nodes[idx].rank + 1;
 	if (nodes[idx].is_dot_target)
 		register_dot_target(target);
 }
@@ -123,20 +131,35 @@ void MetaUnifier::unify(int idx1, int idx2) {
 		std::swap(tag1, tag2);
 	}
 
+	if (idx1 == idx2)
+		return;
+
+	// nodes that carry no data can go either way, so the lower tree goes
+	// under the higher one
+	auto link_by_rank = [&] {
+		if (nodes[idx2].rank < nodes[idx1].rank)
+			turn_into_var(idx2, idx1);
+		else
+			turn_into_var(idx1, idx2);
+	};
+
 	if (tag1 == Tag::Var) {
 		if (tag2 == Tag::DotResult) {
 			if (occurs(idx1, idx2))
 				Log::fatal() << "recursive unification";
 		}
 
-		turn_into_var(idx1, idx2);
+		if (tag2 == Tag::Var)
+			link_by_rank();
+		else
+			turn_into_var(idx1, idx2);
 		return;
 	}
 
 	if (is_constant(tag1) && is_constant(tag2)) {
 		if (tag1 != tag2)
 			Log::fatal() << "unified different concrete metatypes";
-		turn_into_var(idx1, idx2);
+		link_by_rank();
 		return;
 	}
 
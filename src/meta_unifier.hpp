@@ -19,6 +19,8 @@ struct Node {
 	Tag tag;
 	int target;
 	bool is_dot_target{false};
+	// upper bound on the height of the tree under a representative
+	unsigned char rank{0};
 };
 
 struct MetaUnifier {
@@ -4,9 +4,15 @@
 #include "cst.hpp"
 #include "cst_allocator.hpp"
 #include "error_report.hpp"
+#include "lexer.hpp"
 #include "token_array.hpp"
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
 #include <sstream>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -14,12 +20,14 @@
 
 template <typename T>
 Writer<T> make_writer(T x) {
-	return {{}, std::move(x)};
+	Writer<T> result;
+	result.m_result = std::move(x);
+	return result;
 }
 
 // WHY DO I HAVE TO TYPE THIS TWICE!?
-template <typename T, typename U>
-bool handle_error(Writer<T>& lhs, Writer<U>& rhs) {
+template <typename U>
+bool handle_error(ErrorContext& lhs, Writer<U>& rhs) {
 	if (not rhs.ok()) {
 		// NOTE: it's kinda bad that we move out of a non r-value, but
 		// due to the way we use it, it's safe.
@@ -29,8 +37,8 @@ bool handle_error(Writer<T>& lhs, Writer<U>& rhs) {
 	return false;
 }
 
-template <typename T, typename U>
-bool handle_error(Writer<T>& lhs, Writer<U>&& rhs) {
+template <typename U>
+bool handle_error(ErrorContext& lhs, Writer<U>&& rhs) {
 	if (not rhs.ok()) {
 		lhs.add_sub_error(std::move(rhs).error());
 		return true;
@@ -38,26 +46,28 @@ bool handle_error(Writer<T>& lhs, Writer<U>&& rhs) {
 	return false;
 }
 
-ErrorReport make_located_error(string_view text, Token const* token) {
-	return make_located_error(text, token->m_source_location.start);
+ErrorReport make_located_error(string_view text, Token token) {
+	return make_located_error(text, token.range().start);
 }
 
-ErrorReport make_expected_error(string_view expected, Token const* found_token) {
+ErrorReport make_expected_error(string_view expected, Token found_token) {
 	std::stringstream ss;
 	ss << "Expected " << expected << " but got "
-	   << token_string[int(found_token->m_type)] << ' ' << found_token->m_text
+	   << token_string[int(found_token.type())] << ' ' << found_token.text()
 	   << " instead";
 
 	return make_located_error(ss.str(), found_token);
 }
 
-ErrorReport make_expected_error(TokenTag tag, Token const* found_token) {
+ErrorReport make_expected_error(TokenTag tag, Token found_token) {
 	return make_expected_error(token_string[int(tag)], found_token);
 }
 
 struct Parser {
 	/* token handler */
 	TokenArray const& m_tokens;
+	// if set, tokens are lexed as the parser asks for them
+	Lexer* m_lexer { nullptr };
 	CST::Allocator& m_cst_allocator;
 	int m_token_cursor { 0 };
 
@@ -65,9 +75,15 @@ struct Parser {
 	    : m_tokens {tokens}
 	    , m_cst_allocator {cst_allocator} {}
 
+	Parser(Lexer& lexer, CST::Allocator& cst_allocator)
+	    : m_tokens {lexer.m_tokens}
+	    , m_lexer {&lexer}
+	    , m_cst_allocator {cst_allocator} {}
+
 	Writer<std::vector<CST::CST*>> parse_expression_list(TokenTag, TokenTag, bool);
 
 	Writer<CST::CST*> parse_top_level();
+	Writer<CST::CST*> parse_top_level(std::vector<CST::Declaration*> declarations);
 
 	Writer<CST::CST*> parse_sequence_expression();
 	Writer<CST::Identifier*> parse_identifier(bool types_allowed = false);
@@ -81,6 +97,16 @@ struct Parser {
 	Writer<CST::CST*> parse_expression(int bp = 0);
 	Writer<CST::CST*> parse_expression(CST::CST* lhs, int bp = 0);
 
+	// parse what follows an expression, given the expression and the right
+	// binding power of the token. See infix_table
+	Writer<CST::CST*> parse_call(CST::CST* lhs, Token, int);
+	Writer<CST::CST*> parse_index(CST::CST* lhs, Token, int);
+	Writer<CST::CST*> parse_type_arguments(CST::CST* lhs, Token, int);
+	Writer<CST::CST*> parse_access(CST::CST* lhs, Token, int);
+	Writer<CST::CST*> parse_construction(CST::CST* lhs, Token, int);
+	Writer<CST::CST*> parse_binary(CST::CST* lhs, Token op, int rp);
+	Writer<CST::CST*> parse_unexpected(CST::CST* lhs, Token op, int);
+
 	Writer<CST::CST*> parse_terminal();
 	Writer<CST::CST*> parse_ternary_expression();
 	Writer<CST::CST*> parse_ternary_expression(CST::CST* parsed_condition);
@@ -95,7 +121,7 @@ struct Parser {
 	Writer<CST::CST*> parse_for_statement();
 	Writer<CST::CST*> parse_while_statement();
 	Writer<CST::CST*> parse_match_expression();
-	Writer<std::pair<Token const*, CST::CST*>> parse_name_and_type(bool required_type = false);
+	Writer<std::pair<Token, CST::CST*>> parse_name_and_type(bool required_type = false);
 	Writer<CST::CST*> parse_type_term();
 	Writer<std::vector<CST::CST*>> parse_type_term_arguments();
 	Writer<std::pair<std::vector<CST::Identifier>, std::vector<CST::CST*>>> parse_type_list(bool);
@@ -106,15 +132,17 @@ struct Parser {
 		m_token_cursor += 1;
 	}
 
-	Token const* peek(int dt = 0) {
+	Token peek(int dt = 0) {
 		int index = m_token_cursor + dt;
-		return &m_tokens.at(index);
+		if (m_lexer)
+			m_lexer->lex_until(index + 1);
+		return m_tokens.at(index);
 	}
 
-	Writer<Token const*> require(TokenTag expected_type) {
-		Token const* current_token = peek();
+	Writer<Token> require(TokenTag expected_type) {
+		Token current_token = peek();
 
-		if (current_token->m_type != expected_type) {
+		if (current_token.type() != expected_type) {
 			return {make_expected_error(expected_type, current_token)};
 		}
 
@@ -124,8 +152,8 @@ struct Parser {
 	}
 
 	bool match(TokenTag expected_type) {
-		Token const* current_token = peek();
-		return current_token->m_type == expected_type;
+		Token current_token = peek();
+		return current_token.type() == expected_type;
 	}
 
 	bool consume(TokenTag expected_type) {
@@ -150,9 +178,13 @@ struct Parser {
 		return result;
 
 Writer<CST::CST*> Parser::parse_top_level() {
-	Writer<CST::CST*> result = {{"Failed to parse program"}};
+	return parse_top_level({});
+}
+
+// parses the rest of a program, after the given declarations
+Writer<CST::CST*> Parser::parse_top_level(std::vector<CST::Declaration*> declarations) {
+	ErrorContext result {"Failed to parse program"};
 
-	std::vector<CST::Declaration*> declarations;
 	while (!match(TokenTag::END)) {
 		auto declaration = parse_declaration();
 		CHECK_AND_RETURN(result, declaration);
@@ -160,7 +192,7 @@ Writer<CST::CST*> Parser::parse_top_level() {
 	}
 
 	auto e = m_cst_allocator.make<CST::Program>();
-	e->m_declarations = std::move(declarations);
+	e->m_declarations = m_cst_allocator.make_list(declarations);
 	return make_writer<CST::CST*>(e);
 }
 
@@ -180,7 +212,7 @@ Writer<std::vector<CST::CST*>> Parser::parse_expression_list(
 
 		auto p0 = peek();
 
-		if (p0->m_type == delimiter) {
+		if (p0.type() == delimiter) {
 			advance_token_cursor();
 
 			if (match(terminator)) {
@@ -192,11 +224,11 @@ Writer<std::vector<CST::CST*>> Parser::parse_expression_list(
 				return make_located_error(
 				    "Found trailing delimiter in expression list", p0);
 			}
-		} else if (p0->m_type == terminator) {
+		} else if (p0.type() == terminator) {
 			advance_token_cursor();
 			break;
 		} else {
-			Writer<std::vector<CST::CST*>> result = {{"Failed to parse expression list"}};
+			ErrorContext result {"Failed to parse expression list"};
 			result.add_sub_error(make_expected_error(delimiter, p0));
 			result.add_sub_error(make_expected_error(terminator, p0));
 			return result;
@@ -219,7 +251,7 @@ Writer<CST::Declaration*> Parser::parse_declaration() {
 }
 
 Writer<CST::Declaration*> Parser::parse_func_declaration() {
-	Writer<CST::Declaration*> result = {{"Failed to parse function declaration"}};
+	ErrorContext result {"Failed to parse function declaration"};
 
 	REQUIRE(result, TokenTag::KEYWORD_FN);
 
@@ -238,7 +270,7 @@ Writer<CST::Declaration*> Parser::parse_func_declaration() {
 		auto p = m_cst_allocator.make<CST::FuncDeclaration>();
 
 		p->m_identifier = identifier.m_result;
-		p->m_args = std::move(args.m_result);
+		p->m_args = args.m_result;
 		p->m_body = expression.m_result;
 
 		return make_writer(p);
@@ -253,7 +285,7 @@ Writer<CST::Declaration*> Parser::parse_func_declaration() {
 		auto p = m_cst_allocator.make<CST::BlockFuncDeclaration>();
 
 		p->m_identifier = identifier.m_result;
-		p->m_args = std::move(args.m_result);
+		p->m_args = args.m_result;
 		p->m_body = block.m_result;
 
 		return make_writer(p);
@@ -264,7 +296,7 @@ Writer<CST::Declaration*> Parser::parse_func_declaration() {
 }
 
 Writer<CST::PlainDeclaration*> Parser::parse_plain_declaration() {
-	Writer<CST::PlainDeclaration*> result = {{"Failed to parse declaration"}};
+	ErrorContext result {"Failed to parse declaration"};
 
 	auto decl_data = parse_plain_declaration_data();
 	CHECK_AND_RETURN(result, decl_data);
@@ -309,79 +341,8 @@ Writer<CST::DeclarationData> Parser::parse_plain_declaration_data() {
 	    {name.m_result, type.m_result, value.m_result});
 }
 
-// These are important for infix expression parsing.
-// TODO: clean up
-
-struct binding_power {
-	int left, right;
-};
-
-bool is_binary_operator(TokenTag t) {
-	// TODO: fill out this table
-	switch (t) {
-	case TokenTag::PAREN_OPEN:   // a bit of a hack
-	case TokenTag::BRACKET_OPEN: // a bit of a hack
-	case TokenTag::POLY_OPEN:    // a bit of a hack
-	case TokenTag::BRACE_OPEN:   // a bit of a hack
-
-	case TokenTag::LT:
-	case TokenTag::GT:
-	case TokenTag::LTE:
-	case TokenTag::GTE:
-	case TokenTag::EQUAL:
-	case TokenTag::NOT_EQUAL:
-	case TokenTag::LOGIC_AND:
-	case TokenTag::LOGIC_IOR:
-	case TokenTag::ASSIGN:
-	case TokenTag::DOT:
-	case TokenTag::PIZZA:
-	case TokenTag::ADD:
-	case TokenTag::SUB:
-	case TokenTag::MUL:
-	case TokenTag::DIV: // fallthrough
-		return true;
-	default:
-		return false;
-	}
-}
-
-binding_power binding_power_of(TokenTag t) {
-	// TODO: fill out this table
-	switch (t) {
-
-	case TokenTag::ASSIGN:
-		return {10, 11};
-	case TokenTag::PIZZA:
-	case TokenTag::LOGIC_IOR:
-	case TokenTag::LOGIC_AND:
-		return {20, 21};
-	case TokenTag::LT:
-	case TokenTag::GT:
-	case TokenTag::LTE:
-	case TokenTag::GTE:
-	case TokenTag::EQUAL:
-	case TokenTag::NOT_EQUAL: // fallthrough
-		return {30, 31};
-	case TokenTag::ADD:
-	case TokenTag::SUB: // fallthrough
-		return {40, 41};
-	case TokenTag::MUL:
-	case TokenTag::DIV: // fallthrough
-		return {50, 51};
-	case TokenTag::PAREN_OPEN:   // a bit of a hack
-	case TokenTag::BRACKET_OPEN: // a bit of a hack
-	case TokenTag::POLY_OPEN:    // a bit of a hack
-	case TokenTag::BRACE_OPEN:   // a bit of a hack
-	case TokenTag::DOT:
-		return {70, 71};
-	default:
-		exit(1);
-		assert(false);
-	}
-}
-
 Writer<std::vector<CST::CST*>> Parser::parse_argument_list() {
-	Writer<std::vector<CST::CST*>> result = {{"Failed to parse argument list"}};
+	ErrorContext result {"Failed to parse argument list"};
 
 	REQUIRE(result, TokenTag::PAREN_OPEN);
 	auto args =
@@ -393,7 +354,7 @@ Writer<std::vector<CST::CST*>> Parser::parse_argument_list() {
 
 // This function just wraps the result of parse_expression in an extra layer of error when it fails
 Writer<CST::CST*> Parser::parse_full_expression(int bp) {
-	Writer<CST::CST*> result = {{"Failed to parse expression"}};
+	ErrorContext result {"Failed to parse expression"};
 	auto expr = parse_expression(bp);
 	CHECK_AND_RETURN(result, expr);
 	return expr;
@@ -405,111 +366,174 @@ Writer<CST::CST*> Parser::parse_expression(int bp) {
 	return parse_expression(lhs.m_result, bp);
 }
 
-/* The algorithm used here is called 'Pratt Parsing'
- * Here is an article with more information:
- * https://matklad.github.io/2020/04/13/simple-but-powerful-pratt-parsing.html
- */
-Writer<CST::CST*> Parser::parse_expression(CST::CST* lhs, int bp) {
-	assert(lhs);
-	while (1) {
-		auto op = peek();
+Writer<CST::CST*> Parser::parse_call(CST::CST* lhs, Token, int) {
+	auto args = parse_argument_list();
+	CHECK_AND_EXTRACT(args);
 
-		if (op->m_type == TokenTag::SEMICOLON ||
-		    op->m_type == TokenTag::END ||
-		    op->m_type == TokenTag::BRACE_CLOSE ||
-		    op->m_type == TokenTag::BRACKET_CLOSE ||
-		    op->m_type == TokenTag::PAREN_CLOSE ||
-		    op->m_type == TokenTag::COMMA ||
-		    op->m_type == TokenTag::KEYWORD_THEN ||
-		    op->m_type == TokenTag::KEYWORD_ELSE) {
-			break;
-		}
+	auto e = m_cst_allocator.make<CST::CallExpression>();
+	e->m_callee = lhs;
+	e->m_args = m_cst_allocator.make_list(args.m_result);
+	return make_writer<CST::CST*>(e);
+}
 
-		if (not is_binary_operator(op->m_type))
-			return make_expected_error("a binary operator", op);
+Writer<CST::CST*> Parser::parse_index(CST::CST* lhs, Token, int) {
+	advance_token_cursor();
 
-		auto op_bp = binding_power_of(op->m_type);
-		auto& lp = op_bp.left;
-		auto& rp = op_bp.right;
+	auto index = parse_expression();
+	CHECK_AND_EXTRACT(index);
 
-		if (lp < bp)
-			break;
+	auto bracket_close = require(TokenTag::BRACKET_CLOSE);
+	CHECK_AND_EXTRACT(bracket_close);
 
-		if (op->m_type == TokenTag::PAREN_OPEN) {
-			auto args = parse_argument_list();
-			CHECK_AND_EXTRACT(args);
+	auto e = m_cst_allocator.make<CST::IndexExpression>();
+	e->m_callee = lhs;
+	e->m_index = index.m_result;
+	return make_writer<CST::CST*>(e);
+}
 
-			auto e = m_cst_allocator.make<CST::CallExpression>();
-			e->m_callee = lhs;
-			e->m_args = std::move(args.m_result);
-			lhs = e;
+Writer<CST::CST*> Parser::parse_type_arguments(CST::CST* lhs, Token, int) {
+	auto args = parse_type_term_arguments();
+	CHECK_AND_EXTRACT(args);
 
-			continue;
-		}
+	auto e = m_cst_allocator.make<CST::TypeTerm>();
+	e->m_callee = lhs;
+	e->m_args = m_cst_allocator.make_list(args.m_result);
+	return make_writer<CST::CST*>(e);
+}
 
-		if (op->m_type == TokenTag::BRACKET_OPEN) {
-			advance_token_cursor();
+Writer<CST::CST*> Parser::parse_access(CST::CST* lhs, Token, int) {
+	advance_token_cursor();
 
-			auto index = parse_expression();
-			CHECK_AND_EXTRACT(index);
+	auto member = require(TokenTag::IDENTIFIER);
+	CHECK_AND_EXTRACT(member);
 
-			auto bracket_close = require(TokenTag::BRACKET_CLOSE);
-			CHECK_AND_EXTRACT(bracket_close);
+	auto e = m_cst_allocator.make<CST::AccessExpression>();
+	e->m_record = lhs;
+	e->m_member = member.m_result;
+	return make_writer<CST::CST*>(e);
+}
 
-			auto e = m_cst_allocator.make<CST::IndexExpression>();
-			e->m_callee = lhs;
-			e->m_index = index.m_result;
-			lhs = e;
+Writer<CST::CST*> Parser::parse_construction(CST::CST* lhs, Token, int) {
+	advance_token_cursor();
 
-			continue;
-		}
+	auto args = parse_expression_list(TokenTag::SEMICOLON, TokenTag::BRACE_CLOSE, true);
+	CHECK_AND_EXTRACT(args);
 
-		if (match(TokenTag::POLY_OPEN)) {
-			auto args = parse_type_term_arguments();
-			CHECK_AND_EXTRACT(args);
+	auto e = m_cst_allocator.make<CST::ConstructorExpression>();
+	e->m_constructor = lhs;
+	e->m_args = m_cst_allocator.make_list(args.m_result);
+	return make_writer<CST::CST*>(e);
+}
 
-			auto e = m_cst_allocator.make<CST::TypeTerm>();
-			e->m_callee = lhs;
-			e->m_args = std::move(args.m_result);
-			lhs = e;
+Writer<CST::CST*> Parser::parse_binary(CST::CST* lhs, Token op, int rp) {
+	advance_token_cursor();
+	auto rhs = parse_expression(rp);
 
-			continue;
-		}
+	auto e = m_cst_allocator.make<CST::BinaryExpression>();
+	e->m_op_token = op;
+	e->m_lhs = lhs;
+	e->m_rhs = rhs.m_result;
+	return make_writer<CST::CST*>(e);
+}
 
-		if (consume(TokenTag::DOT)) {
-			auto member = require(TokenTag::IDENTIFIER);
-			CHECK_AND_EXTRACT(member);
+Writer<CST::CST*> Parser::parse_unexpected(CST::CST*, Token op, int) {
+	return make_expected_error("a binary operator", op);
+}
 
-			auto e = m_cst_allocator.make<CST::AccessExpression>();
-			e->m_record = lhs;
-			e->m_member = member.m_result;
-			lhs = e;
+// How each token behaves after an expression. Tokens that end an
+// expression have a left binding power below any other, so the loop in
+// parse_expression stops on them without a special case. Tokens that can't
+// go there at all bind tighter than anything and report an error.
+struct InfixOperator {
+	using Handler = Writer<CST::CST*> (Parser::*)(CST::CST*, Token, int);
 
-			continue;
-		}
+	int left;
+	int right;
+	Handler handler;
+};
 
-		if (consume(TokenTag::BRACE_OPEN)) {
-			auto args =
-			    parse_expression_list(TokenTag::SEMICOLON, TokenTag::BRACE_CLOSE, true);
-			CHECK_AND_EXTRACT(args);
+constexpr int token_tag_count = std::size(token_string);
 
-			auto e = m_cst_allocator.make<CST::ConstructorExpression>();
-			e->m_constructor = lhs;
-			e->m_args = std::move(args.m_result);
-			lhs = e;
+struct InfixTableBuilder {
+	std::array<InfixOperator, token_tag_count> table {};
 
-			continue;
-		}
+	constexpr InfixTableBuilder& set(TokenTag t, int left, int right, InfixOperator::Handler handler) {
+		table[int(t)] = {left, right, handler};
+		return *this;
+	}
 
-		advance_token_cursor();
-		auto rhs = parse_expression(rp);
+	constexpr InfixTableBuilder& terminator(TokenTag t) {
+		return set(t, -1, -1, nullptr);
+	}
+
+	constexpr InfixTableBuilder& binary(TokenTag t, int left, int right) {
+		return set(t, left, right, &Parser::parse_binary);
+	}
+};
 
-		auto e = m_cst_allocator.make<CST::BinaryExpression>();
-		e->m_op_token = op;
-		e->m_lhs = lhs;
-		e->m_rhs = rhs.m_result;
+constexpr std::array<InfixOperator, token_tag_count> make_infix_table() {
+	InfixTableBuilder builder {};
+
+	for (auto& entry : builder.table)
+		entry = {std::numeric_limits<int>::max(), 0, &Parser::parse_unexpected};
+
+	builder
+	    .terminator(TokenTag::SEMICOLON)
+	    .terminator(TokenTag::END)
+	    .terminator(TokenTag::BRACE_CLOSE)
+	    .terminator(TokenTag::BRACKET_CLOSE)
+	    .terminator(TokenTag::PAREN_CLOSE)
+	    .terminator(TokenTag::COMMA)
+	    .terminator(TokenTag::KEYWORD_THEN)
+	    .terminator(TokenTag::KEYWORD_ELSE)
+
+	    .binary(TokenTag::ASSIGN, 10, 11)
+
+	    .binary(TokenTag::PIZZA, 20, 21)
+	    .binary(TokenTag::LOGIC_IOR, 20, 21)
+	    .binary(TokenTag::LOGIC_AND, 20, 21)
+
+	    .binary(TokenTag::LT, 30, 31)
+	    .binary(TokenTag::GT, 30, 31)
+	    .binary(TokenTag::LTE, 30, 31)
+	    .binary(TokenTag::GTE, 30, 31)
+	    .binary(TokenTag::EQUAL, 30, 31)
+	    .binary(TokenTag::NOT_EQUAL, 30, 31)
+
+	    .binary(TokenTag::ADD, 40, 41)
+	    .binary(TokenTag::SUB, 40, 41)
+
+	    .binary(TokenTag::MUL, 50, 51)
+	    .binary(TokenTag::DIV, 50, 51)
+
+	    // postfix forms, parsed as if they were operators
+	    .set(TokenTag::PAREN_OPEN, 70, 71, &Parser::parse_call)
+	    .set(TokenTag::BRACKET_OPEN, 70, 71, &Parser::parse_index)
+	    .set(TokenTag::POLY_OPEN, 70, 71, &Parser::parse_type_arguments)
+	    .set(TokenTag::BRACE_OPEN, 70, 71, &Parser::parse_construction)
+	    .set(TokenTag::DOT, 70, 71, &Parser::parse_access);
+
+	return builder.table;
+}
+
+constexpr auto infix_table = make_infix_table();
+
+/* The algorithm used here is called 'Pratt Parsing'
+ * Here is an article with more information:
+ * https://matklad.github.io/2020/04/13/simple-but-powerful-pratt-parsing.html
+ */
+Writer<CST::CST*> Parser::parse_expression(CST::CST* lhs, int bp) {
+	assert(lhs);
+	while (1) {
+		auto op = peek();
+		auto const& entry = infix_table[int(op.type())];
 
-		lhs = e;
+		if (entry.left < bp)
+			break;
+
+		auto e = (this->*entry.handler)(lhs, op, entry.right);
+		CHECK_AND_EXTRACT(e);
+		lhs = e.m_result;
 	}
 
 	return make_writer<CST::CST*>(lhs);
@@ -521,94 +545,94 @@ Writer<CST::CST*> Parser::parse_expression(CST::CST* lhs, int bp) {
 Writer<CST::CST*> Parser::parse_terminal() {
 	auto token = peek();
 
-	if (token->m_type == TokenTag::KEYWORD_NULL) {
+	if (token.type() == TokenTag::KEYWORD_NULL) {
 		auto e = m_cst_allocator.make<CST::NullLiteral>();
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_TRUE) {
+	if (token.type() == TokenTag::KEYWORD_TRUE) {
 		auto e = m_cst_allocator.make<CST::BooleanLiteral>();
 		e->m_token = token;
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_FALSE) {
+	if (token.type() == TokenTag::KEYWORD_FALSE) {
 		auto e = m_cst_allocator.make<CST::BooleanLiteral>();
 		e->m_token = token;
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::SUB || token->m_type == TokenTag::ADD) {
+	if (token.type() == TokenTag::SUB || token.type() == TokenTag::ADD) {
 		advance_token_cursor();
 
 		// NOTE: we store the sign token of the source code for future
 		// feature of printing the source code when an error occurs
 		if (match(TokenTag::INTEGER)) {
 			auto e = m_cst_allocator.make<CST::IntegerLiteral>();
-			e->m_negative = token->m_type == TokenTag::SUB;
+			e->m_negative = token.type() == TokenTag::SUB;
 			e->m_sign = token;
 			e->m_token = peek();
 			advance_token_cursor();
 			return make_writer<CST::CST*>(e);
 		} else if (match(TokenTag::NUMBER)) {
 			auto e = m_cst_allocator.make<CST::NumberLiteral>();
-			e->m_negative = token->m_type == TokenTag::SUB;
+			e->m_negative = token.type() == TokenTag::SUB;
 			e->m_sign = token;
 			e->m_token = peek();
 			advance_token_cursor();
 			return make_writer<CST::CST*>(e);
 		}
 
-		return token->m_type == TokenTag::SUB
+		return token.type() == TokenTag::SUB
 		           ? make_located_error("Stray minus sign with no number", token)
 		           : make_located_error("Stray plus sign with no number", token);
 	}
 
-	if (token->m_type == TokenTag::INTEGER) {
+	if (token.type() == TokenTag::INTEGER) {
 		auto e = m_cst_allocator.make<CST::IntegerLiteral>();
 		e->m_token = token;
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::NUMBER) {
+	if (token.type() == TokenTag::NUMBER) {
 		auto e = m_cst_allocator.make<CST::NumberLiteral>();
 		e->m_token = token;
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::IDENTIFIER) {
+	if (token.type() == TokenTag::IDENTIFIER) {
 		auto e = m_cst_allocator.make<CST::Identifier>();
 		e->m_token = token;
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::STRING) {
+	if (token.type() == TokenTag::STRING) {
 		auto e = m_cst_allocator.make<CST::StringLiteral>();
 		e->m_token = token;
 		advance_token_cursor();
 		return make_writer<CST::CST*>(e);
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_FN) {
+	if (token.type() == TokenTag::KEYWORD_FN) {
 		auto function = parse_function();
 		CHECK_AND_EXTRACT(function);
 		return function;
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_IF) {
+	if (token.type() == TokenTag::KEYWORD_IF) {
 		auto ternary = parse_ternary_expression();
 		CHECK_AND_EXTRACT(ternary);
 		return ternary;
 	}
 
 	// parse a parenthesized expression.
-	if (token->m_type == TokenTag::PAREN_OPEN) {
+	if (token.type() == TokenTag::PAREN_OPEN) {
 		advance_token_cursor();
 		auto expr = parse_expression();
 		CHECK_AND_EXTRACT(expr);
@@ -617,27 +641,27 @@ Writer<CST::CST*> Parser::parse_terminal() {
 		return expr;
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_ARRAY) {
+	if (token.type() == TokenTag::KEYWORD_ARRAY) {
 		auto array = parse_array_literal();
 		CHECK_AND_EXTRACT(array);
 		return array;
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_UNION ||
-	    token->m_type == TokenTag::KEYWORD_STRUCT) {
+	if (token.type() == TokenTag::KEYWORD_UNION ||
+	    token.type() == TokenTag::KEYWORD_STRUCT) {
 		// TODO: do the other type functions
 		auto type = parse_type_function();
 		CHECK_AND_EXTRACT(type);
 		return type;
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_MATCH) {
+	if (token.type() == TokenTag::KEYWORD_MATCH) {
 		auto match_expr = parse_match_expression();
 		CHECK_AND_EXTRACT(match_expr);
 		return match_expr;
 	}
 
-	if (token->m_type == TokenTag::KEYWORD_SEQ) {
+	if (token.type() == TokenTag::KEYWORD_SEQ) {
 		auto expr = parse_sequence_expression();
 		CHECK_AND_EXTRACT(expr);
 		return expr;
@@ -647,7 +671,7 @@ Writer<CST::CST*> Parser::parse_terminal() {
 }
 
 Writer<CST::CST*> Parser::parse_ternary_expression() {
-	Writer<CST::CST*> result = {{"Failed to parse ternary expression"}};
+	ErrorContext result {"Failed to parse ternary expression"};
 
 	REQUIRE(result, TokenTag::KEYWORD_IF);
 	REQUIRE(result, TokenTag::PAREN_OPEN);
@@ -662,7 +686,7 @@ Writer<CST::CST*> Parser::parse_ternary_expression() {
 Writer<CST::CST*> Parser::parse_ternary_expression(CST::CST* condition) {
 	assert(condition);
 
-	Writer<CST::CST*> result = {{"Failed to parse ternary expression"}};
+	ErrorContext result {"Failed to parse ternary expression"};
 
 	REQUIRE(result, TokenTag::KEYWORD_THEN);
 
@@ -682,9 +706,9 @@ Writer<CST::CST*> Parser::parse_ternary_expression(CST::CST* condition) {
 }
 
 Writer<CST::Identifier*> Parser::parse_identifier(bool types_allowed) {
-	Writer<CST::Identifier*> result = {{"Failed to parse identifier"}};
+	ErrorContext result {"Failed to parse identifier"};
 
-	Token const* token;
+	Token token;
 
 	if (types_allowed and match(TokenTag::KEYWORD_ARRAY)) {
 		token = peek();
@@ -702,7 +726,7 @@ Writer<CST::Identifier*> Parser::parse_identifier(bool types_allowed) {
 }
 
 Writer<CST::CST*> Parser::parse_array_literal() {
-	Writer<CST::CST*> result = {{"Failed to parse array literal"}};
+	ErrorContext result {"Failed to parse array literal"};
 
 	REQUIRE(result, TokenTag::KEYWORD_ARRAY);
 	REQUIRE(result, TokenTag::BRACE_OPEN);
@@ -712,7 +736,7 @@ Writer<CST::CST*> Parser::parse_array_literal() {
 	CHECK_AND_RETURN(result, elements);
 
 	auto e = m_cst_allocator.make<CST::ArrayLiteral>();
-	e->m_elements = std::move(elements.m_result);
+	e->m_elements = m_cst_allocator.make_list(elements.m_result);
 
 	return make_writer<CST::CST*>(e);
 }
@@ -726,7 +750,7 @@ Writer<CST::FuncParameters> Parser::parse_function_parameters() {
 	std::vector<CST::DeclarationData> args_data;
 
 	if (consume(TokenTag::PAREN_CLOSE))
-		return make_writer(CST::FuncParameters {std::move(args_data)});
+		return make_writer(m_cst_allocator.make_list(args_data));
 
 	while (1) {
 		if (!match(TokenTag::IDENTIFIER))
@@ -762,7 +786,7 @@ Writer<CST::FuncParameters> Parser::parse_function_parameters() {
 		}
 	}
 
-	return make_writer(CST::FuncParameters {std::move(args_data)});
+	return make_writer(m_cst_allocator.make_list(args_data));
 }
 
 /*
@@ -772,7 +796,7 @@ Writer<CST::FuncParameters> Parser::parse_function_parameters() {
  * }
  */
 Writer<CST::CST*> Parser::parse_function() {
-	Writer<CST::CST*> result = {{"Failed to parse function"}};
+	ErrorContext result {"Failed to parse function"};
 
 	REQUIRE(result, TokenTag::KEYWORD_FN);
 
@@ -786,7 +810,7 @@ Writer<CST::CST*> Parser::parse_function() {
 
 		auto e = m_cst_allocator.make<CST::FunctionLiteral>();
 		e->m_body = expression.m_result;
-		e->m_args = std::move(func_args.m_result);
+		e->m_args = func_args.m_result;
 
 		return make_writer<CST::CST*>(e);
 	} else if (match(TokenTag::BRACE_OPEN)) {
@@ -795,7 +819,7 @@ Writer<CST::CST*> Parser::parse_function() {
 
 		auto e = m_cst_allocator.make<CST::BlockFunctionLiteral>();
 		e->m_body = block.m_result;
-		e->m_args = std::move(func_args.m_result);
+		e->m_args = func_args.m_result;
 
 		return make_writer<CST::CST*>(e);
 	} else {
@@ -804,7 +828,7 @@ Writer<CST::CST*> Parser::parse_function() {
 }
 
 Writer<CST::Block*> Parser::parse_block() {
-	Writer<CST::Block*> result = {{"Failed to parse block statement"}};
+	ErrorContext result {"Failed to parse block statement"};
 
 	REQUIRE(result, TokenTag::BRACE_OPEN);
 
@@ -814,12 +838,12 @@ Writer<CST::Block*> Parser::parse_block() {
 	while (1) {
 		auto p0 = peek();
 
-		if (p0->m_type == TokenTag::END) {
+		if (p0.type() == TokenTag::END) {
 			result.add_sub_error({{"Found EOF while parsing block statement"}});
 			return result;
 		}
 
-		if (p0->m_type == TokenTag::BRACE_CLOSE) {
+		if (p0.type() == TokenTag::BRACE_CLOSE) {
 			advance_token_cursor();
 			break;
 		}
@@ -830,13 +854,13 @@ Writer<CST::Block*> Parser::parse_block() {
 	}
 
 	auto e = m_cst_allocator.make<CST::Block>();
-	e->m_body = std::move(statements);
+	e->m_body = m_cst_allocator.make_list(statements);
 
 	return make_writer(e);
 }
 
 Writer<CST::CST*> Parser::parse_return_statement() {
-	Writer<CST::CST*> result = {{"Failed to parse return statement"}};
+	ErrorContext result {"Failed to parse return statement"};
 
 	REQUIRE(result, TokenTag::KEYWORD_RETURN);
 
@@ -850,7 +874,7 @@ Writer<CST::CST*> Parser::parse_return_statement() {
 	return make_writer<CST::CST*>(e);
 }
 Writer<CST::CST*> Parser::parse_if_else_stmt_or_expr() {
-	Writer<CST::CST*> result = {{"Failed to parse if-else statement or expression"}};
+	ErrorContext result {"Failed to parse if-else statement or expression"};
 
 	REQUIRE(result, TokenTag::KEYWORD_IF);
 	REQUIRE(result, TokenTag::PAREN_OPEN);
@@ -889,7 +913,7 @@ Writer<CST::CST*> Parser::parse_if_else_stmt_or_expr() {
 }
 
 Writer<CST::CST*> Parser::parse_for_statement() {
-	Writer<CST::CST*> result = {{"Failed to parse for statement"}};
+	ErrorContext result {"Failed to parse for statement"};
 
 	REQUIRE(result, TokenTag::KEYWORD_FOR);
 	REQUIRE(result, TokenTag::PAREN_OPEN);
@@ -919,7 +943,7 @@ Writer<CST::CST*> Parser::parse_for_statement() {
 }
 
 Writer<CST::CST*> Parser::parse_while_statement() {
-	Writer<CST::CST*> result = {{"Failed to parse while statement"}};
+	ErrorContext result {"Failed to parse while statement"};
 
 	REQUIRE(result, TokenTag::KEYWORD_WHILE);
 	REQUIRE(result, TokenTag::PAREN_OPEN);
@@ -939,7 +963,7 @@ Writer<CST::CST*> Parser::parse_while_statement() {
 }
 
 Writer<CST::CST*> Parser::parse_match_expression() {
-	Writer<CST::CST*> result = {{"Failed to parse match expression"}};
+	ErrorContext result {"Failed to parse match expression"};
 
 	REQUIRE(result, TokenTag::KEYWORD_MATCH);
 	REQUIRE(result, TokenTag::PAREN_OPEN);
@@ -977,13 +1001,13 @@ Writer<CST::CST*> Parser::parse_match_expression() {
 	auto match = m_cst_allocator.make<CST::MatchExpression>();
 	match->m_matchee = std::move(matchee);
 	match->m_type_hint = matchee_and_hint.m_result.second;
-	match->m_cases = std::move(cases);
+	match->m_cases = m_cst_allocator.make_list(cases);
 
 	return make_writer<CST::CST*>(match);
 }
 
 Writer<CST::CST*> Parser::parse_sequence_expression() {
-	Writer<CST::CST*> result = {{"Failed to parse sequence expression"}};
+	ErrorContext result {"Failed to parse sequence expression"};
 
 	REQUIRE(result, TokenTag::KEYWORD_SEQ);
 	auto body = parse_block();
@@ -995,8 +1019,8 @@ Writer<CST::CST*> Parser::parse_sequence_expression() {
 	return make_writer<CST::CST*>(expr);
 }
 
-Writer<std::pair<Token const*, CST::CST*>> Parser::parse_name_and_type(bool required_type) {
-	Writer<std::pair<Token const*, CST::CST*>> result = {{"Failed to parse name and type"}};
+Writer<std::pair<Token, CST::CST*>> Parser::parse_name_and_type(bool required_type) {
+	ErrorContext result {"Failed to parse name and type"};
 
 	auto name = require(TokenTag::IDENTIFIER);
 	CHECK_AND_RETURN(result, name);
@@ -1009,7 +1033,7 @@ Writer<std::pair<Token const*, CST::CST*>> Parser::parse_name_and_type(bool requ
 		CHECK_AND_RETURN(result, type);
 	}
 
-	return make_writer<std::pair<Token const*, CST::CST*>>(
+	return make_writer<std::pair<Token, CST::CST*>>(
 	    {name.m_result, type.m_result});
 }
 
@@ -1019,14 +1043,14 @@ Writer<std::pair<Token const*, CST::CST*>> Parser::parse_name_and_type(bool requ
  * linear time.
  */
 Writer<CST::CST*> Parser::parse_statement() {
-	Writer<CST::CST*> result = {{"Failed to parse statement"}};
+	ErrorContext result {"Failed to parse statement"};
 
-	auto* p0 = peek(0);
-	if (p0->m_type == TokenTag::IDENTIFIER) {
-		auto* p1 = peek(1);
+	auto p0 = peek(0);
+	if (p0.type() == TokenTag::IDENTIFIER) {
+		auto p1 = peek(1);
 
-		if (p1->m_type == TokenTag::DECLARE ||
-		    p1->m_type == TokenTag::DECLARE_ASSIGN) {
+		if (p1.type() == TokenTag::DECLARE ||
+		    p1.type() == TokenTag::DECLARE_ASSIGN) {
 
 			auto declaration = parse_declaration();
 			CHECK_AND_RETURN(result, declaration);
@@ -1039,23 +1063,23 @@ Writer<CST::CST*> Parser::parse_statement() {
 
 			return expression;
 		}
-	} else if (p0->m_type == TokenTag::KEYWORD_RETURN) {
+	} else if (p0.type() == TokenTag::KEYWORD_RETURN) {
 		auto return_statement = parse_return_statement();
 		CHECK_AND_RETURN(result, return_statement);
 		return return_statement;
-	} else if (p0->m_type == TokenTag::KEYWORD_IF) {
+	} else if (p0.type() == TokenTag::KEYWORD_IF) {
 		auto if_else_stmt_or_expr = parse_if_else_stmt_or_expr();
 		CHECK_AND_RETURN(result, if_else_stmt_or_expr);
 		return if_else_stmt_or_expr;
-	} else if (p0->m_type == TokenTag::KEYWORD_FOR) {
+	} else if (p0.type() == TokenTag::KEYWORD_FOR) {
 		auto for_statement = parse_for_statement();
 		CHECK_AND_RETURN(result, for_statement);
 		return for_statement;
-	} else if (p0->m_type == TokenTag::KEYWORD_WHILE) {
+	} else if (p0.type() == TokenTag::KEYWORD_WHILE) {
 		auto while_statement = parse_while_statement();
 		CHECK_AND_RETURN(result, while_statement);
 		return while_statement;
-	} else if (p0->m_type == TokenTag::BRACE_OPEN) {
+	} else if (p0.type() == TokenTag::BRACE_OPEN) {
 		auto block_statement = parse_block();
 		CHECK_AND_RETURN(result, block_statement);
 		return block_statement;
@@ -1070,7 +1094,7 @@ Writer<CST::CST*> Parser::parse_statement() {
 }
 
 Writer<std::vector<CST::CST*>> Parser::parse_type_term_arguments() {
-	Writer<std::vector<CST::CST*>> result = {{"Failed to parse type arguments"}};
+	ErrorContext result {"Failed to parse type arguments"};
 
 	REQUIRE(result, TokenTag::POLY_OPEN);
 
@@ -1087,7 +1111,7 @@ Writer<std::vector<CST::CST*>> Parser::parse_type_term_arguments() {
 }
 
 Writer<CST::CST*> Parser::parse_type_term() {
-	Writer<CST::CST*> result = {{"Failed to parse type"}};
+	ErrorContext result {"Failed to parse type"};
 
 	auto callee = parse_identifier(true);
 	CHECK_AND_RETURN(result, callee);
@@ -1100,14 +1124,13 @@ Writer<CST::CST*> Parser::parse_type_term() {
 
 	auto e = m_cst_allocator.make<CST::TypeTerm>();
 	e->m_callee = callee.m_result;
-	e->m_args = std::move(args.m_result);
+	e->m_args = m_cst_allocator.make_list(args.m_result);
 	return make_writer<CST::CST*>(e);
 }
 
 Writer<std::pair<std::vector<CST::Identifier>, std::vector<CST::CST*>>> Parser::parse_type_list(
     bool with_identifiers = false) {
-	Writer<std::pair<std::vector<CST::Identifier>, std::vector<CST::CST*>>>
-	    result = {{"Failed to parse type list"}};
+	ErrorContext result {"Failed to parse type list"};
 
 	std::vector<CST::Identifier> identifiers;
 	std::vector<CST::CST*> types;
@@ -1136,7 +1159,7 @@ Writer<std::pair<std::vector<CST::Identifier>, std::vector<CST::CST*>>> Parser::
 }
 
 Writer<CST::CST*> Parser::parse_type_var() {
-	Writer<CST::CST*> result = {{"Failed to parse type var"}};
+	ErrorContext result {"Failed to parse type var"};
 
 	REQUIRE(result, TokenTag::AT);
 
@@ -1150,15 +1173,15 @@ Writer<CST::CST*> Parser::parse_type_var() {
 }
 
 Writer<CST::CST*> Parser::parse_type_function() {
-	Writer<CST::CST*> result = {{"Failed to parse type function"}};
+	ErrorContext result {"Failed to parse type function"};
 
 	if (consume(TokenTag::KEYWORD_UNION)) {
 		auto tl = parse_type_list(true);
 		CHECK_AND_RETURN(result, tl);
 
 		auto u = m_cst_allocator.make<CST::UnionExpression>();
-		u->m_constructors = std::move(tl.m_result.first);
-		u->m_types = std::move(tl.m_result.second);
+		u->m_constructors = m_cst_allocator.make_list(tl.m_result.first);
+		u->m_types = m_cst_allocator.make_list(tl.m_result.second);
 
 		return make_writer<CST::CST*>(u);
 	} else if (consume(TokenTag::KEYWORD_TUPLE)) {
@@ -1166,7 +1189,7 @@ Writer<CST::CST*> Parser::parse_type_function() {
 		CHECK_AND_RETURN(result, tl);
 
 		auto t = m_cst_allocator.make<CST::TupleExpression>();
-		t->m_types = std::move(tl.m_result.second);
+		t->m_types = m_cst_allocator.make_list(tl.m_result.second);
 
 		return make_writer<CST::CST*>(t);
 	} else if (consume(TokenTag::KEYWORD_STRUCT)) {
@@ -1174,8 +1197,8 @@ Writer<CST::CST*> Parser::parse_type_function() {
 		CHECK_AND_RETURN(result, tl);
 
 		auto s = m_cst_allocator.make<CST::StructExpression>();
-		s->m_fields = std::move(tl.m_result.first);
-		s->m_types = std::move(tl.m_result.second);
+		s->m_fields = m_cst_allocator.make_list(tl.m_result.first);
+		s->m_types = m_cst_allocator.make_list(tl.m_result.second);
 
 		return make_writer<CST::CST*>(s);
 	}
@@ -1195,3 +1218,133 @@ Writer<CST::CST*> parse_expression(TokenArray const& ta, CST::Allocator& allocat
 	Parser p {ta, allocator};
 	return p.parse_expression();
 }
+
+// Every top-level declaration ends with a ';' that is not inside any
+// brackets, so we can split the program without parsing it.
+std::vector<int> find_top_level_boundaries(TokenArray const& ta) {
+	std::vector<int> result {0};
+	int depth = 0;
+	int const size = ta.size();
+	int i = 0;
+	for (; i < size && ta.m_tags[i] != TokenTag::END; ++i) {
+		switch (ta.m_tags[i]) {
+		case TokenTag::BRACE_OPEN:
+		case TokenTag::BRACKET_OPEN:
+		case TokenTag::PAREN_OPEN:
+			depth += 1;
+			break;
+		case TokenTag::BRACE_CLOSE:
+		case TokenTag::BRACKET_CLOSE:
+		case TokenTag::PAREN_CLOSE:
+			depth -= 1;
+			break;
+		case TokenTag::SEMICOLON:
+			if (depth == 0)
+				result.push_back(i + 1);
+			break;
+		default:
+			break;
+		}
+	}
+	if (result.back() != i)
+		result.push_back(i);
+	return result;
+}
+
+Writer<CST::CST*> parse_program(
+    TokenArray const& ta, CST::Allocator& allocator, int thread_count) {
+	std::vector<int> const starts = find_top_level_boundaries(ta);
+	int const declaration_count = int(starts.size()) - 1;
+
+	thread_count = std::min(thread_count, declaration_count);
+	if (thread_count <= 1)
+		return parse_program(ta, allocator);
+
+	struct ParsedDeclaration {
+		Writer<CST::Declaration*> m_declaration;
+		int m_end {0};
+	};
+
+	std::vector<ParsedDeclaration> parsed(declaration_count);
+	std::vector<std::unique_ptr<CST::Allocator>> allocators;
+	std::vector<std::thread> workers;
+
+	// each thread gets a contiguous run of declarations
+	for (int t = 0; t < thread_count; ++t) {
+		allocators.push_back(std::make_unique<CST::Allocator>());
+		int const first = declaration_count * t / thread_count;
+		int const last = declaration_count * (t + 1) / thread_count;
+		workers.emplace_back(
+		    [&ta, &starts, &parsed, first, last, local = allocators.back().get()] {
+			    Parser p {ta, *local};
+			    for (int i = first; i < last; ++i) {
+				    p.m_token_cursor = starts[i];
+				    parsed[i].m_declaration = p.parse_declaration();
+				    parsed[i].m_end = p.m_token_cursor;
+			    }
+		    });
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+	for (auto& local : allocators)
+		allocator.adopt(std::move(local));
+
+	// Merging in source order gives the same result as a serial parse, as
+	// long as each declaration ends where the next one starts. The scan can
+	// only get that wrong for invalid programs, and then we finish serially
+	// from the first declaration that ends somewhere else.
+	ErrorContext result {"Failed to parse program"};
+	std::vector<CST::Declaration*> declarations;
+	for (int i = 0; i < declaration_count; ++i) {
+		if (handle_error(result, parsed[i].m_declaration))
+			return result;
+
+		declarations.push_back(parsed[i].m_declaration.m_result);
+
+		if (parsed[i].m_end != starts[i + 1]) {
+			Parser p {ta, allocator};
+			p.m_token_cursor = parsed[i].m_end;
+			return p.parse_top_level(std::move(declarations));
+		}
+	}
+
+	auto e = allocator.make<CST::Program>();
+	e->m_declarations = allocator.make_list(declarations);
+	return make_writer<CST::CST*>(e);
+}
+
+Writer<CST::CST*> parse_declarations(
+    TokenArray const& ta, CST::Allocator& allocator, std::vector<TokenRun> const& runs) {
+	ErrorContext result {"Failed to parse program"};
+	Parser p {ta, allocator};
+	std::vector<CST::Declaration*> declarations;
+	for (auto run : runs) {
+		p.m_token_cursor = run.m_begin;
+		auto declaration = p.parse_declaration();
+		if (handle_error(result, declaration))
+			return result;
+
+		if (p.m_token_cursor != run.m_end) {
+			result.add_sub_error(make_located_error(
+			    "Declaration does not end at the top-level ';'", ta.at(run.m_begin)));
+			return result;
+		}
+
+		declarations.push_back(declaration.m_result);
+	}
+
+	auto e = allocator.make<CST::Program>();
+	e->m_declarations = allocator.make_list(declarations);
+	return make_writer<CST::CST*>(e);
+}
+
+Writer<CST::CST*> parse_program(Lexer& lexer, CST::Allocator& allocator) {
+	Parser p {lexer, allocator};
+	return p.parse_top_level();
+}
+
+Writer<CST::CST*> parse_expression(Lexer& lexer, CST::Allocator& allocator) {
+	Parser p {lexer, allocator};
+	return p.parse_expression();
+}
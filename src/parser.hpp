@@ -1,58 +1,103 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "error_report.hpp"
 #include "token_array.hpp"
 
+struct Lexer;
+
+// The message of an error that wraps the errors of the routines called by a
+// parser routine. Nothing is allocated unless one of them fails.
+struct ErrorContext {
+	char const* m_text;
+	std::vector<ErrorReport> m_sub_errors {};
+
+	ErrorContext(char const* text)
+	    : m_text {text} {}
+
+	void add_sub_error(ErrorReport err) {
+		m_sub_errors.push_back(std::move(err));
+	}
+
+	ErrorReport report() && {
+		return {m_text, std::move(m_sub_errors)};
+	}
+};
+
 namespace CST {
 struct CST;
 struct Allocator;
 }
 
+// The result of a parser routine. Errors are rare, so they live on the heap
+// and a successful Writer is just its result and a null pointer.
 template <typename T>
 struct Writer {
-	ErrorReport m_error {};
 	T m_result {};
+	// null on success
+	std::unique_ptr<ErrorReport> m_error {};
 
 	Writer() = default;
 
-	Writer(Writer const&) = default;
 	Writer(Writer&&) = default;
-
-	Writer& operator=(Writer const&) = default;
 	Writer& operator=(Writer&&) = default;
 
 	template <typename U>
 	Writer(Writer<U>&& o)
-	    : m_error {std::move(o.m_error)}
-	    , m_result {std::move(o.m_result)} {}
+	    : m_result {std::move(o.m_result)}
+	    , m_error {std::move(o.m_error)} {}
 
 	Writer(ErrorReport error)
-	    : m_error {std::move(error)} {}
+	    : m_error {std::make_unique<ErrorReport>(std::move(error))} {}
 
-	Writer(ErrorReport error, T result)
-	    : m_error {std::move(error)}
-	    , m_result {std::move(result)} {}
+	Writer(ErrorContext context)
+	    : Writer {std::move(context).report()} {}
 
-	void add_sub_error(ErrorReport err) {
-		m_error.m_sub_errors.push_back(std::move(err));
+	Writer(ErrorReport error, T result)
+	    : m_result {std::move(result)} {
+		if (!error.ok())
+			m_error = std::make_unique<ErrorReport>(std::move(error));
 	}
 
 	ErrorReport& error() & {
-		return m_error;
+		return *m_error;
 	}
 	[[nodiscard]] ErrorReport const& error() const& {
-		return m_error;
+		return *m_error;
 	}
 	ErrorReport&& error() && {
-		return std::move(m_error);
+		return std::move(*m_error);
 	}
 
-	bool ok() {
-		return m_error.ok();
+	[[nodiscard]] bool ok() const {
+		return !m_error;
 	}
 };
 
 Writer<CST::CST*> parse_program(TokenArray const&, CST::Allocator&);
 Writer<CST::CST*> parse_expression(TokenArray const&, CST::Allocator&);
+// parses top-level declarations on several threads. Gives the same program
+// and errors as a serial parse
+Writer<CST::CST*> parse_program(TokenArray const&, CST::Allocator&, int thread_count);
+// lex tokens as they are needed
+Writer<CST::CST*> parse_program(Lexer&, CST::Allocator&);
+
+// Returns the index of the first token of each top-level declaration,
+// followed by the index of the END token. It only looks at brackets and
+// semicolons, so it's only exact for programs that parse.
+std::vector<int> find_top_level_boundaries(TokenArray const&);
+
+// tokens [m_begin, m_end) of a token array
+struct TokenRun {
+	int m_begin;
+	int m_end;
+};
+
+// parses one top-level declaration from each run, and puts them together in
+// a program. Fails if a declaration doesn't take up its whole run
+Writer<CST::CST*> parse_declarations(
+    TokenArray const&, CST::Allocator&, std::vector<TokenRun> const&);
+Writer<CST::CST*> parse_expression(Lexer&, CST::Allocator&);
@@ -1,6 +1,4 @@
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
 
 #include "../ast.hpp"
@@ -8,6 +6,7 @@
 #include "../cst_allocator.hpp"
 #include "../lexer.hpp"
 #include "../parser.hpp"
+#include "../source_file.hpp"
 #include "../token_array.hpp"
 
 int main(int argc, char** argv) {
@@ -17,29 +16,20 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 
-	std::ifstream in_fs(argv[1]);
-	if (!in_fs.good()) {
+	SourceFile source;
+	if (!source.load(argv[1])) {
 		std::cout << "Failed to open '" << argv[1] << "'" << std::endl;
 		return 1;
 	}
 
-	std::stringstream file_content;
-	std::string line;
-
-	while (std::getline(in_fs, line)) {
-		file_content << line << '\n';
-	}
-
-	std::string source = file_content.str();
-
 	{
-		TokenArray const ta = tokenize(source.c_str());
+		Lexer lexer {source.data()};
 
 		CST::Allocator cst_allocator;
-		auto parse_result = parse_program(ta, cst_allocator);
+		auto parse_result = parse_program(lexer, cst_allocator);
 
 		if (not parse_result.ok()) {
-			parse_result.m_error.print();
+			parse_result.error().print(LineIndex {source.data()});
 			return 1;
 		}
 
@@ -0,0 +1,98 @@
+#include "source_file.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(std::string contents)
+    : m_buffer {std::move(contents)}
+    , m_data {m_buffer.c_str()}
+    , m_size {m_buffer.size()} {}
+
+SourceFile::~SourceFile() {
+	release();
+}
+
+void SourceFile::release() {
+	if (m_mapping)
+		munmap(m_mapping, m_mapping_size);
+	m_mapping = nullptr;
+	m_mapping_size = 0;
+	m_buffer.clear();
+	m_data = "";
+	m_size = 0;
+}
+
+bool SourceFile::load(char const* path) {
+	release();
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat info {};
+	bool ok = fstat(fd, &info) == 0;
+	if (ok) {
+		bool mapped = S_ISREG(info.st_mode) && info.st_size > 0 && map(fd, info.st_size);
+		ok = mapped || read_all(fd);
+	}
+
+	close(fd);
+	return ok;
+}
+
+bool SourceFile::map(int fd, size_t size) {
+	// The lexer needs a NUL byte after the contents. Bytes past the end of
+	// the file in its last page read as zero, but if the file fills that page
+	// exactly there would be nothing mapped after it. So we reserve at least
+	// one extra byte of anonymous (zeroed) memory, and map the file over the
+	// start of it.
+	size_t const page_size = sysconf(_SC_PAGESIZE);
+	size_t const reserved = (size / page_size + 1) * page_size;
+
+	void* base = mmap(nullptr, reserved, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return false;
+
+	if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(base, reserved);
+		return false;
+	}
+
+	madvise(base, size, MADV_SEQUENTIAL);
+
+	m_mapping = base;
+	m_mapping_size = reserved;
+	m_data = static_cast<char const*>(base);
+	m_size = size;
+	return true;
+}
+
+bool SourceFile::read_all(int fd) {
+	constexpr size_t chunk_size = 1 << 16;
+
+	while (true) {
+		size_t const old_size = m_buffer.size();
+		m_buffer.resize(old_size + chunk_size);
+		ssize_t read_bytes = read(fd, m_buffer.data() + old_size, chunk_size);
+		if (read_bytes < 0 && errno == EINTR) {
+			m_buffer.resize(old_size);
+			continue;
+		}
+		if (read_bytes < 0) {
+			m_buffer.clear();
+			return false;
+		}
+
+		m_buffer.resize(old_size + read_bytes);
+		if (read_bytes == 0)
+			break;
+	}
+
+	m_data = m_buffer.c_str();
+	m_size = m_buffer.size();
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include "utils/string_view.hpp"
+
+// The contents of a source file, followed by a NUL byte. Regular files are
+// mapped into memory instead of being copied, and anything that can't be
+// mapped (pipes, terminals) is read into a buffer. The contents stay valid
+// for as long as the SourceFile lives, so tokens and error reports can keep
+// referring to them.
+struct SourceFile {
+	SourceFile() = default;
+	// takes the contents from memory, for sources that don't come from a file
+	explicit SourceFile(std::string contents);
+	~SourceFile();
+
+	SourceFile(SourceFile const&) = delete;
+	SourceFile& operator=(SourceFile const&) = delete;
+
+	// returns false if the file can't be opened or read
+	bool load(char const* path);
+
+	[[nodiscard]] char const* data() const {
+		return m_data;
+	}
+
+	[[nodiscard]] size_t size() const {
+		return m_size;
+	}
+
+	[[nodiscard]] string_view view() const {
+		return {m_data, m_size};
+	}
+
+private:
+	bool map(int fd, size_t size);
+	bool read_all(int fd);
+	void release();
+
+	void* m_mapping {nullptr};
+	size_t m_mapping_size {0};
+	// used when the file can't be mapped
+	std::string m_buffer {};
+	char const* m_data {""};
+	size_t m_size {0};
+};
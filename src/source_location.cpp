@@ -1 +1,23 @@
 #include "source_location.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "utils/char_scan.hpp"
+
+LineIndex::LineIndex(char const* source) {
+	m_line_starts.push_back(0);
+
+	char const* p = source;
+	while (*(p = CharScan::find_line_end(p)) == '\n') {
+		p += 1;
+		m_line_starts.push_back(p - source);
+	}
+}
+
+SourceLocation LineIndex::locate(int offset) const {
+	assert(!m_line_starts.empty());
+	auto it = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset);
+	int line = (it - m_line_starts.begin()) - 1;
+	return {line, offset - m_line_starts[line]};
+}
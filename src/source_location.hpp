@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 struct SourceLocation {
 	int line, col;
@@ -10,7 +11,20 @@ struct SourceLocation {
 	}
 };
 
+// byte offsets into the source buffer
 struct SourceRange {
-	SourceLocation start;
-	SourceLocation end;
+	int start;
+	int end;
+};
+
+// Offsets at which each line of a source buffer starts. Building it takes a
+// single pass over the buffer, so it's only done when something actually
+// needs to show a line and column (error reports, the profiler).
+struct LineIndex {
+	std::vector<int> m_line_starts;
+
+	LineIndex() = default;
+	explicit LineIndex(char const* source);
+
+	[[nodiscard]] SourceLocation locate(int offset) const;
 };
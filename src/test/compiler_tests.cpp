@@ -0,0 +1,172 @@
+#include "compiler_tests.hpp"
+
+#include <memory>
+#include <string>
+
+#include "../ast.hpp"
+#include "../ast_allocator.hpp"
+#include "../compiler/compile.hpp"
+#include "../compiler/compiler.hpp"
+#include "../compiler/garbage_collector.hpp"
+#include "../compiler/native.hpp"
+#include "../compiler/type_lowering.hpp"
+#include "../compute_offsets.hpp"
+#include "../cst_allocator.hpp"
+#include "../ct_eval.hpp"
+#include "../lexer.hpp"
+#include "../match_identifiers.hpp"
+#include "../metacheck.hpp"
+#include "../parser.hpp"
+#include "../symbol_table.hpp"
+#include "../token_array.hpp"
+#include "../typecheck.hpp"
+#include "../typechecker.hpp"
+#include "tester.hpp"
+
+// A program that went through the frontend, ready to be compiled
+struct CheckedProgram {
+	AST::Allocator m_allocator {};
+	TypeChecker::TypeChecker m_tc {m_allocator};
+	Frontend::SymbolTable m_context {};
+	AST::AST* m_ast {nullptr};
+
+	AST::Declaration* find(char const* name) {
+		for (auto& decl : static_cast<AST::Program*>(m_ast)->m_declarations)
+			if (decl.identifier_text().str() == name)
+				return &decl;
+		return nullptr;
+	}
+};
+
+static bool check(char const* source, CheckedProgram& program) {
+	Lexer lexer {source};
+	{
+		CST::Allocator cst_allocator;
+		auto parse_result = parse_program(lexer, cst_allocator);
+		if (!parse_result.ok())
+			return false;
+		program.m_ast = AST::convert_ast(parse_result.m_result, program.m_allocator);
+	}
+
+	auto& tc = program.m_tc;
+	tc.m_builtin_declarations.for_each([&](AST::Declaration& decl) {
+		program.m_context.declare(&decl);
+	});
+	if (!Frontend::match_identifiers(program.m_ast, program.m_context, program.m_allocator).ok())
+		return false;
+
+	tc.m_env.compute_declaration_order(static_cast<AST::Program*>(program.m_ast));
+	tc.m_core.m_meta_core.comp = &tc.m_env.declaration_components;
+	TypeChecker::metacheck(tc.m_core.m_meta_core, program.m_ast);
+	TypeChecker::reify_types(program.m_ast, tc, program.m_allocator);
+	TypeChecker::typecheck(program.m_ast, tc);
+	TypeChecker::compute_offsets(program.m_ast, 0);
+	return true;
+}
+
+void compiler_tests(Test::Tester& tests) {
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    CheckedProgram program;
+		    if (!check(
+		            "id := fn(x) => x;\n"
+		            "__invoke := fn() => id(1);\n",
+		            program))
+			    return {TestStatus::Fail, "The program did not go through the frontend"};
+		    auto& tc = program.m_tc;
+
+		    Compiler::GC gc;
+		    Compiler::Compiler env = {&tc, &gc, &tc.m_env.declaration_components};
+		    Compiler::declare_native_functions(env);
+		    Compiler::compile(program.m_ast, env);
+
+		    // run the program the way the driver does
+		    TokenArray const ta = tokenize("__invoke()");
+		    CST::Allocator cst_allocator;
+		    auto call = parse_expression(ta, cst_allocator);
+		    AST::Allocator call_allocator;
+		    Compiler::compile(AST::convert_ast(call.m_result, call_allocator), env);
+
+		    llvm::Function* specialised = nullptr;
+		    for (auto& entry : env.m_specialisations)
+			    for (auto& spec : entry.second)
+				    if (spec.m_function)
+					    specialised = spec.m_function;
+
+		    if (!specialised)
+			    return {TestStatus::Fail, "id was not specialised"};
+
+		    for (auto user : specialised->users())
+			    if (auto call_inst = llvm::dyn_cast<llvm::CallInst>(user))
+				    if (call_inst->getCalledFunction() == specialised)
+					    return {TestStatus::Ok};
+
+		    return {TestStatus::Fail, "the call to id does not use its specialisation"};
+	    }}));
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    CheckedProgram program;
+		    if (!check(
+		            "pair := struct { first : int<::>; second : float<::>; };\n"
+		            "shape := union { circle : int<::>; square : pair<::>; }<::>;\n"
+		            "make_pair := fn() => pair<::> { 4; 5.0 };\n"
+		            "make_shape := fn() => shape.circle { 2 };\n"
+		            "flag := fn() => true;\n",
+		            program))
+			    return {TestStatus::Fail, "The program did not go through the frontend"};
+		    auto& tc = program.m_tc;
+
+		    Compiler::GC gc;
+		    Compiler::Compiler env = {&tc, &gc, &tc.m_env.declaration_components};
+		    Compiler::declare_native_functions(env);
+		    Compiler::compile(program.m_ast, env);
+
+		    auto return_type = [&](char const* name) {
+			    auto function = static_cast<AST::FunctionLiteral*>(program.find(name)->m_value);
+			    return function->m_return_type;
+		    };
+
+		    auto& context = env.m_context;
+		    if (Compiler::llvm_from_type(tc.mono_int(), env) != llvm::Type::getInt32Ty(context) ||
+		        Compiler::llvm_from_type(tc.mono_float(), env) != llvm::Type::getFloatTy(context) ||
+		        Compiler::llvm_from_type(return_type("flag"), env) != llvm::Type::getInt1Ty(context))
+			    return {TestStatus::Fail, "A scalar type was not lowered to its LLVM type"};
+
+		    // the fields of a record are laid out in declaration order
+		    MonoId const pair = return_type("make_pair");
+		    auto pair_type = llvm::dyn_cast<llvm::StructType>(Compiler::llvm_from_type(pair, env));
+		    if (!pair_type || pair_type->isLiteral())
+			    return {TestStatus::Fail, "A record was not lowered to a named struct"};
+
+		    auto& core = tc.m_core;
+		    auto const& pair_data = core.m_type_functions[core.m_tf_core.find_function(
+		        core.m_mono_core.find_function(pair))];
+		    if (pair_data.fields.size() != 2 || pair_type->getNumElements() != 2 ||
+		        pair_data.fields[0] != "first" || pair_data.fields[1] != "second" ||
+		        pair_type->getElementType(0) != llvm::Type::getInt32Ty(context) ||
+		        pair_type->getElementType(1) != llvm::Type::getFloatTy(context))
+			    return {TestStatus::Fail, "The fields of a record are not in order"};
+
+		    // a variant is a tag and a payload that fits any of its constructors
+		    MonoId const shape = return_type("make_shape");
+		    auto shape_type = llvm::dyn_cast<llvm::StructType>(Compiler::llvm_from_type(shape, env));
+		    if (!shape_type || shape_type->getNumElements() != 2 ||
+		        shape_type->getElementType(0) != llvm::Type::getInt32Ty(context))
+			    return {TestStatus::Fail, "A variant was not lowered to a tagged union"};
+
+		    auto payload = llvm::dyn_cast<llvm::ArrayType>(shape_type->getElementType(1));
+		    if (!payload || payload->getElementType() != llvm::Type::getInt64Ty(context))
+			    return {TestStatus::Fail, "The payload of a variant is not made of i64"};
+
+		    auto const& shape_data = core.m_type_functions[core.m_tf_core.find_function(
+		        core.m_mono_core.find_function(shape))];
+		    auto const& layout = env.m_module->getDataLayout();
+		    for (auto const& constructor : shape_data.structure) {
+			    auto type = Compiler::llvm_storage_type(constructor.second, env);
+			    if (layout.getTypeAllocSize(type).getFixedSize() > 8 * payload->getNumElements())
+				    return {TestStatus::Fail, "The payload of a variant is too small"};
+		    }
+
+		    return {TestStatus::Ok};
+	    }}));
+}
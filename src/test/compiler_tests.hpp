@@ -0,0 +1,9 @@
+#pragma once
+
+namespace Test {
+struct Tester;
+}
+
+// The compiler has its own value and exit status types, which can't be in the
+// same translation unit as the interpreter's, so its tests live apart
+void compiler_tests(Test::Tester&);
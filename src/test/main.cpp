@@ -1,10 +1,41 @@
 #include <cassert>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "../algorithms/tarjan_solver.hpp"
+#include "../ast_allocator.hpp"
+#include "../ast_cache.hpp"
+#include "../compiler/module_cache.hpp"
+#include "../cst.hpp"
+#include "../cst_allocator.hpp"
+#include "../interpreter/daemon.hpp"
 #include "../interpreter/execute.hpp"
+#include "../interpreter/interpreter.hpp"
+#include "../interpreter/session.hpp"
+#include "../interpreter/tiering.hpp"
+#include "../lexer.hpp"
+#include "../parser.hpp"
+#include "../source_file.hpp"
+#include "../source_location.hpp"
+#include "../token.hpp"
+#include "../typechecker.hpp"
+#include "../utils/arena_vector.hpp"
+#include "../utils/char_scan.hpp"
+#include "../utils/flat_map.hpp"
+#include "../utils/paged_array.hpp"
 #include "../utils/string_set.hpp"
+#include "compiler_tests.hpp"
 #include "test_status_tag.hpp"
 #include "test_utils.hpp"
 #include "tester.hpp"
@@ -39,6 +70,18 @@
 		return Assert::array_of_size(eval_expression(expr, env, context), size); \
 	}
 
+// Like EQUALS, but also checks that the JIT compiled something on the way
+#define COMPILED_EQUALS(expr, value)                                           \
+	+[](Interpreter::Interpreter& env,                                         \
+	    Frontend::SymbolTable& context) -> ExitStatus {                        \
+		auto result = Assert::equals(eval_expression(expr, env, context), value); \
+		if (result != ExitStatus::Ok)                                          \
+			return result;                                                     \
+		if (!env.m_tiering || env.m_tiering->compiled_count() == 0)            \
+			return ExitStatus::ValueError;                                     \
+		return ExitStatus::Ok;                                                 \
+	}
+
 void interpreter_tests(Test::Tester& tests) {
 	    using TestCase = Test::InterpreterTestSet;
 	    using Testers = std::vector<Test::Interpret>;
@@ -146,6 +189,350 @@ void interpreter_tests(Test::Tester& tests) {
 	            EQUALS("issue240_2", 8)}));
 }
 
+void tiering_tests(Test::Tester& tests) {
+	using Testers = std::vector<Test::Interpret>;
+
+	auto tiered = [](std::string file, Testers testers) {
+		auto result = std::make_unique<Test::InterpreterTestSet>(
+		    std::move(file), std::move(testers));
+		result->m_tiering = true;
+		return result;
+	};
+
+	tests.add_test(tiered(
+	    "tests/recursion.jp",
+	    Testers {
+	        COMPILED_EQUALS("fib(6)", 8),
+	        COMPILED_EQUALS("fib(20)", 6765),
+	        IS_FALSE("even(11)"),
+	        IS_TRUE("odd(15)"),
+	        EQUALS("inner()", 2)}));
+
+	tests.add_test(tiered(
+	    "tests/loops.jp",
+	    Testers {EQUALS("for_loop()", 120), EQUALS("while_loop()", 120)}));
+
+	tests.add_test(tiered(
+	    "tests/function.jp",
+	    Testers {
+	        EQUALS("normal()", 3),
+	        EQUALS("curry()", 42),
+	        EQUALS("I(42)", 42),
+	        EQUALS("median_of_three(10,15,7)", 10),
+	        EQUALS("second(7,15)", 15)}));
+}
+
+void session_tests(Test::Tester& tests) {
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    Interpreter::Session session {Interpreter::ExecuteSettings {}};
+
+		    auto run = [&](std::string text, Interpreter::Runner* runner) {
+			    SourceFile source {std::move(text)};
+			    return session.execute(source, runner);
+		    };
+
+		    std::string const first =
+		        "fn twice(x) => x + x;\n"
+		        "fn quad(x) => twice(twice(x));\n"
+		        "other := fn() => 1;\n"
+		        "one := other();\n";
+		    if (run(first, EQUALS("quad(2)", 8)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The first version did not run"};
+		    if (session.m_checked_count != 4)
+			    return {TestStatus::Fail, "Not every declaration was checked on the first run"};
+
+		    // 'quad' depends on 'twice'. 'one' has a ground type, so it's kept
+		    std::string const second =
+		        "fn twice(x) => x * 3;\n"
+		        "fn quad(x) => twice(twice(x));\n"
+		        "other := fn() => 1;\n"
+		        "one := other();\n";
+		    if (run(second, EQUALS("quad(2)", 18)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The edited version did not run"};
+		    if (session.m_checked_count != 2)
+			    return {TestStatus::Fail, "Checked declarations that did not need it"};
+
+		    if (run("fn twice(x) => ;", EQUALS("1", 1)) != ExitStatus::ParseError)
+			    return {TestStatus::Fail, "A parse error was not reported"};
+
+		    // moving declarations around doesn't change them
+		    std::string const third =
+		        "other := fn() => 1;\n\n"
+		        "fn quad(x) => twice(twice(x));\n"
+		        "   fn twice(x) => x * 3;\n"
+		        "one := other();\n";
+		    if (run(third, EQUALS("quad(1) + one", 10)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "Reordered version did not run"};
+		    if (session.m_checked_count != 0)
+			    return {TestStatus::Fail, "Reordering declarations checked them again"};
+
+		    // a value of ground type and a function using it are kept
+		    // through an unrelated edit
+		    std::string const fourth = third +
+		        "base := 5;\n"
+		        "with_base := fn(x) => x + base;\n";
+		    if (run(fourth, EQUALS("with_base(1) + one", 7)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The version with a ground value did not run"};
+		    if (session.m_checked_count != 2)
+			    return {TestStatus::Fail, "Added declarations were not checked"};
+
+		    std::string const fifth =
+		        "other := fn() => 2;\n\n"
+		        "fn quad(x) => twice(twice(x));\n"
+		        "   fn twice(x) => x * 3;\n"
+		        "one := other();\n"
+		        "base := 5;\n"
+		        "with_base := fn(x) => x + base;\n";
+		    if (run(fifth, EQUALS("with_base(1) + one", 8)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The version after an unrelated edit did not run"};
+		    if (session.m_checked_count != 2)
+			    return {TestStatus::Fail, "A ground value or its user was checked again"};
+
+		    // editing over and over starts over once in a while, instead of
+		    // piling up old versions
+		    for (int i = 0; i < 100; ++i) {
+			    std::string const edited =
+			        "other := fn() => " + std::to_string(i) + ";\n"
+			        "fn quad(x) => twice(twice(x));\n"
+			        "fn twice(x) => x * 3;\n"
+			        "one := other();\n";
+			    if (run(edited, EQUALS("quad(1)", 9)) != ExitStatus::Ok)
+				    return {TestStatus::Fail, "An edited version did not run"};
+		    }
+		    if (session.m_compaction_count == 0 ||
+		        session.m_dead_count > 2 * Interpreter::Session::compaction_minimum)
+			    return {TestStatus::Fail, "Replaced declarations were never freed"};
+		    if (run(third, EQUALS("quad(1) + one", 10)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The session broke after starting over"};
+
+		    return {TestStatus::Ok};
+	    }}));
+}
+
+void ast_cache_tests(Test::Tester& tests) {
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    auto cache_path = std::filesystem::temp_directory_path() /
+		                      ("jasper_test_" + std::to_string(getpid()) + ".jast");
+
+		    SourceFile source {
+		        "shape := union { circle : int<::>; square : int<::>; }<::>;\n"
+		        "pair := struct { first : int<::>; second : int<::>; };\n"
+		        "fn area(s) => match(s) {\n"
+		        "    circle { r } => 3 * r * r;\n"
+		        "    square { l } => l * l;\n"
+		        "};\n"
+		        "fn id(x) => x;\n"
+		        "adder := fn(a) => fn(b) => a + b;\n"
+		        "sum := fn(p) => p.first + p.second;\n"
+		        "circle_area := fn() => area(shape.circle { 2 });\n"
+		        "pair_sum := fn() => sum(pair<::> { 4; 5 });\n"
+		        "__invoke := fn() => area(shape.square { id(3) }) + adder(1)(2);\n"};
+
+		    Interpreter::ExecuteSettings settings;
+		    settings.ast_cache_output = cache_path.string();
+		    if (Interpreter::execute(source, settings, EQUALS("__invoke()", 12)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The program did not run from source"};
+
+		    SourceFile image;
+		    if (!image.load(cache_path.c_str()))
+			    return {TestStatus::Fail, "The cache was not written"};
+		    std::filesystem::remove(cache_path);
+
+		    if (!AST::is_cache_for(image.view(), source.view()))
+			    return {TestStatus::Fail, "The cache does not match its source"};
+		    SourceFile edited {"__invoke := fn() => 0;\n"};
+		    if (AST::is_cache_for(image.view(), edited.view()))
+			    return {TestStatus::Fail, "The cache matches a different source"};
+
+		    auto run = [&](Interpreter::Runner* runner) {
+			    return Interpreter::execute_cache(image, {}, runner);
+		    };
+		    if (run(EQUALS("__invoke()", 12)) != ExitStatus::Ok ||
+		        run(EQUALS("circle_area()", 12)) != ExitStatus::Ok ||
+		        run(EQUALS("pair_sum()", 9)) != ExitStatus::Ok ||
+		        run(EQUALS("id(id)(7)", 7)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The cached program did not run"};
+
+		    SourceFile truncated {std::string(image.data(), image.size() / 2)};
+		    if (Interpreter::execute_cache(truncated, {}, EQUALS("1", 1)) == ExitStatus::Ok)
+			    return {TestStatus::Fail, "A truncated cache was loaded"};
+
+		    // the reader has to survive damaged images. Every byte past the
+		    // header is flipped in turn
+		    std::string damaged {image.data(), size_t(image.size())};
+		    for (size_t i = 24; i < damaged.size(); ++i) {
+			    damaged[i] = ~damaged[i];
+			    AST::Allocator allocator;
+			    TypeChecker::TypeChecker tc {allocator};
+			    std::vector<std::vector<AST::Declaration*>> order;
+			    AST::read_cache({damaged.data(), damaged.size()}, allocator, tc, order);
+			    damaged[i] = ~damaged[i];
+		    }
+
+		    return {TestStatus::Ok};
+	    }}));
+}
+
+void profiler_tests(Test::Tester& tests) {
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    auto profile_path = std::filesystem::temp_directory_path() /
+		                        ("jasper_test_" + std::to_string(getpid()) + ".folded");
+
+		    SourceFile source {
+		        "make := fn(n) {\n"
+		        "\ti := 0;\n"
+		        "\twhile (i < n) {\n"
+		        "\t\ta := array { i; i; i; };\n"
+		        "\t\ti = i + 1;\n"
+		        "\t}\n"
+		        "\treturn i;\n"
+		        "};\n"
+		        "\n"
+		        "__invoke := fn() {\n"
+		        "\tx := make(2000);\n"
+		        "\treturn x;\n"
+		        "};\n"};
+
+		    Interpreter::ExecuteSettings settings;
+		    settings.profile_output = profile_path.string();
+		    if (Interpreter::execute(source, settings, EQUALS("__invoke()", 2000)) != ExitStatus::Ok)
+			    return {TestStatus::Fail, "The profiled program did not run"};
+
+		    // reads `stack count` lines, and checks that every frame past
+		    // the root is `name:line`
+		    auto read = [](std::string const& path, std::vector<std::pair<std::string, long>>& out) {
+			    std::ifstream in {path};
+			    if (!in.good())
+				    return false;
+			    for (std::string line; std::getline(in, line);) {
+				    auto space = line.rfind(' ');
+				    if (space == std::string::npos)
+					    return false;
+				    std::string stack = line.substr(0, space);
+				    if (stack.rfind("<toplevel>", 0) != 0)
+					    return false;
+				    for (size_t frame = stack.find(';'); frame != std::string::npos;
+				         frame = stack.find(';', frame + 1)) {
+					    auto end = stack.find(';', frame + 1);
+					    auto name = stack.substr(frame + 1, end == std::string::npos ? end : end - frame - 1);
+					    auto colon = name.rfind(':');
+					    if (colon == std::string::npos || colon + 1 == name.size() ||
+					        name.find_first_not_of("0123456789", colon + 1) != std::string::npos)
+						    return false;
+				    }
+				    out.push_back({stack, std::stol(line.substr(space + 1))});
+			    }
+			    return true;
+		    };
+
+		    std::vector<std::pair<std::string, long>> times;
+		    std::vector<std::pair<std::string, long>> allocations;
+		    bool const read_times = read(profile_path.string(), times);
+		    bool const read_allocations = read(profile_path.string() + ".allocs", allocations);
+		    std::filesystem::remove(profile_path);
+		    std::filesystem::remove(profile_path.string() + ".allocs");
+		    if (!read_times || !read_allocations)
+			    return {TestStatus::Fail, "The profile is not in the folded stacks format"};
+
+		    bool nested = false;
+		    for (auto const& [stack, count] : times)
+			    nested = nested || stack.rfind("<toplevel>;__invoke:11;make:", 0) == 0;
+		    if (!nested)
+			    return {TestStatus::Fail, "make is not profiled under its caller"};
+
+		    long loop_allocations = 0;
+		    for (auto const& [stack, count] : allocations)
+			    if (stack == "<toplevel>;__invoke:11;make:4")
+				    loop_allocations = count;
+		    if (loop_allocations < 2000)
+			    return {TestStatus::Fail, "The arrays made in make are not counted"};
+
+		    return {TestStatus::Ok};
+	    }}));
+}
+
+void daemon_tests(Test::Tester& tests) {
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    auto const directory = std::filesystem::temp_directory_path();
+		    auto const prefix = "jasper_test_" + std::to_string(getpid());
+		    auto const socket_path = directory / (prefix + ".sock");
+		    auto const looping = directory / (prefix + "_loop.jp");
+		    auto const mistyped = directory / (prefix + "_type_error.jp");
+		    std::filesystem::remove(socket_path);
+
+		    std::ofstream(looping)
+		        << "__invoke := fn() {\n"
+		           "\ti := 0;\n"
+		           "\twhile (i < 1) { i = i * 1; }\n"
+		           "\treturn i;\n"
+		           "};\n";
+		    std::ofstream(mistyped) << "__invoke := fn() => 1 + \"a\";\n";
+
+		    Interpreter::DaemonLimits limits;
+		    limits.read_timeout_ms = 200;
+		    limits.request_timeout_ms = 1000;
+
+		    pid_t daemon = fork();
+		    if (daemon == 0)
+			    _exit(Interpreter::serve(socket_path.c_str(), {}, limits));
+
+		    for (int i = 0; i < 200 && !std::filesystem::exists(socket_path); ++i)
+			    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		    auto request = [&](std::string const& text, std::string& output) {
+			    return Interpreter::send_request(socket_path.c_str(), text, output);
+		    };
+
+		    auto const program = std::filesystem::absolute("tests/function.jp").string();
+		    std::string run_output, eval_output, bad_output, loop_output, type_output,
+		        idle_output, late_output;
+		    int const run_status = request("run " + program, run_output);
+		    int const eval_status = request("eval I(42)", eval_output);
+		    int const bad_status = request("run /nonexistent", bad_output);
+		    int const type_status = request("run " + mistyped.string(), type_output);
+
+		    // a client that never sends its request doesn't hold up the next
+		    int idle = socket(AF_UNIX, SOCK_STREAM, 0);
+		    sockaddr_un address {};
+		    address.sun_family = AF_UNIX;
+		    strcpy(address.sun_path, socket_path.c_str());
+		    connect(idle, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+		    int const idle_status = request("eval I(7)", idle_output);
+		    close(idle);
+
+		    int const loop_status = request("run " + looping.string(), loop_output);
+		    request("run " + program, late_output);
+		    int const late_status = request("eval I(42)", late_output);
+
+		    kill(daemon, SIGTERM);
+		    waitpid(daemon, nullptr, 0);
+		    std::filesystem::remove(socket_path);
+		    std::filesystem::remove(looping);
+		    std::filesystem::remove(mistyped);
+
+		    if (run_status != 0 || run_output.find("Integer 0") == std::string::npos)
+			    return {TestStatus::Fail, "The daemon failed to run a program"};
+		    if (eval_status != 0 || eval_output.find("Integer 42") == std::string::npos)
+			    return {TestStatus::Fail, "The daemon failed to evaluate an expression"};
+		    if (bad_status == 0 || bad_output.find("Failed to open") == std::string::npos)
+			    return {TestStatus::Fail, "The daemon ran a file that doesn't exist"};
+		    if (type_status == 0)
+			    return {TestStatus::Fail, "The daemon ran a program with a type error"};
+		    if (idle_status != 0 || idle_output.find("Integer 7") == std::string::npos)
+			    return {TestStatus::Fail, "An idle client held up the daemon"};
+		    if (loop_status == 0 || loop_output.find("Timed out") == std::string::npos)
+			    return {TestStatus::Fail, "A program that doesn't stop was not killed"};
+		    if (late_status != 0 || late_output.find("Integer 42") == std::string::npos)
+			    return {TestStatus::Fail, "The daemon stopped working after a timeout"};
+
+		    return {TestStatus::Ok};
+	    }}));
+}
+
 void tarjan_algorithm_tests(Test::Tester& tester) {
 	tester.add_test(std::make_unique<Test::NormalTestSet>(
 	    std::vector<Test::NormalTestSet::TestFunction> {
@@ -183,8 +570,119 @@ void tarjan_algorithm_tests(Test::Tester& tester) {
 	        }}));
 }
 
+void type_system_tests(Test::Tester& tests) {
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {
+	        +[]() -> TestReport {
+		        AST::Allocator allocator;
+		        TypeChecker::TypeChecker tc {allocator};
+		        auto& core = tc.m_core;
+		        using TypeChecker::BuiltinType;
+
+		        MonoId builtins[] = {tc.mono_int(), tc.mono_float(), tc.mono_string(), tc.mono_boolean(), tc.mono_unit()};
+		        for (MonoId a : builtins)
+			        for (MonoId b : builtins)
+				        if (a != b && core.m_mono_core.find_function(a) == core.m_mono_core.find_function(b))
+					        return {TestStatus::Fail, "Builtin monotypes should have different type functions"};
+
+		        MonoId ints = core.new_term(BuiltinType::Array, {tc.mono_int()});
+		        if (core.new_term(BuiltinType::Array, {tc.mono_int()}) != ints)
+			        return {TestStatus::Fail, "Equal ground monotypes should share a node"};
+		        if (core.new_term(BuiltinType::Array, {tc.mono_float()}) == ints)
+			        return {TestStatus::Fail, "Different ground monotypes should not share a node"};
+
+		        MonoId var = core.m_mono_core.new_var();
+		        MonoId vars = core.new_term(BuiltinType::Array, {var});
+		        if (core.new_term(BuiltinType::Array, {var}) == vars)
+			        return {TestStatus::Fail, "Monotypes with variables should not be shared"};
+
+		        // once the variable is bound, new terms made from it are shared
+		        core.m_mono_core.unify(var, tc.mono_int());
+		        if (core.new_term(BuiltinType::Array, {var}) != ints)
+			        return {TestStatus::Fail, "Arguments should be looked up by their representative"};
+
+		        MonoId f = core.new_term(BuiltinType::Function, {ints, tc.mono_int()});
+		        if (core.inst_impl(f, {}) != f)
+			        return {TestStatus::Fail, "Instancing a ground monotype should give it back"};
+
+		        return {TestStatus::Ok};
+	        }}));
+}
+
 void allocator_tests(Test::Tester& tests) {
-	// TODO
+	tests.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {
+	        +[]() -> TestReport {
+		        // nodes of each kind go to their own pool, and never move
+		        CST::Allocator allocator;
+		        std::vector<CST::Identifier*> identifiers;
+		        std::vector<CST::CallExpression*> calls;
+		        for (int i = 0; i < 5000; ++i) {
+			        identifiers.push_back(allocator.make<CST::Identifier>());
+			        calls.push_back(allocator.make<CST::CallExpression>());
+			        calls.back()->m_callee = identifiers.back();
+		        }
+
+		        for (int i = 0; i < 5000; ++i) {
+			        if (identifiers[i]->type() != CSTTag::Identifier ||
+			            calls[i]->type() != CSTTag::CallExpression ||
+			            calls[i]->m_callee != identifiers[i])
+				        return {TestStatus::Fail, "A node changed after allocating more"};
+		        }
+
+		        if (identifiers[1] != identifiers[0] + 1)
+			        return {TestStatus::Fail, "Nodes of the same kind are not stored together"};
+
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        CST::Allocator allocator;
+		        std::vector<CST::CST*> small {nullptr, nullptr, nullptr};
+		        std::vector<CST::DeclarationData> large(ListArena::page_size / sizeof(CST::DeclarationData) + 1);
+		        large.back().m_type_hint = allocator.make<CST::TypeVar>();
+
+		        auto a = allocator.make_list(small);
+		        auto b = allocator.make_list(large);
+		        auto c = allocator.make_list(std::vector<CST::CST*> {});
+
+		        if (a.size() != 3 || b.size() != int(large.size()) || !c.empty())
+			        return {TestStatus::Fail, "Lists have the wrong sizes"};
+		        if (b[b.size() - 1].m_type_hint != large.back().m_type_hint)
+			        return {TestStatus::Fail, "A list larger than a page lost its contents"};
+		        if (reinterpret_cast<uintptr_t>(b.begin()) % alignof(CST::DeclarationData) != 0)
+			        return {TestStatus::Fail, "A list is not aligned"};
+
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        // growable lists and maps keep their contents as they move
+		        // to bigger buffers in the arena
+		        ListArena arena;
+		        ArenaVector<int> numbers;
+		        FlatMap<int, int> squares;
+		        for (int i = 0; i < 100; ++i) {
+			        numbers.insert(i, arena);
+			        numbers.insert(i / 2, arena);
+			        squares.insert({i, i * i}, arena);
+			        squares.insert({i, -1}, arena);
+		        }
+
+		        if (numbers.size() != 100 || squares.size() != 100)
+			        return {TestStatus::Fail, "Repeated elements were inserted"};
+
+		        for (int i = 0; i < 100; ++i) {
+			        if (numbers[i] != i)
+				        return {TestStatus::Fail, "A list lost an element while growing"};
+			        auto square = squares.find(i);
+			        if (square == squares.end() || square->second != i * i)
+				        return {TestStatus::Fail, "A map lost an entry while growing"};
+		        }
+
+		        if (squares.find(100) != squares.end())
+			        return {TestStatus::Fail, "Found a key that was never inserted"};
+
+		        return {TestStatus::Ok};
+	        }}));
 }
 
 void string_set_tests(Test::Tester& tester) {
@@ -204,16 +702,431 @@ void string_set_tests(Test::Tester& tester) {
 		    if (!s.includes("BBB"))
 			    return {TestStatus::Fail, "BBB is not in the set after inserting it"};
 
+		    return {TestStatus::Ok};
+	    },
+	    +[]() -> TestReport {
+		    // strings live in arena pages and must not move as the set grows
+		    StringSet s;
+		    std::string big(StringSet::page_size + 10, 'x');
+		    auto empty = s.insert("").first;
+		    auto first = s.insert("first").first;
+		    auto large = s.insert(big).first;
+		    for (int i = 0; i < 20000; ++i)
+			    s.insert("s" + std::to_string(i));
+
+		    if (StringSet::view(empty) != "" || StringSet::view(first) != "first" ||
+		        StringSet::view(large) != big)
+			    return {TestStatus::Fail, "Stored strings changed after growing the set"};
+
+		    if (s.insert("first").first != first || s.insert(big).first != large)
+			    return {TestStatus::Fail, "Reinserting a string gave a different copy"};
+
+		    auto last = s.insert("s19999").first;
+		    if (StringSet::view(last) != "s19999" || last[6] != '\0')
+			    return {TestStatus::Fail, "Stored strings are not NUL-terminated"};
+
+		    return {TestStatus::Ok};
+	    },
+	    +[]() -> TestReport {
+		    // every thread has to get the same copy of each string
+		    ConcurrentStringSet s;
+		    constexpr int thread_count = 4;
+		    constexpr int string_count = 1000;
+		    std::vector<std::vector<char const*>> results(thread_count);
+
+		    std::vector<std::thread> threads;
+		    for (int t = 0; t < thread_count; ++t) {
+			    threads.emplace_back([&s, &results, t] {
+				    for (int i = 0; i < string_count; ++i) {
+					    // different threads go through the strings in different orders
+					    int k = (i * (2 * t + 1)) % string_count;
+					    std::string str = "name" + std::to_string(k);
+					    results[t].push_back(s.insert(string_view(str)).first);
+				    }
+			    });
+		    }
+		    for (auto& thread : threads)
+			    thread.join();
+
+		    for (int t = 0; t < thread_count; ++t) {
+			    for (int i = 0; i < string_count; ++i) {
+				    int k = (i * (2 * t + 1)) % string_count;
+				    // thread 0 inserts string k at step k
+				    if (results[t][i] != results[0][k] ||
+				        StringSet::view(results[t][i]) != "name" + std::to_string(k))
+					    return {TestStatus::Fail, "Threads got different copies of a string"};
+			    }
+		    }
+
+		    if (!s.includes("name7") || s.includes("name1000"))
+			    return {TestStatus::Fail, "Concurrent set has the wrong contents"};
+
 		    return {TestStatus::Ok};
 	    }}));
 }
 
+void paged_array_tests(Test::Tester& tester) {
+	tester.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {+[]() -> TestReport {
+		    PagedArray<std::string, 3> a;
+		    a.push_back("first");
+		    std::string* first = &a.back();
+		    for (int i = 1; i < 100; ++i)
+			    a.push_back(std::to_string(i));
+
+		    if (&a.at(0) != first || *first != "first")
+			    return {TestStatus::Fail, "Growing the array moved its elements"};
+		    if (a.size() != 100 || a.at(57) != "57" || a.back() != "99")
+			    return {TestStatus::Fail, "Indexing gave the wrong element"};
+
+		    // 100 elements in pages of 8
+		    if (a.page_count() != 13 || a.page(12).size() != 4)
+			    return {TestStatus::Fail, "Pages have the wrong sizes"};
+
+		    int visited = 0;
+		    bool in_order = true;
+		    a.for_each([&](std::string& s) {
+			    if (visited > 0 && s != std::to_string(visited))
+				    in_order = false;
+			    visited += 1;
+		    });
+		    if (visited != 100 || !in_order)
+			    return {TestStatus::Fail, "Iterating by pages missed elements"};
+
+		    return {TestStatus::Ok};
+	    }}));
+}
+
+void module_cache_tests(Test::Tester& tester) {
+	tester.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {
+	        +[]() -> TestReport {
+		        auto key = Compiler::ModuleCache::key_for("x := 1;", "flags");
+		        if (key != Compiler::ModuleCache::key_for("x := 1;", "flags"))
+			        return {TestStatus::Fail, "The same input gave different keys"};
+		        if (key == Compiler::ModuleCache::key_for("x := 2;", "flags"))
+			        return {TestStatus::Fail, "Different sources gave the same key"};
+		        if (key == Compiler::ModuleCache::key_for("x := 1;", "other flags"))
+			        return {TestStatus::Fail, "Different flags gave the same key"};
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        namespace fs = std::filesystem;
+		        auto root = fs::temp_directory_path() / "jasper_module_cache_test";
+		        fs::remove_all(root);
+		        fs::create_directories(root);
+
+		        auto object = root / "object.o";
+		        std::ofstream(object) << "0123456789";
+
+		        // room for two entries of 10 bytes
+		        Compiler::ModuleCache cache {root / "cache", 25};
+		        auto now = fs::file_time_type::clock::now();
+		        cache.store("a", object);
+		        fs::last_write_time(root / "cache" / "a.o", now - std::chrono::hours(3));
+		        cache.store("b", object);
+		        fs::last_write_time(root / "cache" / "b.o", now - std::chrono::hours(2));
+
+		        // using 'a' makes 'b' the least recently used entry
+		        if (!cache.fetch("a", root / "out.o"))
+			        return {TestStatus::Fail, "Stored entry was not found"};
+		        cache.store("c", object);
+
+		        bool ok = cache.fetch("a", root / "out.o") &&
+		                  !cache.fetch("b", root / "out.o") &&
+		                  cache.fetch("c", root / "out.o");
+		        fs::remove_all(root);
+
+		        if (!ok)
+			        return {TestStatus::Fail, "The least recently used entry was not evicted"};
+		        return {TestStatus::Ok};
+	        }}));
+}
+
+static bool same_token(Token a, Token b) {
+	auto text_a = a.text();
+	auto text_b = b.text();
+	return a.type() == b.type() && a.range().start == b.range().start &&
+	       a.range().end == b.range().end &&
+	       std::string(text_a.begin(), text_a.end()) == std::string(text_b.begin(), text_b.end());
+}
+
+void lexer_tests(Test::Tester& tester) {
+	tester.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {
+	        +[]() -> TestReport {
+		        // every start position and run length, so that runs begin and
+		        // end at all offsets inside a vector
+		        auto const initial_isa = CharScan::active_isa();
+		        for (auto isa : {CharScan::Isa::Scalar, CharScan::Isa::SSE2, CharScan::Isa::AVX2}) {
+			        CharScan::use_isa(isa);
+			        for (int start = 0; start < 64; ++start) {
+				        for (int length = 0; length < 100; ++length) {
+					        std::string s(start, '.');
+					        s += std::string(length, 'a') + "+";
+					        s += std::string(length, ' ') + "+";
+					        s += std::string(length, '7') + "+";
+					        s += std::string(length, 'b') + "\n";
+					        s += std::string(length, 'c') + "\"";
+
+					        char const* p = s.c_str() + start;
+					        bool ok = CharScan::skip_identifier(p) == p + length;
+					        p += length + 1;
+					        ok = ok && CharScan::skip_whitespace(p) == p + length;
+					        p += length + 1;
+					        ok = ok && CharScan::skip_digits(p) == p + length;
+					        p += length + 1;
+					        ok = ok && CharScan::find_line_end(p) == p + length;
+					        p += length + 1;
+					        ok = ok && CharScan::find_quote(p) == p + length;
+					        ok = ok && CharScan::find_quote(p + length + 1) == s.c_str() + s.size();
+
+					        if (!ok) {
+						        CharScan::use_isa(initial_isa);
+						        return {
+						            TestStatus::Fail,
+						            "Character scan stopped at the wrong place at offset " +
+						                std::to_string(start) + ", length " +
+						                std::to_string(length)};
+					        }
+				        }
+			        }
+		        }
+		        CharScan::use_isa(initial_isa);
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        std::string source = "ab\n\n  cd\nlong line";
+		        LineIndex lines {source.c_str()};
+
+		        std::string expected[] = {"1:1", "1:3", "2:1", "3:3", "4:1", "4:10"};
+		        int offsets[] = {0, 2, 3, 6, 9, 18};
+		        for (int i = 0; i < std::size(offsets); ++i) {
+			        auto found = lines.locate(offsets[i]).to_string();
+			        if (found != expected[i])
+				        return {
+				            TestStatus::Fail,
+				            "Offset " + std::to_string(offsets[i]) + " was at " + found +
+				                " instead of " + expected[i]};
+		        }
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        // the vectorized lexer gives the same tokens as the scalar one
+		        char const* pieces[] = {
+		            "x", "_tmp9", "while", "whilee", "fn", "Array_of_things",
+		            "0", "12345678901234567890", "3.14159", "1.0",
+		            "\"\"", "\"some text that is longer than a vector\"",
+		            "// a comment\n", "//\n", "+", "+=", "++", "|>", "<:", ":>",
+		            "==", "=>", "(", ")", "{", "}", ";", ".", " ", "\t", "\n",
+		            "                                        "};
+		        std::mt19937 rng {1234};
+		        std::uniform_int_distribution<int> pick(0, std::size(pieces) - 1);
+
+		        auto const initial_isa = CharScan::active_isa();
+		        for (int round = 0; round < 50; ++round) {
+			        std::string source;
+			        for (int i = 0; i < 400; ++i) {
+				        source += pieces[pick(rng)];
+				        // keep identifiers and numbers from fusing into
+				        // something that doesn't lex, like 1.0.5
+				        source += ' ';
+			        }
+			        source += "// comment at the end";
+
+			        CharScan::use_isa(CharScan::Isa::Scalar);
+			        auto expected = tokenize(source.c_str());
+			        CharScan::use_isa(initial_isa);
+			        auto actual = tokenize(source.c_str());
+
+			        if (expected.size() != actual.size())
+				        return {TestStatus::Fail, "Different token count with vector scans"};
+
+			        for (int i = 0; i < expected.size(); ++i) {
+				        if (!same_token(expected.at(i), actual.at(i)))
+					        return {
+					            TestStatus::Fail,
+					            "Token " + std::to_string(i) + " differs with vector scans"};
+			        }
+		        }
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        // lexing from a reader gives the same tokens as lexing the
+		        // whole buffer, wherever the chunk boundaries fall
+		        std::string source =
+		            "// header\nfib := fn(n) {\n\tif (n < 2) return n;\n"
+		            "\treturn fib(n - 1) + fib(n - 2);\n};\n"
+		            "s := \"a string that is longer than most chunks\";\n"
+		            "x := 3.25 + 1234567;\n// trailing comment";
+		        auto expected = tokenize(source.c_str());
+
+		        for (size_t chunk_size : {1, 2, 3, 7, 16, 1000}) {
+			        size_t position = 0;
+			        Lexer lexer {
+			            [&](char* buffer, size_t capacity) -> size_t {
+				            size_t n = std::min(capacity, source.size() - position);
+				            source.copy(buffer, n, position);
+				            position += n;
+				            return n;
+			            },
+			            chunk_size};
+			        lexer.lex_all();
+
+			        auto const& actual = lexer.m_tokens;
+			        if (expected.size() != actual.size())
+				        return {
+				            TestStatus::Fail,
+				            "Different token count with chunks of " + std::to_string(chunk_size)};
+
+			        for (int i = 0; i < expected.size(); ++i) {
+				        if (!same_token(expected.at(i), actual.at(i)))
+					        return {
+					            TestStatus::Fail,
+					            "Token " + std::to_string(i) + " differs with chunks of " +
+					                std::to_string(chunk_size)};
+			        }
+
+			        // only the text of the tokens is kept, not the whole input
+			        if (actual.m_source || actual.m_text.size() >= source.size())
+				        return {
+				            TestStatus::Fail,
+				            "Kept too much of the input with chunks of " +
+				                std::to_string(chunk_size)};
+		        }
+		        return {TestStatus::Ok};
+	        }}));
+}
+
+static bool same_error(ErrorReport const& a, ErrorReport const& b) {
+	if (a.m_text != b.m_text || a.m_offset != b.m_offset ||
+	    a.m_sub_errors.size() != b.m_sub_errors.size())
+		return false;
+	for (size_t i = 0; i < a.m_sub_errors.size(); ++i)
+		if (!same_error(a.m_sub_errors[i], b.m_sub_errors[i]))
+			return false;
+	return true;
+}
+
+void parser_tests(Test::Tester& tester) {
+	tester.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {
+	        +[]() -> TestReport {
+		        // a parallel parse finds the same declarations, in the same order
+		        std::string source;
+		        for (int i = 0; i < 300; ++i) {
+			        auto n = std::to_string(i);
+			        if (i % 3 == 0)
+				        source += "f" + n + " := fn(x) { if (x < 2) return x; return array { x; (x); }[0]; };\n";
+			        else if (i % 3 == 1)
+				        source += "fn g" + n + "(a, b) => a + b * " + n + ";\n";
+			        else
+				        source += "v" + n + " := seq { return 1; };\n";
+		        }
+		        auto tokens = tokenize(source.c_str());
+
+		        CST::Allocator serial_allocator;
+		        auto serial = parse_program(tokens, serial_allocator);
+		        CST::Allocator parallel_allocator;
+		        auto parallel = parse_program(tokens, parallel_allocator, 4);
+
+		        if (!serial.ok() || !parallel.ok())
+			        return {TestStatus::Fail, "Failed to parse a valid program"};
+
+		        auto const& expected = static_cast<CST::Program*>(serial.m_result)->m_declarations;
+		        auto const& actual = static_cast<CST::Program*>(parallel.m_result)->m_declarations;
+		        if (expected.size() != actual.size())
+			        return {TestStatus::Fail, "Parallel parse found a different number of declarations"};
+
+		        for (size_t i = 0; i < expected.size(); ++i) {
+			        if (expected[i]->type() != actual[i]->type() ||
+			            !(expected[i]->identifier_virtual() == actual[i]->identifier_virtual()))
+				        return {
+				            TestStatus::Fail,
+				            "Declaration " + std::to_string(i) + " differs in a parallel parse"};
+		        }
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        // and reports the same errors
+		        std::string const sources[] = {
+		            "a := 1;\nb := 2 +;\nc := 3;\nd := ;\n",
+		            "a := 1;\nb := (1;\nc := 3;\nd := 4;\n",
+		            "a := 1;\nb := 1);\nc := {;\nd := 4;\n",
+		            "a := 1;\nb := 2;\nc := 3;\nd := 4\n",
+		            "a := 1;;\nb := 2;\nc := 3;\n"};
+		        for (auto const& source : sources) {
+			        auto tokens = tokenize(source.c_str());
+			        CST::Allocator serial_allocator;
+			        auto serial = parse_program(tokens, serial_allocator);
+			        CST::Allocator parallel_allocator;
+			        auto parallel = parse_program(tokens, parallel_allocator, 3);
+
+			        if (serial.ok() || parallel.ok() || !same_error(serial.error(), parallel.error()))
+				        return {TestStatus::Fail, "Parallel parse gave different errors for:\n" + source};
+		        }
+		        return {TestStatus::Ok};
+	        }}));
+}
+
+void source_file_tests(Test::Tester& tester) {
+	tester.add_test(std::make_unique<Test::NormalTestSet>(
+	    std::vector<Test::NormalTestSet::TestFunction> {
+	        +[]() -> TestReport {
+		        // a file that fills its last page exactly still gets a NUL
+		        // byte after it
+		        auto path = std::filesystem::temp_directory_path() / "jasper_source_file_test.jp";
+		        std::string contents(sysconf(_SC_PAGESIZE), 'x');
+		        std::ofstream(path) << contents;
+
+		        SourceFile source;
+		        bool ok = source.load(path.c_str()) && source.size() == contents.size() &&
+		                  std::string(source.data()) == contents;
+		        std::filesystem::remove(path);
+
+		        if (!ok)
+			        return {TestStatus::Fail, "Mapped file has the wrong contents"};
+		        return {TestStatus::Ok};
+	        },
+	        +[]() -> TestReport {
+		        // pipes can't be mapped, they are read instead
+		        int fds[2];
+		        if (pipe(fds) != 0)
+			        return {TestStatus::Error, "Failed to create a pipe"};
+
+		        std::string contents = "x := 1;\n";
+		        bool ok = write(fds[1], contents.data(), contents.size()) == ssize_t(contents.size());
+		        close(fds[1]);
+
+		        SourceFile source;
+		        std::string path = "/dev/fd/" + std::to_string(fds[0]);
+		        ok = ok && source.load(path.c_str()) && std::string(source.data()) == contents;
+		        close(fds[0]);
+
+		        if (!ok)
+			        return {TestStatus::Fail, "Reading from a pipe gave the wrong contents"};
+		        return {TestStatus::Ok};
+	        }}));
+}
+
 int main() {
 	Test::Tester tests;
 	tarjan_algorithm_tests(tests);
+	type_system_tests(tests);
 	allocator_tests(tests);
 	string_set_tests(tests);
+	paged_array_tests(tests);
+	module_cache_tests(tests);
+	compiler_tests(tests);
+	lexer_tests(tests);
+	parser_tests(tests);
+	source_file_tests(tests);
 	interpreter_tests(tests);
+	tiering_tests(tests);
+	session_tests(tests);
+	ast_cache_tests(tests);
+	profiler_tests(tests);
+	daemon_tests(tests);
 	auto test_result = tests.execute();
 	if (test_result.m_code != TestStatus::Ok)
 		return 1;
@@ -1,7 +1,5 @@
-#include <fstream>
-#include <sstream>
-
 #include "../interpreter/execute.hpp"
+#include "../source_file.hpp"
 #include "../symbol_table.hpp"
 #include "test_set.hpp"
 
@@ -23,21 +21,20 @@ TestReport InterpreterTestSet::execute() {
 		return {TestStatus::Empty};
 
 	try {
-		std::ifstream in_fs(m_source_file);
-		if (!in_fs.good())
+		SourceFile source;
+		if (!source.load(m_source_file.c_str()))
 			return {TestStatus::MissingFile};
 
-		std::stringstream file_content;
-		std::string line;
-
-		while (std::getline(in_fs, line))
-			file_content << line << '\n';
-
 		Interpreter::ExecuteSettings settings;
 		settings.dump_cst = m_dump;
+		if (m_tiering) {
+			// compile everything on its first call, so the JIT gets exercised
+			settings.tiering = true;
+			settings.tier_up_threshold = 1;
+		}
 
 		for (auto* f : m_testers) {
-			ExitStatus answer = Interpreter::execute(file_content.str(), settings, f);
+			ExitStatus answer = Interpreter::execute(source, settings, f);
 
 			if (ExitStatus::Ok != answer)
 				return {TestStatus::Fail};
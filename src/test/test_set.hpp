@@ -29,6 +29,7 @@ struct InterpreterTestSet : public TestSet {
 	std::string m_source_file;
 	std::vector<Interpret> m_testers;
 	bool m_dump = false;
+	bool m_tiering = false;
 
 	InterpreterTestSet(std::string);
 	InterpreterTestSet(std::string, Interpret);
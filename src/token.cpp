@@ -1,3 +1,51 @@
 #include "token.hpp"
 
-// Empty module. Token is a POD struct.
+#include <cstring>
+
+#include "token_array.hpp"
+
+void TokenArray::push_back(TokenTag tag, SourceRange range, char const* text) {
+	size_t const length = range.end - range.start;
+
+	// reuse the text of the last token with the same tag, if it's the same
+	int offset = -1;
+	if (m_last_with_tag.empty())
+		m_last_with_tag.resize(int(TokenTag::END) + 1, -1);
+	int& last = m_last_with_tag[int(tag)];
+	if (last != -1) {
+		auto other = m_ranges[last];
+		if (size_t(other.end - other.start) == length &&
+		    std::memcmp(m_text.data() + m_text_offsets[last], text, length) == 0)
+			offset = m_text_offsets[last];
+	}
+	last = size();
+
+	if (offset == -1) {
+		offset = m_text.size();
+		m_text.append(text, length);
+	}
+
+	push_back(tag, range);
+	m_text_offsets.push_back(offset);
+}
+
+TokenTag Token::type() const {
+	return m_array->m_tags[m_index];
+}
+
+SourceRange Token::range() const {
+	return m_array->m_ranges[m_index];
+}
+
+string_view Token::text() const {
+	auto range = this->range();
+	char const* start = m_array->text_of(m_index);
+	if (type() == TokenTag::STRING)
+		return {start + 1, size_t(range.end - range.start - 2)};
+	return {start, size_t(range.end - range.start)};
+}
+
+InternedString Token::interned() const {
+	auto text = this->text();
+	return InternedString(text.begin(), text.size());
+}
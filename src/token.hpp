@@ -3,12 +3,24 @@
 #include "source_location.hpp"
 #include "token_tag.hpp"
 #include "utils/interned_string.hpp"
+#include "utils/string_view.hpp"
 
+struct TokenArray;
+
+// Refers to a token in a TokenArray. The token's text is not stored, it is
+// read from the source when asked for, and is only interned on request
+// (i.e. when it becomes the name of something in the AST).
 struct Token {
-	/* internal representation of token */
-	TokenTag m_type;
-	/* source code representation of token */
-	InternedString m_text;
+	TokenArray const* m_array {nullptr};
+	int m_index {0};
+
+	[[nodiscard]] TokenTag type() const;
+	[[nodiscard]] SourceRange range() const;
+	// source code representation of token. Quotes are left out of strings
+	[[nodiscard]] string_view text() const;
+	[[nodiscard]] InternedString interned() const;
 
-	SourceRange m_source_location;
+	[[nodiscard]] bool is_null() const {
+		return !m_array;
+	}
 };
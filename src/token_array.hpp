@@ -1,7 +1,51 @@
 #pragma once
 
-#include "utils/chunked_array.hpp"
+#include <string>
+#include <vector>
 
-struct Token;
+#include "source_location.hpp"
+#include "token.hpp"
+#include "token_tag.hpp"
 
-using TokenArray = ChunkedArray<Token>;
+// Tokens stored as a struct of arrays: one array of tags, and one of byte
+// ranges into the source, which the text of each token is read from.
+//
+// When the source is not kept in memory (i.e. it was lexed from a reader),
+// the text of each token is copied into m_text instead, and m_text_offsets
+// says where. Tokens with the same tag and spelling as the previous one of
+// their tag share its copy, so keywords and punctuation take no space.
+// Copied text may move as tokens are pushed, so views of it shouldn't be
+// kept while lexing.
+struct TokenArray {
+	std::vector<TokenTag> m_tags {};
+	std::vector<SourceRange> m_ranges {};
+	// start of the source. Has to outlive the array. Null if the text of
+	// the tokens is in m_text
+	char const* m_source {nullptr};
+	std::string m_text {};
+	std::vector<int> m_text_offsets {};
+	// index of the last token pushed with each tag, along with its text
+	std::vector<int> m_last_with_tag {};
+
+	void push_back(TokenTag tag, SourceRange range) {
+		m_tags.push_back(tag);
+		m_ranges.push_back(range);
+	}
+
+	// pushes a token along with a copy of its text
+	void push_back(TokenTag tag, SourceRange range, char const* text);
+
+	[[nodiscard]] char const* text_of(int i) const {
+		if (m_source)
+			return m_source + m_ranges[i].start;
+		return m_text.data() + m_text_offsets[i];
+	}
+
+	[[nodiscard]] Token at(int i) const {
+		return {this, i};
+	}
+
+	[[nodiscard]] int size() const {
+		return m_tags.size();
+	}
+};
@@ -75,7 +75,7 @@ constexpr const char* token_string[] = {TOKEN_TAGS};
 
 /* internal representation */
 #define X(name, str) name,
-enum class TokenTag { TOKEN_TAGS };
+enum class TokenTag : unsigned char { TOKEN_TAGS };
 #undef X
 
 #undef TOKEN_TAGS
@@ -59,9 +59,20 @@ void typecheck(AST::Identifier* ast, TypeChecker& tc) {
 	assert(uf.is(meta_type, Tag::Term));
 
 	// here we implement the [var] rule
-	ast->m_value_type = declaration->m_is_polymorphic
-	                        ? tc.m_core.inst_fresh(declaration->m_decl_type)
-	                        : declaration->m_value_type;
+	if (!declaration->m_is_polymorphic) {
+		ast->m_value_type = declaration->m_value_type;
+		return;
+	}
+
+	// same as inst_fresh, but we keep the fresh variables around so that
+	// the backend can tell which monotypes they end up being
+	std::vector<MonoId> vals;
+	auto const var_count = tc.m_core.poly_data[declaration->m_decl_type].vars.size();
+	for (size_t i {0}; i != var_count; ++i)
+		vals.push_back(tc.m_core.m_mono_core.new_var());
+
+	ast->m_value_type = tc.m_core.inst_with(declaration->m_decl_type, vals);
+	tc.m_instantiations[declaration].push_back({ast, std::move(vals)});
 }
 
 void typecheck(AST::Block* ast, TypeChecker& tc) {
@@ -338,6 +349,9 @@ void typecheck(AST::Declaration* ast, TypeChecker& tc) {
 }
 
 void typecheck(AST::Program* ast, TypeChecker& tc) {
+	// a typechecker can be reused for several programs, whose declarations
+	// may be gone by now
+	tc.m_instantiations.clear();
 
 	auto const& comps = tc.m_env.declaration_components;
 	for (auto const& decls : comps) {
@@ -376,6 +390,17 @@ void typecheck(AST::Program* ast, TypeChecker& tc) {
 		for (auto decl : decls) {
 			generalize(decl, tc);
 		}
+
+		// values that weren't generalized share their free variables with
+		// the declarations that use them, which may bind them later on
+		for (auto decl : decls) {
+			if (decl->m_is_polymorphic)
+				continue;
+			std::unordered_set<MonoId> free_vars;
+			tc.m_core.gather_free_vars(decl->m_value_type, free_vars);
+			if (!free_vars.empty())
+				tc.m_open_values.insert(decl);
+		}
 	}
 }
 
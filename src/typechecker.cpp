@@ -14,6 +14,7 @@ TypeChecker::TypeChecker(AST::Allocator& allocator) : m_ast_allocator(&allocator
 	m_core.new_builtin_type_function(0);  // 2  | float
 	m_core.new_builtin_type_function(0);  // 3  | string
 	m_core.new_builtin_type_function(1);  // 4  | array
+	m_core.new_builtin_type_function(0);  // 5  | unused
 	m_core.new_builtin_type_function(0);  // 6  | boolean
 	m_core.new_builtin_type_function(0);  // 7  | unit
 
@@ -183,18 +184,22 @@ PolyId TypeChecker::generalize(MonoId mono) {
 	m_core.gather_free_vars(mono, free_vars);
 
 	std::vector<MonoId> new_vars;
+	std::vector<MonoId> origin_vars;
 	std::unordered_map<MonoId, MonoId> mapping;
 	for (MonoId var : free_vars) {
 		if (!m_env.has_type_var(var)) {
 			auto fresh_var = new_hidden_var();
 			new_vars.push_back(fresh_var);
+			origin_vars.push_back(var);
 			mapping[var] = fresh_var;
 		}
 	}
 
 	MonoId base = m_core.inst_impl(mono, mapping);
 
-	return m_core.new_poly(base, std::move(new_vars));
+	PolyId poly = m_core.new_poly(base, std::move(new_vars));
+	m_core.poly_data[poly].origin_vars = std::move(origin_vars);
+	return poly;
 }
 
 void TypeChecker::bind_free_vars(MonoId mono) {
@@ -1,26 +1,43 @@
 #pragma once
 
+#include <unordered_set>
+
 #include "compile_time_environment.hpp"
 #include "typesystem.hpp"
-#include "utils/chunked_array.hpp"
 #include "utils/interned_string.hpp"
+#include "utils/paged_array.hpp"
 
 namespace AST {
 struct Allocator;
 struct Declaration;
+struct Identifier;
 }
 
 namespace TypeChecker {
 
+// A use of a polymorphic declaration, along with the monotypes its type
+// variables were instantiated with at that point
+struct Instantiation {
+	AST::Identifier* m_site;
+	std::vector<MonoId> m_args;
+};
+
 struct TypeChecker {
 
 	TypeSystemCore m_core;
 	Frontend::CompileTimeEnvironment m_env;
-	ChunkedArray<AST::Declaration> m_builtin_declarations;
+	PagedArray<AST::Declaration, 6> m_builtin_declarations;
 
 	AST::Allocator* m_ast_allocator;
 	bool m_in_last_metacheck_pass {false};
 
+	// every instantiation of each polymorphic declaration, in the order
+	// they were found
+	std::unordered_map<AST::Declaration*, std::vector<Instantiation>> m_instantiations;
+	// declarations of values whose type still had free variables once they
+	// were checked
+	std::unordered_set<AST::Declaration*> m_open_values;
+
 	TypeChecker(AST::Allocator& allocator);
 
 	AST::Declaration* new_builtin_declaration(InternedString const& name);
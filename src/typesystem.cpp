@@ -1,5 +1,6 @@
 #include "typesystem.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 #include "./log/log.hpp"
@@ -49,8 +50,7 @@ TypeSystemCore::TypeSystemCore() {
 			//
 			// Also, we do it before unifying their data to prevent infinite
 			// recursion
-			core.node_header[a].tag = Unification::Core::Tag::Var;
-			core.node_header[a].data_idx = b;
+			core.link(a, b);
 			b_data.argument_count = new_argument_count;
 
 			for (auto& kv_a : a_data.structure) {
@@ -93,6 +93,26 @@ MonoId TypeSystemCore::new_term(
     TypeFunctionId tf, std::vector<int> args, char const* tag) {
 	tf = m_tf_core.find(tf);
 
+	bool ground = m_tf_core.is_term(tf) &&
+	              !m_type_functions[m_tf_core.find_function(tf)].is_dummy;
+	size_t hash = std::hash<int> {}(tf);
+	for (MonoId& arg : args) {
+		arg = m_mono_core.find(arg);
+		ground = ground && is_ground(arg);
+		hash = hash * 1000003 ^ std::hash<int> {}(arg);
+	}
+
+	if (ground) {
+		auto range = m_ground_terms.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			TermId term = m_mono_core.node_header[it->second].data_idx;
+			Span<int const> term_args = m_mono_core.arguments(term);
+			if (m_mono_core.term_data[term].function_id == tf &&
+			    std::equal(term_args.begin(), term_args.end(), args.begin(), args.end()))
+				return it->second;
+		}
+	}
+
 	{
 		// TODO: add a TypeFunctionTag::Unknown tag, to express
 		// that it's a dummy of unknown characteristics
@@ -107,7 +127,25 @@ MonoId TypeSystemCore::new_term(
 		m_tf_core.unify(tf, dummy_tf);
 	}
 
-	return m_mono_core.new_term(tf, std::move(args), tag);
+	MonoId mono = m_mono_core.new_term(tf, args, tag);
+
+	if (ground) {
+		TermId term = m_mono_core.node_header[mono].data_idx;
+		if (m_ground_term_ids.size() <= size_t(term))
+			m_ground_term_ids.resize(term + 1);
+		m_ground_term_ids[term] = true;
+		m_ground_terms.insert({hash, mono});
+	}
+
+	return mono;
+}
+
+bool TypeSystemCore::is_ground(MonoId mono) {
+	mono = m_mono_core.find(mono);
+	if (!m_mono_core.is_term(mono))
+		return false;
+	TermId term = m_mono_core.node_header[mono].data_idx;
+	return size_t(term) < m_ground_term_ids.size() && m_ground_term_ids[term];
 }
 
 PolyId TypeSystemCore::new_poly(MonoId mono, std::vector<MonoId> vars) {
@@ -150,12 +188,15 @@ MonoId TypeSystemCore::inst_impl(
 	if (header.tag == Unification::Core::Tag::Var) {
 		auto it = mapping.find(mono);
 		return it == mapping.end() ? mono : it->second;
+	} else if (is_ground(mono)) {
+		return mono;
 	} else {
-		TermId term = header.data_idx;
+		// by index, since making the new arguments grows the buffer
+		Unification::Core::TermData data = m_mono_core.term_data[header.data_idx];
 		std::vector<MonoId> new_args;
-		for (MonoId arg : m_mono_core.term_data[term].argument_idx)
-			new_args.push_back(inst_impl(arg, mapping));
-		return new_term(m_mono_core.term_data[term].function_id, std::move(new_args));
+		for (int i = 0; i != data.argument_count; ++i)
+			new_args.push_back(inst_impl(m_mono_core.argument_idx[data.argument_start + i], mapping));
+		return new_term(data.function_id, std::move(new_args));
 	}
 }
 
@@ -185,9 +226,8 @@ void TypeSystemCore::gather_free_vars(MonoId mono, std::unordered_set<MonoId>& f
 
 	if (header.tag == Unification::Core::Tag::Var) {
 		free_vars.insert(mono);
-	} else {
-		TermId term = header.data_idx;
-		for (MonoId arg : m_mono_core.term_data[term].argument_idx)
+	} else if (!is_ground(mono)) {
+		for (MonoId arg : m_mono_core.arguments(header.data_idx))
 			gather_free_vars(arg, free_vars);
 	}
 }
@@ -33,6 +33,10 @@ struct TypeFunctionData {
 struct PolyData {
 	MonoId base;
 	std::vector<MonoId> vars;
+	// the variables of the generalized monotype that were replaced by
+	// `vars`, in the same order. Empty for polytypes that weren't made by
+	// generalization (e.g. builtins)
+	std::vector<MonoId> origin_vars {};
 };
 
 struct TypeSystemCore {
@@ -45,6 +49,15 @@ struct TypeSystemCore {
 
 	MetaUnifier m_meta_core;
 
+	// Ground terms (ones whose type function is not a dummy, and whose
+	// arguments are ground terms) by a hash of their structure, so that
+	// equal ground monotypes are only made once, and share a node. They
+	// never change: terms are never linked, and neither are type functions
+	// that aren't dummies
+	std::unordered_multimap<size_t, MonoId> m_ground_terms;
+	// whether each term id is in m_ground_terms
+	std::vector<bool> m_ground_term_ids;
+
 	TypeSystemCore();
 
 	MonoId new_term(
@@ -54,6 +67,8 @@ struct TypeSystemCore {
 
 	PolyId new_poly(MonoId mono, std::vector<MonoId> vars);
 
+	bool is_ground(MonoId mono);
+
 	TypeFunctionId new_builtin_type_function(int arguments);
 	TypeFunctionId new_type_function(
 	    TypeFunctionTag type,
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <new>
+
+#include "list_arena.hpp"
+#include "span.hpp"
+
+// Growable list whose buffer lives in a ListArena, for tree nodes that get
+// their elements added after they are built.
+//
+// Growing copies the elements into a bigger buffer from the arena and leaves
+// the old one behind, so this is meant for short lists. Elements are never
+// destroyed, and copies of an ArenaVector share its buffer, so only one of
+// them may be grown.
+template <typename T>
+struct ArenaVector {
+	using iterator = T*;
+	using const_iterator = T const*;
+
+	T* m_data {nullptr};
+	int m_size {0};
+	int m_capacity {0};
+
+	void push_back(T const& value, ListArena& arena) {
+		if (m_size == m_capacity)
+			grow(arena);
+		new (m_data + m_size) T(value);
+		++m_size;
+	}
+
+	// appends `value` unless it's already there. Returns whether it was added
+	bool insert(T const& value, ListArena& arena) {
+		if (contains(value))
+			return false;
+		push_back(value, arena);
+		return true;
+	}
+
+	[[nodiscard]] bool contains(T const& value) const {
+		for (auto const& element : *this)
+			if (element == value)
+				return true;
+		return false;
+	}
+
+	T& operator[](int i) {
+		return m_data[i];
+	}
+
+	T const& operator[](int i) const {
+		return m_data[i];
+	}
+
+	[[nodiscard]] int size() const {
+		return m_size;
+	}
+
+	[[nodiscard]] bool empty() const {
+		return m_size == 0;
+	}
+
+	iterator begin() {
+		return m_data;
+	}
+
+	iterator end() {
+		return m_data + m_size;
+	}
+
+	const_iterator begin() const {
+		return m_data;
+	}
+
+	const_iterator end() const {
+		return m_data + m_size;
+	}
+
+	Span<T> span() {
+		return {m_data, m_size};
+	}
+
+  private:
+	void grow(ListArena& arena) {
+		int const capacity = m_capacity ? m_capacity * 2 : 4;
+		T* data = arena.allocate_array<T>(capacity);
+		for (int i = 0; i < m_size; ++i)
+			new (data + i) T(m_data[i]);
+		m_data = data;
+		m_capacity = capacity;
+	}
+};
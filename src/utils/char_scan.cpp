@@ -0,0 +1,252 @@
+#include "char_scan.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JASPER_CHAR_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace CharScan {
+
+enum class Class { Whitespace, Identifier, Digit, LineEnd, Quote };
+
+// ==== scalar ====
+
+static bool is_whitespace(unsigned char c) {
+	return c == ' ' || c == '\t' || c == '\n';
+}
+
+static bool is_identifier(unsigned char c) {
+	return c == '_' || ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+	       ('0' <= c && c <= '9');
+}
+
+static bool is_digit(unsigned char c) {
+	return '0' <= c && c <= '9';
+}
+
+template <Class C>
+static char const* scan_scalar(char const* p) {
+	// NUL is not in any of the skipped classes, so it ends the scan
+	if constexpr (C == Class::Whitespace)
+		while (is_whitespace(*p)) ++p;
+	else if constexpr (C == Class::Identifier)
+		while (is_identifier(*p)) ++p;
+	else if constexpr (C == Class::Digit)
+		while (is_digit(*p)) ++p;
+	else if constexpr (C == Class::LineEnd)
+		while (*p != '\n' && *p != '\0') ++p;
+	else
+		while (*p != '"' && *p != '\0') ++p;
+	return p;
+}
+
+#ifdef JASPER_CHAR_SCAN_X86
+
+// ==== sse2 ====
+
+// bytes of x in [lo, hi], as unsigned values
+__attribute__((target("sse2")))
+static __m128i in_range_sse2(__m128i x, char lo, char hi) {
+	__m128i above = _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(lo)), x);
+	__m128i below = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(hi)), x);
+	return _mm_and_si128(above, below);
+}
+
+__attribute__((target("sse2")))
+static __m128i equals_sse2(__m128i x, char c) {
+	return _mm_cmpeq_epi8(x, _mm_set1_epi8(c));
+}
+
+// bit i is set if byte i ends the scan
+template <Class C>
+__attribute__((target("sse2")))
+static uint32_t stop_mask_sse2(__m128i x) {
+	__m128i hit;
+	if constexpr (C == Class::Whitespace) {
+		hit = _mm_or_si128(
+		    _mm_or_si128(equals_sse2(x, ' '), equals_sse2(x, '\t')),
+		    equals_sse2(x, '\n'));
+	} else if constexpr (C == Class::Identifier) {
+		// setting 0x20 maps 'A'-'Z' onto 'a'-'z' and nothing else into it
+		__m128i letter = in_range_sse2(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+		hit = _mm_or_si128(
+		    _mm_or_si128(letter, in_range_sse2(x, '0', '9')), equals_sse2(x, '_'));
+	} else if constexpr (C == Class::Digit) {
+		hit = in_range_sse2(x, '0', '9');
+	} else if constexpr (C == Class::LineEnd) {
+		return _mm_movemask_epi8(_mm_or_si128(equals_sse2(x, '\n'), equals_sse2(x, '\0')));
+	} else {
+		return _mm_movemask_epi8(_mm_or_si128(equals_sse2(x, '"'), equals_sse2(x, '\0')));
+	}
+	return ~_mm_movemask_epi8(hit) & 0xffff;
+}
+
+template <Class C>
+__attribute__((target("sse2"), no_sanitize("address")))
+static char const* scan_sse2(char const* p) {
+	// aligned loads never straddle a page boundary, so reading the whole
+	// block that holds the terminator is safe
+	uintptr_t const offset = reinterpret_cast<uintptr_t>(p) & 15;
+	char const* block = p - offset;
+
+	uint32_t mask = stop_mask_sse2<C>(
+	    _mm_load_si128(reinterpret_cast<__m128i const*>(block))) >> offset;
+	if (mask)
+		return p + __builtin_ctz(mask);
+
+	while (true) {
+		block += 16;
+		mask = stop_mask_sse2<C>(_mm_load_si128(reinterpret_cast<__m128i const*>(block)));
+		if (mask)
+			return block + __builtin_ctz(mask);
+	}
+}
+
+// ==== avx2 ====
+
+__attribute__((target("avx2")))
+static __m256i in_range_avx2(__m256i x, char lo, char hi) {
+	__m256i above = _mm256_cmpeq_epi8(_mm256_max_epu8(x, _mm256_set1_epi8(lo)), x);
+	__m256i below = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(hi)), x);
+	return _mm256_and_si256(above, below);
+}
+
+__attribute__((target("avx2")))
+static __m256i equals_avx2(__m256i x, char c) {
+	return _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c));
+}
+
+template <Class C>
+__attribute__((target("avx2")))
+static uint32_t stop_mask_avx2(__m256i x) {
+	__m256i hit;
+	if constexpr (C == Class::Whitespace) {
+		hit = _mm256_or_si256(
+		    _mm256_or_si256(equals_avx2(x, ' '), equals_avx2(x, '\t')),
+		    equals_avx2(x, '\n'));
+	} else if constexpr (C == Class::Identifier) {
+		__m256i letter = in_range_avx2(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+		hit = _mm256_or_si256(
+		    _mm256_or_si256(letter, in_range_avx2(x, '0', '9')), equals_avx2(x, '_'));
+	} else if constexpr (C == Class::Digit) {
+		hit = in_range_avx2(x, '0', '9');
+	} else if constexpr (C == Class::LineEnd) {
+		return _mm256_movemask_epi8(
+		    _mm256_or_si256(equals_avx2(x, '\n'), equals_avx2(x, '\0')));
+	} else {
+		return _mm256_movemask_epi8(
+		    _mm256_or_si256(equals_avx2(x, '"'), equals_avx2(x, '\0')));
+	}
+	return ~static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+}
+
+template <Class C>
+__attribute__((target("avx2"), no_sanitize("address")))
+static char const* scan_avx2(char const* p) {
+	uintptr_t const offset = reinterpret_cast<uintptr_t>(p) & 31;
+	char const* block = p - offset;
+
+	uint32_t mask = stop_mask_avx2<C>(
+	    _mm256_load_si256(reinterpret_cast<__m256i const*>(block))) >> offset;
+	if (mask)
+		return p + __builtin_ctz(mask);
+
+	while (true) {
+		block += 32;
+		mask = stop_mask_avx2<C>(_mm256_load_si256(reinterpret_cast<__m256i const*>(block)));
+		if (mask)
+			return block + __builtin_ctz(mask);
+	}
+}
+
+#endif
+
+// ==== dispatch ====
+
+using ScanFunction = char const* (*)(char const*);
+
+struct Kernels {
+	ScanFunction whitespace;
+	ScanFunction identifier;
+	ScanFunction digit;
+	ScanFunction line_end;
+	ScanFunction quote;
+};
+
+#define KERNELS(scan)                                                          \
+	{scan<Class::Whitespace>, scan<Class::Identifier>, scan<Class::Digit>,     \
+	 scan<Class::LineEnd>, scan<Class::Quote>}
+
+static constexpr Kernels scalar_kernels = KERNELS(scan_scalar);
+#ifdef JASPER_CHAR_SCAN_X86
+static constexpr Kernels sse2_kernels = KERNELS(scan_sse2);
+static constexpr Kernels avx2_kernels = KERNELS(scan_avx2);
+#endif
+
+#undef KERNELS
+
+Isa detected_isa() {
+#ifdef JASPER_CHAR_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return Isa::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return Isa::SSE2;
+#endif
+	return Isa::Scalar;
+}
+
+static Kernels const* kernels_for(Isa isa) {
+#ifdef JASPER_CHAR_SCAN_X86
+	if (isa == Isa::AVX2)
+		return &avx2_kernels;
+	if (isa == Isa::SSE2)
+		return &sse2_kernels;
+#endif
+	return &scalar_kernels;
+}
+
+struct Dispatch {
+	Isa isa;
+	Kernels const* kernels;
+};
+
+// picked on first use, so that scans during static initialization work too
+static Dispatch& dispatch() {
+	static Dispatch result {detected_isa(), kernels_for(detected_isa())};
+	return result;
+}
+
+Isa active_isa() {
+	return dispatch().isa;
+}
+
+void use_isa(Isa isa) {
+	if (static_cast<int>(isa) > static_cast<int>(detected_isa()))
+		isa = detected_isa();
+	dispatch() = {isa, kernels_for(isa)};
+}
+
+char const* skip_whitespace(char const* p) {
+	return dispatch().kernels->whitespace(p);
+}
+
+char const* skip_identifier(char const* p) {
+	return dispatch().kernels->identifier(p);
+}
+
+char const* skip_digits(char const* p) {
+	return dispatch().kernels->digit(p);
+}
+
+char const* find_line_end(char const* p) {
+	return dispatch().kernels->line_end(p);
+}
+
+char const* find_quote(char const* p) {
+	return dispatch().kernels->quote(p);
+}
+
+} // namespace CharScan
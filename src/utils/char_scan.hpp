@@ -0,0 +1,32 @@
+#pragma once
+
+// Vectorized scans over NUL-terminated buffers, used by the lexer to skip
+// through runs of characters that keep its automaton in the same state.
+//
+// Every function returns a pointer to the first character that is not part
+// of the run. A NUL byte always ends a run, so they never go past the end of
+// the buffer (the vector versions may read past it, but only within the same
+// aligned block, which can't cross into an unmapped page).
+namespace CharScan {
+
+enum class Isa { Scalar, SSE2, AVX2 };
+
+// best instruction set supported by the current cpu
+Isa detected_isa();
+Isa active_isa();
+// used by tests to compare implementations. Falls back to the detected isa
+// if the requested one is not supported
+void use_isa(Isa);
+
+// ' ', '\t' and '\n'
+char const* skip_whitespace(char const*);
+// [a-zA-Z0-9_]
+char const* skip_identifier(char const*);
+// [0-9]
+char const* skip_digits(char const*);
+// stops at a '\n'
+char const* find_line_end(char const*);
+// stops at a '"'
+char const* find_quote(char const*);
+
+} // namespace CharScan
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "arena_vector.hpp"
+
+// Small map stored as an unsorted list of entries in a ListArena. Lookups
+// are linear, which beats hashing for the handful of keys that nodes like
+// match expressions and closures have.
+//
+// Entries use the same `first`/`second` names as std::pair so that loops
+// over the map read the same as loops over a std::unordered_map.
+template <typename Key, typename Value>
+struct FlatMap {
+	struct Entry {
+		Key first {};
+		Value second {};
+	};
+
+	using iterator = Entry*;
+	using const_iterator = Entry const*;
+
+	ArenaVector<Entry> m_entries {};
+
+	// adds the entry unless its key is already present. Returns whether it
+	// was added
+	bool insert(Entry const& entry, ListArena& arena) {
+		if (find(entry.first) != end())
+			return false;
+		m_entries.push_back(entry, arena);
+		return true;
+	}
+
+	iterator find(Key const& key) {
+		for (auto& entry : m_entries)
+			if (entry.first == key)
+				return &entry;
+		return end();
+	}
+
+	const_iterator find(Key const& key) const {
+		for (auto const& entry : m_entries)
+			if (entry.first == key)
+				return &entry;
+		return end();
+	}
+
+	[[nodiscard]] int size() const {
+		return m_entries.size();
+	}
+
+	[[nodiscard]] bool empty() const {
+		return m_entries.empty();
+	}
+
+	iterator begin() {
+		return m_entries.begin();
+	}
+
+	iterator end() {
+		return m_entries.end();
+	}
+
+	const_iterator begin() const {
+		return m_entries.begin();
+	}
+
+	const_iterator end() const {
+		return m_entries.end();
+	}
+};
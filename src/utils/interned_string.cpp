@@ -2,10 +2,10 @@
 
 #include "string_set.hpp"
 
-#include <cassert>
+#include <ostream>
 
-StringSet& InternedString::database() {
-	static StringSet values;
+ConcurrentStringSet& InternedString::database() {
+	static ConcurrentStringSet values;
 	return values;
 }
 
@@ -13,28 +13,23 @@ InternedString::InternedString(InternedString const& other)
     : m_data {other.m_data} {}
 
 InternedString::InternedString(char const* other, size_t length) {
-	auto insertion_result = database().insert(other, length);
-	m_data = &(*insertion_result.first);
+	auto insertion_result = database().insert(string_view(other, length));
+	m_data = insertion_result.first;
 }
 
 InternedString::InternedString(char const* other) {
-	auto insertion_result = database().insert(other);
-	m_data = &(*insertion_result.first);
+	auto insertion_result = database().insert(string_view(other));
+	m_data = insertion_result.first;
 }
 
 InternedString::InternedString(std::string const& other) {
-	auto insertion_result = database().insert(other);
-	m_data = &(*insertion_result.first);
+	auto insertion_result = database().insert(string_view(other));
+	m_data = insertion_result.first;
 }
 
 InternedString::InternedString(std::string&& other) {
-	auto insertion_result = database().insert(std::move(other));
-	m_data = &(*insertion_result.first);
-}
-
-std::string const& InternedString::str() const {
-	assert(m_data);
-	return *m_data;
+	auto insertion_result = database().insert(string_view(other));
+	m_data = insertion_result.first;
 }
 
 std::ostream& operator<<(std::ostream& o, InternedString const& is) {
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <iosfwd>
 #include <string>
+#include <string_view>
 
-struct StringSet;
+struct ConcurrentStringSet;
 
+// Points at the first character of a string in the global StringSet, which
+// stores the length right before it
 struct InternedString {
-	std::string const* m_data {nullptr};
+	char const* m_data {nullptr};
 
 	InternedString() = default;
 	InternedString(InternedString const& other);
@@ -27,15 +33,26 @@ struct InternedString {
 		return m_data < other.m_data;
 	}
 
-	[[nodiscard]] std::string const& str() const;
+	[[nodiscard]] std::string_view str() const {
+		assert(!is_null());
+		uint32_t length;
+		memcpy(&length, m_data - sizeof(length), sizeof(length));
+		return {m_data, length};
+	}
+
+	// NUL-terminated
+	[[nodiscard]] char const* c_str() const {
+		return m_data;
+	}
 
-	static StringSet& database();
+	// shared by all threads
+	static ConcurrentStringSet& database();
 };
 
 // Specialize std::hash to implement hashing for this type
 template<> struct std::hash<InternedString> {
 	std::size_t operator()(InternedString const& str) const noexcept {
-		auto hash_bits = std::hash<std::string const*>{}(str.m_data);
+		auto hash_bits = std::hash<char const*>{}(str.m_data);
 		return (hash_bits >> 4) | (hash_bits << 60);
 	};
 };
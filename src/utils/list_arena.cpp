@@ -0,0 +1,23 @@
+#include "list_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+void* ListArena::allocate(size_t bytes, size_t alignment) {
+	size_t padding = -reinterpret_cast<uintptr_t>(m_cursor) & (alignment - 1);
+
+	if (!m_cursor || padding + bytes > m_left) {
+		// new[] returns memory aligned for any fundamental type, and lists
+		// that don't fit in a page get one of their own
+		size_t const size = std::max(bytes, page_size);
+		m_pages.emplace_back(new std::byte[size]);
+		m_cursor = m_pages.back().get();
+		m_left = size;
+		padding = 0;
+	}
+
+	void* result = m_cursor + padding;
+	m_cursor += padding + bytes;
+	m_left -= padding + bytes;
+	return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "span.hpp"
+
+// Bump allocator for the variable-length lists that hang off tree nodes,
+// like the arguments of a call. The lists of a whole tree share a few large
+// pages instead of each having its own heap buffer.
+//
+// Lists are freed all at once with the arena, and their elements are never
+// destroyed, so they must not own any resources.
+struct ListArena {
+	static constexpr size_t page_size = 16 * 1024;
+
+	ListArena() = default;
+	ListArena(ListArena const&) = delete;
+	ListArena& operator=(ListArena const&) = delete;
+
+	template <typename T>
+	Span<T> make(std::vector<T> const& elements) {
+		if (elements.empty())
+			return {};
+
+		auto data = static_cast<T*>(allocate(sizeof(T) * elements.size(), alignof(T)));
+		for (size_t i = 0; i < elements.size(); ++i)
+			new (data + i) T(elements[i]);
+		return {data, int(elements.size())};
+	}
+
+	// uninitialized room for `count` elements, for containers that manage
+	// their own construction
+	template <typename T>
+	T* allocate_array(size_t count) {
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+  private:
+	std::vector<std::unique_ptr<std::byte[]>> m_pages {};
+	std::byte* m_cursor {nullptr};
+	size_t m_left {0};
+
+	void* allocate(size_t bytes, size_t alignment);
+};
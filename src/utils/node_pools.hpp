@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "paged_array.hpp"
+
+// Storage for the nodes of a tree, with a separate PagedArray for every
+// node type. Nodes of the same kind end up next to each other, each one
+// takes exactly its own size, and pointers to them stay valid as the pools
+// grow.
+//
+// Nodes must be trivially destructible: freeing the pools releases their
+// pages without visiting the nodes in them.
+template <typename Base>
+struct NodePools {
+	NodePools() = default;
+	NodePools(NodePools const&) = delete;
+	NodePools& operator=(NodePools const&) = delete;
+
+	template <typename T>
+	T* make() {
+		static_assert(std::is_base_of<Base, T>::value, "T must be a subtype of Base");
+		static_assert(
+		    std::is_trivially_destructible<T>::value,
+		    "T must be trivially destructible, its destructor is never run");
+		return &pool<T>().m_nodes.emplace_back();
+	}
+
+  private:
+	struct PoolBase {
+		virtual ~PoolBase() = default;
+	};
+
+	// pages of around 16KiB
+	template <typename T>
+	static constexpr int page_shift_for() {
+		int shift = 2;
+		while ((sizeof(T) << (shift + 1)) <= 16 * 1024)
+			shift += 1;
+		return shift;
+	}
+
+	template <typename T>
+	struct Pool : PoolBase {
+		PagedArray<T, page_shift_for<T>()> m_nodes {};
+	};
+
+	std::vector<std::unique_ptr<PoolBase>> m_pools {};
+
+	static int next_type_id() {
+		static std::atomic<int> counter {0};
+		return counter++;
+	}
+
+	template <typename T>
+	static int type_id() {
+		static int const id = next_type_id();
+		return id;
+	}
+
+	template <typename T>
+	Pool<T>& pool() {
+		int const id = type_id<T>();
+		if (id >= int(m_pools.size()))
+			m_pools.resize(id + 1);
+		if (!m_pools[id])
+			m_pools[id] = std::make_unique<Pool<T>>();
+		return static_cast<Pool<T>&>(*m_pools[id]);
+	}
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "span.hpp"
+
+/**
+ * Array stored in fixed size pages of 2^PageShift elements. Growing it
+ * never moves existing elements, so references to them stay valid.
+ *
+ * Elements can be visited a page at a time through page(), which gives
+ * contiguous runs that are cheaper to walk than indexing one by one.
+ */
+template <typename T, int PageShift = 10>
+struct PagedArray {
+	static constexpr int page_shift = PageShift;
+	static constexpr int page_size = 1 << PageShift;
+	static constexpr int page_mask = page_size - 1;
+
+	std::vector<T*> m_pages {};
+	int m_size {0};
+
+	PagedArray() = default;
+	PagedArray(PagedArray const&) = delete;
+	PagedArray& operator=(PagedArray const&) = delete;
+
+	PagedArray(PagedArray&& other) noexcept
+	    : m_pages {std::move(other.m_pages)}
+	    , m_size {other.m_size} {
+		other.m_pages.clear();
+		other.m_size = 0;
+	}
+
+	PagedArray& operator=(PagedArray&& other) noexcept {
+		if (this != &other) {
+			release();
+			m_pages = std::move(other.m_pages);
+			m_size = other.m_size;
+			other.m_pages.clear();
+			other.m_size = 0;
+		}
+		return *this;
+	}
+
+	~PagedArray() {
+		release();
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args) {
+		if ((m_size & page_mask) == 0 && (m_size >> page_shift) == int(m_pages.size()))
+			m_pages.push_back(allocate_page());
+		T* result = new (&m_pages[m_size >> page_shift][m_size & page_mask])
+		    T(std::forward<Args>(args)...);
+		m_size += 1;
+		return *result;
+	}
+
+	void push_back(T t) {
+		emplace_back(std::move(t));
+	}
+
+	T& back() {
+		assert(m_size > 0);
+		return at(m_size - 1);
+	}
+
+	T& at(int i) {
+		assert(0 <= i && i < m_size);
+		return m_pages[i >> page_shift][i & page_mask];
+	}
+
+	T const& at(int i) const {
+		assert(0 <= i && i < m_size);
+		return m_pages[i >> page_shift][i & page_mask];
+	}
+
+	T& operator[](int i) {
+		return at(i);
+	}
+
+	T const& operator[](int i) const {
+		return at(i);
+	}
+
+	[[nodiscard]] int size() const {
+		return m_size;
+	}
+
+	[[nodiscard]] bool empty() const {
+		return m_size == 0;
+	}
+
+	// number of pages that hold at least one element
+	[[nodiscard]] int page_count() const {
+		return (m_size + page_mask) >> page_shift;
+	}
+
+	// the elements stored in the i-th page. Only the last one can be partial
+	Span<T> page(int i) {
+		assert(0 <= i && i < page_count());
+		int length = i == page_count() - 1 ? m_size - (i << page_shift) : page_size;
+		return {m_pages[i], length};
+	}
+
+	template <typename Callback>
+	void for_each(Callback&& callback) {
+		int const pages = page_count();
+		for (int i = 0; i < pages; ++i)
+			for (T& element : page(i))
+				callback(element);
+	}
+
+	// destroys every element, but keeps the pages around for reuse
+	void clear() {
+		if constexpr (!std::is_trivially_destructible<T>::value)
+			for (int i = 0; i < m_size; ++i)
+				at(i).~T();
+		m_size = 0;
+	}
+
+  private:
+	void release() {
+		clear();
+		for (T* page : m_pages)
+			free_page(page);
+		m_pages.clear();
+	}
+
+	// plain operator new is cheaper, and enough for most types
+	static constexpr bool over_aligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+	static T* allocate_page() {
+		if constexpr (over_aligned)
+			return static_cast<T*>(
+			    ::operator new(sizeof(T) * page_size, std::align_val_t {alignof(T)}));
+		else
+			return static_cast<T*>(::operator new(sizeof(T) * page_size));
+	}
+
+	static void free_page(T* page) {
+		if constexpr (over_aligned)
+			::operator delete(page, std::align_val_t {alignof(T)});
+		else
+			::operator delete(page);
+	}
+};
@@ -1 +0,0 @@
-#include "polymorphic_block_allocator.hpp"
@@ -1 +0,0 @@
-#include "polymorphic_dumb_allocator.hpp"
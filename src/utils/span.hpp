@@ -7,13 +7,17 @@ struct Span {
 	using iterator = T*;
 	using const_iterator = T const*;
 
-	T* m_data;
-	int m_length;
+	T* m_data {nullptr};
+	int m_length {0};
 
 	T& operator[] (int i) {
 		return m_data[i];
 	}
 
+	T const& operator[] (int i) const {
+		return m_data[i];
+	}
+
 	T& at(int i){
 		assert(i >= 0);
 		assert(i < m_length);
@@ -24,6 +28,10 @@ struct Span {
 		return m_length;
 	}
 
+	[[nodiscard]] bool empty() const {
+		return m_length == 0;
+	}
+
 	iterator begin() {
 		return m_data;
 	}
@@ -32,6 +40,14 @@ struct Span {
 		return m_data + m_length;
 	}
 
+	const_iterator begin() const {
+		return m_data;
+	}
+
+	const_iterator end() const {
+		return m_data + m_length;
+	}
+
 	const_iterator cbegin() const {
 		return m_data;
 	}
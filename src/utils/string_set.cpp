@@ -1,26 +1,108 @@
 #include "string_set.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <mutex>
 
-// compute a 64-bit hash
-static uint64_t compute_hash(unsigned char const* data, size_t length) {
-	// djb2 (k=33) hash function
-	uint64_t result = 5381;
-	while (length--) {
-		result *= 33;
-		result ^= data[length];
+// wyhash (final version 4), by Wang Yi. Much faster than byte-at-a-time
+// hashes, and with better distribution
+namespace wyhash {
+
+static constexpr uint64_t secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+static void mum(uint64_t* a, uint64_t* b) {
+	__uint128_t r = *a;
+	r *= *b;
+	*a = static_cast<uint64_t>(r);
+	*b = static_cast<uint64_t>(r >> 64);
+}
+
+static uint64_t mix(uint64_t a, uint64_t b) {
+	mum(&a, &b);
+	return a ^ b;
+}
+
+static uint64_t read8(unsigned char const* p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+static uint64_t read4(unsigned char const* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static uint64_t read3(unsigned char const* p, size_t k) {
+	return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+
+static uint64_t hash(unsigned char const* p, size_t length, uint64_t seed = 0) {
+	seed ^= mix(seed ^ secret[0], secret[1]);
+	uint64_t a, b;
+
+	if (length <= 16) {
+		if (length >= 4) {
+			a = (read4(p) << 32) | read4(p + ((length >> 3) << 2));
+			b = (read4(p + length - 4) << 32) | read4(p + length - 4 - ((length >> 3) << 2));
+		} else if (length > 0) {
+			a = read3(p, length);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = length;
+		if (i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+				see1 = mix(read8(p + 16) ^ secret[2], read8(p + 24) ^ see1);
+				see2 = mix(read8(p + 32) ^ secret[3], read8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = read8(p + i - 16);
+		b = read8(p + i - 8);
 	}
-	return result;
+
+	a ^= secret[1];
+	b ^= seed;
+	mum(&a, &b);
+	return mix(a ^ secret[0] ^ length, b ^ secret[1]);
 }
 
+} // namespace wyhash
+
 // compute a 62-bit hash
 static uint64_t compute_effective_hash(unsigned char const* data, size_t length) {
-	uint64_t hash_bits = compute_hash(data, length);
+	uint64_t hash_bits = wyhash::hash(data, length);
 	// roll the two highest bits back to the low bits
 	return (hash_bits >> 62) ^ (hash_bits & ~(3ull << 62));
 }
 
+uint64_t StringSet::hash(string_view str) {
+	return compute_effective_hash(
+	    reinterpret_cast<unsigned char const*>(str.begin()), str.size());
+}
+
+std::string_view StringSet::view(char const* data) {
+	uint32_t length;
+	memcpy(&length, data - sizeof(length), sizeof(length));
+	return {data, length};
+}
+
 // ==== ==== ==== ====
 
 StringSet::StringSet() {
@@ -31,53 +113,47 @@ StringSet::StringSet() {
 	memset(m_value.data(), 0, sizeof(m_value[0]) * initial_size);
 }
 
-std::pair<std::string const*, bool> StringSet::insert(std::string&& s) {
+std::pair<char const*, bool> StringSet::insert(string_view str, uint64_t hash_bits) {
 	if (m_size * 2 >= m_slot.size())
 		rehash(m_slot.size() * 2);
 
-	uint64_t hash_bits = compute_effective_hash(
-	    reinterpret_cast<unsigned char const*>(s.data()), s.size());
-	auto pos = scan(s.data(), s.size(), hash_bits);
-
+	auto pos = scan(str.begin(), str.size(), hash_bits);
 	if (pos.found)
 		return {m_value[pos.stop_index], false};
 
 	m_size += 1;
-	put(pos.free_index, std::move(s), hash_bits);
+	put(pos.free_index, str, hash_bits);
 
 	return {m_value[pos.free_index], true};
 }
 
-std::pair<std::string const*, bool> StringSet::insert(char const* data, size_t length) {
-	if (m_size * 2 >= m_slot.size())
-		rehash(m_slot.size() * 2);
-
-	uint64_t hash_bits = compute_effective_hash(
-	    reinterpret_cast<unsigned char const*>(data), length);
-	auto pos = scan(data, length, hash_bits);
-	if (pos.found)
-		return {m_value[pos.stop_index], false};
-
-	m_size += 1;
-	put(pos.free_index, std::string {data, length}, hash_bits);
+std::pair<char const*, bool> StringSet::insert(string_view str) {
+	return insert(str, hash(str));
+}
 
-	return {m_value[pos.free_index], true};
+std::pair<char const*, bool> StringSet::insert(char const* data, size_t length) {
+	return insert(string_view(data, length));
 }
 
-std::pair<std::string const*, bool> StringSet::insert(std::string const& s) {
+std::pair<char const*, bool> StringSet::insert(std::string const& s) {
 	return insert(s.data(), s.size());
 }
 
-std::pair<std::string const*, bool> StringSet::insert(char const* data) {
+std::pair<char const*, bool> StringSet::insert(char const* data) {
 	return insert(data, strlen(data));
 }
 
-bool StringSet::includes(char const* data, size_t length) const {
-	uint64_t hash_bits = compute_effective_hash(
-	    reinterpret_cast<unsigned char const*>(data), length);
-	auto pos = scan(data, length, hash_bits);
+char const* StringSet::find(string_view str, uint64_t hash_bits) const {
+	auto pos = scan(str.begin(), str.size(), hash_bits);
+	return pos.found ? m_value[pos.stop_index] : nullptr;
+}
 
-	return pos.found;
+bool StringSet::includes(string_view str) const {
+	return find(str, hash(str)) != nullptr;
+}
+
+bool StringSet::includes(char const* data, size_t length) const {
+	return includes(string_view(data, length));
 }
 
 bool StringSet::includes(char const* data) const {
@@ -99,7 +175,7 @@ void StringSet::rehash(size_t const new_size) {
 	m_slot.resize(new_size);
 	memset(m_slot.data(), 0, sizeof(m_slot[0]) * new_size);
 
-	std::vector<std::string*> old_value = std::move(m_value);
+	std::vector<char const*> old_value = std::move(m_value);
 	m_value.clear();
 	m_value.resize(new_size);
 	memset(m_value.data(), 0, sizeof(m_value[0]) * new_size);
@@ -113,7 +189,7 @@ void StringSet::rehash(size_t const new_size) {
 			continue;
 
 		auto value = old_value[i];
-		auto pos = scan(value->data(), value->size(), slot.hash_bits);
+		auto pos = scan(value, view(value).size(), slot.hash_bits);
 		assert(!pos.found);
 		m_value[pos.free_index] = value;
 		m_slot[pos.free_index].status = HashField::Occupied;
@@ -138,8 +214,8 @@ StringSet::ScanData StringSet::scan(
 	while (true) {
 		if (m_slot[position].status == HashField::Occupied) {
 			if (m_slot[position].hash_bits == hash_bits &&
-			    length == m_value[position]->size() &&
-			    memcmp(data, m_value[position]->data(), length) == 0)
+			    length == view(m_value[position]).size() &&
+			    memcmp(data, m_value[position], length) == 0)
 				return {free_position, position, true};
 		} else {
 			if (free_position == -1)
@@ -153,12 +229,68 @@ StringSet::ScanData StringSet::scan(
 	}
 }
 
-void StringSet::put(int position, std::string&& str, uint64_t hash_bits) {
+void StringSet::put(int position, string_view str, uint64_t hash_bits) {
 	assert(m_slot[position].status != HashField::Occupied);
 	assert((hash_bits >> 62) == 0);
 
-	m_storage.push_back(std::move(str));
-	m_value[position] = &m_storage.back();
+	m_value[position] = store(str);
 	m_slot[position].status = HashField::Occupied;
 	m_slot[position].hash_bits = hash_bits;
 }
+
+char const* StringSet::store(string_view str) {
+	uint32_t const length = str.size();
+	size_t const needed = sizeof(length) + length + 1;
+
+	if (needed > m_page_left) {
+		// strings that don't fit in a page get a page of their own
+		size_t const size = std::max(needed, page_size);
+		m_pages.push_back(std::make_unique<char[]>(size));
+		m_page_cursor = m_pages.back().get();
+		m_page_left = size;
+	}
+
+	char* result = m_page_cursor + sizeof(length);
+	memcpy(m_page_cursor, &length, sizeof(length));
+	memcpy(result, str.begin(), length);
+	result[length] = '\0';
+
+	// keep the length prefixes aligned
+	size_t const used = (needed + alignof(uint32_t) - 1) & ~(alignof(uint32_t) - 1);
+	m_page_cursor += std::min(used, m_page_left);
+	m_page_left -= std::min(used, m_page_left);
+	return result;
+}
+
+// ==== ==== ==== ====
+
+ConcurrentStringSet::Shard& ConcurrentStringSet::shard_for(uint64_t hash_bits) {
+	// the table inside each shard uses the low bits, so we pick the shard
+	// with the high ones
+	return m_shards[(hash_bits >> 58) % shard_count];
+}
+
+ConcurrentStringSet::Shard const& ConcurrentStringSet::shard_for(uint64_t hash_bits) const {
+	return m_shards[(hash_bits >> 58) % shard_count];
+}
+
+std::pair<char const*, bool> ConcurrentStringSet::insert(string_view str) {
+	uint64_t const hash_bits = StringSet::hash(str);
+	auto& shard = shard_for(hash_bits);
+
+	{
+		std::shared_lock lock {shard.m_mutex};
+		if (auto found = shard.m_set.find(str, hash_bits))
+			return {found, false};
+	}
+
+	std::unique_lock lock {shard.m_mutex};
+	return shard.m_set.insert(str, hash_bits);
+}
+
+bool ConcurrentStringSet::includes(string_view str) const {
+	uint64_t const hash_bits = StringSet::hash(str);
+	auto const& shard = shard_for(hash_bits);
+	std::shared_lock lock {shard.m_mutex};
+	return shard.m_set.find(str, hash_bits) != nullptr;
+}
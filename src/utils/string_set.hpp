@@ -1,13 +1,23 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
-#include "chunked_array.hpp"
+#include "string_view.hpp"
 
 #include <cstdint>
 
 // a flat linear hashing table
 // if rehashing occurs, references are not invalidated
+//
+// Strings are stored back to back in large pages. Each one is preceded by
+// its length (as a uint32_t) and followed by a NUL byte, and is referred to
+// by a pointer to its first character.
 struct StringSet {
 	struct ScanData {
 		int free_index;
@@ -25,28 +35,63 @@ struct StringSet {
 		uint64_t hash_bits : 62;
 	};
 
-	ChunkedArray<std::string> m_storage;
+	static constexpr size_t page_size = 1 << 16;
+
+	std::vector<std::unique_ptr<char[]>> m_pages;
+	char* m_page_cursor {nullptr};
+	size_t m_page_left {0};
 	std::vector<HashField> m_slot;
-	std::vector<std::string*> m_value;
+	std::vector<char const*> m_value;
 	size_t m_size {0};
 
 	StringSet();
 
-	std::pair<std::string const*, bool> insert(std::string const&);
-	std::pair<std::string const*, bool> insert(std::string&&);
+	// 62-bit hash used to place strings in the table
+	static uint64_t hash(string_view);
+	// the string stored at the given pointer
+	static std::string_view view(char const*);
+
+	std::pair<char const*, bool> insert(std::string const&);
 	// void insert(InternedString const&); // TODO
-	// void insert(string_view const&); // TODO
-	std::pair<std::string const*, bool> insert(char const*, size_t);
-	std::pair<std::string const*, bool> insert(char const*);
+	std::pair<char const*, bool> insert(string_view);
+	std::pair<char const*, bool> insert(string_view, uint64_t hash_bits);
+	std::pair<char const*, bool> insert(char const*, size_t);
+	std::pair<char const*, bool> insert(char const*);
+
+	// returns nullptr if the string is not in the set. Never allocates
+	char const* find(string_view, uint64_t hash_bits) const;
 
 	[[nodiscard]] bool includes(std::string const&) const;
 	// bool includes(InternedString const&) const; // TODO
-	// bool includes(string_view const&) const; // TODO
+	bool includes(string_view) const;
 	bool includes(char const*, size_t) const;
 	bool includes(char const*) const;
 
   private:
 	ScanData scan(char const*, size_t, uint64_t) const;
-	void put(int, std::string&&, uint64_t);
+	void put(int, string_view, uint64_t);
+	char const* store(string_view);
 	void rehash(size_t);
 };
+
+// A StringSet that can be used from several threads at once. Strings are
+// spread over independently locked shards by their hash. Lookups of strings
+// that are already in the set (by far the most common case when interning)
+// only take a shared lock, so they don't block each other.
+struct ConcurrentStringSet {
+	static constexpr int shard_count = 16;
+
+	struct Shard {
+		mutable std::shared_mutex m_mutex;
+		StringSet m_set;
+	};
+
+	std::array<Shard, shard_count> m_shards;
+
+	std::pair<char const*, bool> insert(string_view);
+	[[nodiscard]] bool includes(string_view) const;
+
+  private:
+	Shard& shard_for(uint64_t hash_bits);
+	Shard const& shard_for(uint64_t hash_bits) const;
+};